@@ -0,0 +1,392 @@
+#include "matrix.h"
+#include "matrix_manipulations.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MIN_SIZE 8
+#define BENCH_MAX_SIZE 8192
+#define BENCH_SKINNY_COLS 16
+#define BENCH_MIN_REPS 5
+#define BENCH_MAX_REPS 100
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_MAX_GFLOP 100.0
+
+typedef struct {
+  size_t m, k, n;
+  matrix_t *a, *b, *c, *a0;
+} bench_case_t;
+
+typedef struct {
+  const char *name;
+  int square_only;
+  // Operands for an m x k by k x n problem; returns -1 on allocation failure.
+  int (*setup)(bench_case_t *bc);
+  // Untimed, before every repetition.
+  int (*reset)(bench_case_t *bc);
+  int (*run)(bench_case_t *bc);
+  // Nominal work of one run; flops < 0 when there is no meaningful count.
+  double (*flops)(const bench_case_t *bc);
+  double (*bytes)(const bench_case_t *bc);
+} bench_op_t;
+
+typedef struct {
+  size_t min_size;
+  size_t max_size;
+  size_t min_reps;
+  double max_gflop;
+  const char *only;
+} bench_options_t;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void fill_random(matrix_t *m, double diag) {
+  for (size_t i = 0; i < m->rows; ++i) {
+    for (size_t j = 0; j < m->cols; ++j) {
+      *mtx_ptr(m, i, j) = (double)rand() / RAND_MAX - 0.5;
+    }
+    if (i < m->cols)
+      *mtx_ptr(m, i, i) += diag;
+  }
+}
+
+static int alloc_random(matrix_t **m, size_t rows, size_t cols, double diag) {
+  *m = mtx_alloc(rows, cols);
+  if (!*m)
+    return -1;
+  fill_random(*m, diag);
+  return 0;
+}
+
+static int restore_a(bench_case_t *bc) { return mtx_assign(bc->a, bc->a0); }
+
+// Elementwise: a and b are m x n.
+static int setup_pair(bench_case_t *bc) {
+  return alloc_random(&bc->a, bc->m, bc->n, 0.0) ||
+         alloc_random(&bc->b, bc->m, bc->n, 0.0);
+}
+
+static int setup_single(bench_case_t *bc) {
+  return alloc_random(&bc->a, bc->m, bc->n, 0.0);
+}
+
+// Products: a is m x k, b is k x n, c is m x n.
+static int setup_product(bench_case_t *bc) {
+  if (alloc_random(&bc->a, bc->m, bc->k, 0.0) ||
+      alloc_random(&bc->b, bc->k, bc->n, 0.0))
+    return -1;
+  bc->c = mtx_alloc(bc->m, bc->n);
+  bc->a0 = mtx_copy(bc->a);
+  return bc->c && bc->a0 ? 0 : -1;
+}
+
+// mtx_mul keeps the shape of a when b is square.
+static int setup_mul(bench_case_t *bc) {
+  bc->n = bc->k;
+  return setup_product(bc);
+}
+
+// mtx_div: a is m x k, b is a well-conditioned k x k.
+static int setup_div(bench_case_t *bc) {
+  bc->n = bc->k;
+  if (alloc_random(&bc->a, bc->m, bc->k, 0.0) ||
+      alloc_random(&bc->b, bc->k, bc->k, (double)bc->k))
+    return -1;
+  bc->a0 = mtx_copy(bc->a);
+  return bc->a0 ? 0 : -1;
+}
+
+static int setup_inverse(bench_case_t *bc) {
+  if (alloc_random(&bc->a, bc->m, bc->m, (double)bc->m))
+    return -1;
+  bc->c = mtx_alloc(bc->m, bc->m);
+  return bc->c ? 0 : -1;
+}
+
+// Augmented [A | b] with a single right-hand side.
+static int setup_gauss(bench_case_t *bc) {
+  if (alloc_random(&bc->a0, bc->m, bc->m + 1, (double)bc->m))
+    return -1;
+  bc->a = mtx_copy(bc->a0);
+  return bc->a ? 0 : -1;
+}
+
+// Scaled to unit 1-norm order so the timing reflects a typical Pade degree.
+static int setup_exp(bench_case_t *bc) {
+  if (setup_inverse(bc))
+    return -1;
+  fill_random(bc->a, 0.0);
+  return mtx_scale(bc->a, 2.0 / (double)bc->m);
+}
+
+static int setup_transpose_to(bench_case_t *bc) {
+  if (alloc_random(&bc->a, bc->m, bc->n, 0.0))
+    return -1;
+  bc->c = mtx_alloc(bc->n, bc->m);
+  return bc->c ? 0 : -1;
+}
+
+static int run_add(bench_case_t *bc) { return mtx_add(bc->a, bc->b); }
+static int run_sub(bench_case_t *bc) { return mtx_sub(bc->a, bc->b); }
+static int run_add_scaled(bench_case_t *bc) {
+  return mtx_add_scaled(bc->a, bc->b, 0.5);
+}
+static int run_scale(bench_case_t *bc) { return mtx_scale(bc->a, 1.0); }
+static int run_norm(bench_case_t *bc) {
+  return isnan(mtx_norm(bc->a)) ? -1 : 0;
+}
+static int run_transpose(bench_case_t *bc) { return mtx_transpose(bc->a); }
+static int run_transpose_to(bench_case_t *bc) {
+  return mtx_transpose_to(bc->a, bc->c);
+}
+static int run_mul3(bench_case_t *bc) { return mtx_mul3(bc->c, bc->a, bc->b); }
+static int run_mul(bench_case_t *bc) { return mtx_mul(bc->a, bc->b); }
+static int run_div(bench_case_t *bc) { return mtx_div(bc->a, bc->b); }
+static int run_inverse(bench_case_t *bc) {
+  return mtx_inverse(bc->a, bc->c);
+}
+static int run_gauss(bench_case_t *bc) {
+  return mtx_gauss_elimination(bc->a);
+}
+static int run_exp(bench_case_t *bc) { return mtx_exp(bc->a, bc->c); }
+
+static double mn(const bench_case_t *bc) { return (double)bc->m * bc->n; }
+
+static double flops_none(const bench_case_t *bc) {
+  (void)bc;
+  return 0.0;
+}
+static double flops_mn(const bench_case_t *bc) { return mn(bc); }
+static double flops_2mn(const bench_case_t *bc) { return 2.0 * mn(bc); }
+static double flops_product(const bench_case_t *bc) {
+  return 2.0 * mn(bc) * bc->k;
+}
+// LU of b plus one forward and one backward substitution per row of a.
+static double flops_div(const bench_case_t *bc) {
+  double k = (double)bc->k;
+  return 2.0 / 3.0 * k * k * k + 2.0 * bc->m * k * k;
+}
+static double flops_inverse(const bench_case_t *bc) {
+  double n = (double)bc->m;
+  return 2.0 * n * n * n;
+}
+static double flops_gauss(const bench_case_t *bc) {
+  double n = (double)bc->m;
+  return 2.0 / 3.0 * n * n * n + 2.0 * n * n;
+}
+static double flops_unknown(const bench_case_t *bc) {
+  (void)bc;
+  return -1.0;
+}
+
+static double bytes_rw(const bench_case_t *bc) { return 16.0 * mn(bc); }
+static double bytes_rrw(const bench_case_t *bc) { return 24.0 * mn(bc); }
+static double bytes_r(const bench_case_t *bc) { return 8.0 * mn(bc); }
+static double bytes_product(const bench_case_t *bc) {
+  return 8.0 * ((double)bc->m * bc->k + (double)bc->k * bc->n + mn(bc));
+}
+static double bytes_square(const bench_case_t *bc) {
+  return 16.0 * (double)bc->m * bc->m;
+}
+
+static const bench_op_t bench_ops[] = {
+    {"add", 0, setup_pair, NULL, run_add, flops_mn, bytes_rrw},
+    {"sub", 0, setup_pair, NULL, run_sub, flops_mn, bytes_rrw},
+    {"add_scaled", 0, setup_pair, NULL, run_add_scaled, flops_2mn, bytes_rrw},
+    {"scale", 0, setup_single, NULL, run_scale, flops_mn, bytes_rw},
+    {"norm", 0, setup_single, NULL, run_norm, flops_2mn, bytes_r},
+    {"transpose", 0, setup_single, NULL, run_transpose, flops_none, bytes_rw},
+    {"transpose_to", 0, setup_transpose_to, NULL, run_transpose_to,
+     flops_none, bytes_rw},
+    {"mul3", 0, setup_product, NULL, run_mul3, flops_product, bytes_product},
+    {"mul", 0, setup_mul, restore_a, run_mul, flops_product, bytes_product},
+    {"div", 0, setup_div, restore_a, run_div, flops_div, bytes_product},
+    {"inverse", 1, setup_inverse, NULL, run_inverse, flops_inverse,
+     bytes_square},
+    {"gauss_elimination", 1, setup_gauss, restore_a, run_gauss, flops_gauss,
+     bytes_square},
+    {"exp", 1, setup_exp, NULL, run_exp, flops_unknown, bytes_square},
+};
+
+static void free_case(bench_case_t *bc) {
+  mtx_free(bc->a);
+  mtx_free(bc->b);
+  mtx_free(bc->c);
+  mtx_free(bc->a0);
+}
+
+static int compare_double(const void *x, const void *y) {
+  double a = *(const double *)x, b = *(const double *)y;
+  return (a > b) - (a < b);
+}
+
+// Nearest-rank percentile of sorted samples.
+static double percentile(const double *sorted, size_t count, double q) {
+  size_t rank = (size_t)ceil(q * (double)count);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_result(const bench_op_t *op, const char *shape,
+                         const bench_case_t *bc, const double *times,
+                         size_t reps, const char *error, int *first) {
+  printf("%s\n    {\"op\": \"%s\", \"shape\": \"%s\", \"m\": %zu, \"k\": %zu, "
+         "\"n\": %zu",
+         *first ? "" : ",", op->name, shape, bc->m, bc->k, bc->n);
+  *first = 0;
+  if (error) {
+    printf(", \"error\": \"%s\"}", error);
+    return;
+  }
+
+  double mean = 0.0;
+  for (size_t i = 0; i < reps; ++i) {
+    mean += times[i];
+  }
+  mean /= (double)reps;
+  double p50 = percentile(times, reps, 0.5);
+  double flops = op->flops(bc);
+
+  printf(", \"reps\": %zu, \"seconds\": {\"min\": %.9g, \"p50\": %.9g, "
+         "\"p90\": %.9g, \"p99\": %.9g, \"max\": %.9g, \"mean\": %.9g}",
+         reps, times[0], p50, percentile(times, reps, 0.9),
+         percentile(times, reps, 0.99), times[reps - 1], mean);
+  if (flops >= 0.0)
+    printf(", \"gflops\": %.6g", flops / p50 * 1e-9);
+  else
+    printf(", \"gflops\": null");
+  printf(", \"gbps\": %.6g}", op->bytes(bc) / p50 * 1e-9);
+}
+
+static void bench_one(const bench_op_t *op, const char *shape, size_t m,
+                      size_t k, size_t n, const bench_options_t *opt,
+                      int *first) {
+  static double times[BENCH_MAX_REPS];
+  bench_case_t bc = {m, k, n, NULL, NULL, NULL, NULL};
+
+  // Skip before allocating when one run would exceed the flop budget; an
+  // uncounted op (exp) is budgeted as a handful of n^3 products.
+  double work = op->flops(&bc);
+  if (work < 0.0)
+    work = 8.0 * flops_product(&bc);
+  if (work > opt->max_gflop * 1e9)
+    return;
+
+  fprintf(stderr, "%s %s %zux%zux%zu\n", op->name, shape, m, k, n);
+  if (op->setup(&bc) != 0) {
+    print_result(op, shape, &bc, NULL, 0, "allocation failed", first);
+    free_case(&bc);
+    return;
+  }
+
+  // One untimed warm-up run, then at least min_reps timed runs.
+  size_t reps = 0;
+  double total = 0.0;
+  const char *error = NULL;
+  for (size_t r = 0; r <= BENCH_MAX_REPS && !error; ++r) {
+    if (op->reset && op->reset(&bc) != 0) {
+      error = "reset failed";
+      break;
+    }
+    double t0 = now();
+    if (op->run(&bc) != 0)
+      error = "operation failed";
+    double t = now() - t0;
+    if (r == 0)
+      continue;
+    times[reps++] = t;
+    total += t;
+    if (reps >= opt->min_reps && total >= BENCH_MIN_SECONDS)
+      break;
+    if (reps == BENCH_MAX_REPS)
+      break;
+  }
+
+  qsort(times, reps, sizeof(double), compare_double);
+  print_result(op, shape, &bc, times, reps, error, first);
+  free_case(&bc);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [--min N] [--max N] [--reps N] [--max-gflop G] "
+          "[--op NAME]\n"
+          "Writes JSON results to stdout and progress to stderr.\n",
+          prog);
+}
+
+static int parse_options(int argc, char **argv, bench_options_t *opt) {
+  opt->min_size = BENCH_MIN_SIZE;
+  opt->max_size = BENCH_MAX_SIZE;
+  opt->min_reps = BENCH_MIN_REPS;
+  opt->max_gflop = BENCH_MAX_GFLOP;
+  opt->only = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!val)
+      return -1;
+    if (strcmp(arg, "--min") == 0)
+      opt->min_size = strtoul(val, NULL, 10);
+    else if (strcmp(arg, "--max") == 0)
+      opt->max_size = strtoul(val, NULL, 10);
+    else if (strcmp(arg, "--reps") == 0)
+      opt->min_reps = strtoul(val, NULL, 10);
+    else if (strcmp(arg, "--max-gflop") == 0)
+      opt->max_gflop = strtod(val, NULL);
+    else if (strcmp(arg, "--op") == 0)
+      opt->only = val;
+    else
+      return -1;
+    ++i;
+  }
+
+  if (opt->min_reps < 1)
+    opt->min_reps = 1;
+  if (opt->min_reps > BENCH_MAX_REPS)
+    opt->min_reps = BENCH_MAX_REPS;
+  return opt->min_size > 0 && opt->min_size <= opt->max_size ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+  bench_options_t opt;
+  if (parse_options(argc, argv, &opt) != 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  srand(1);
+  printf("{\n  \"library\": \"mtx\",\n  \"simd\": \"%s\",\n"
+         "  \"threads\": %zu,\n  \"results\": [",
+         mtx_simd_ops()->name, mtx_get_num_threads());
+
+  int first = 1;
+  size_t nops = sizeof(bench_ops) / sizeof(bench_ops[0]);
+  for (size_t s = opt.min_size; s <= opt.max_size; s *= 2) {
+    for (size_t i = 0; i < nops; ++i) {
+      const bench_op_t *op = &bench_ops[i];
+      if (opt.only && strcmp(opt.only, op->name) != 0)
+        continue;
+
+      bench_one(op, "square", s, s, s, &opt, &first);
+      // Tall-skinny: s x 16 operands, or an s x s by s x 16 product.
+      if (!op->square_only && s > BENCH_SKINNY_COLS)
+        bench_one(op, "skinny", s,
+                  op->setup == setup_product ? s : BENCH_SKINNY_COLS,
+                  BENCH_SKINNY_COLS, &opt, &first);
+    }
+  }
+
+  printf("\n  ]\n}\n");
+  mtx_threads_shutdown();
+  return 0;
+}
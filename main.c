@@ -112,6 +112,7 @@ int main(void) {
   matrix_t *gauss_B = NULL;
   matrix_t *gauss_X = NULL;
   matrix_t *aug = NULL;
+  matrix_t aug_a, aug_b;
 
   if (!m1 || !m2) {
     printf("Ошибка: Не удалось выделить память для матриц.\n");
@@ -225,12 +226,10 @@ int main(void) {
     goto cleanup;
   }
 
-  for (size_t i = 0; i < 3; ++i) {
-    for (size_t j = 0; j < 3; ++j) {
-      *mtx_ptr(aug, i, j) = *mtx_cptr(gauss_A, i, j);
-    }
-    *mtx_ptr(aug, i, 3) = *mtx_cptr(gauss_B, i, 0);
-  }
+  mtx_view(&aug_a, aug, 0, 0, 3, 3);
+  mtx_view(&aug_b, aug, 0, 3, 3, 1);
+  mtx_assign(&aug_a, gauss_A);
+  mtx_assign(&aug_b, gauss_B);
 
   if (mtx_gauss_elimination(aug) != 0) {
     printf("Ошибка: Не удалось выполнить метод Гаусса.\n");
@@ -239,9 +238,7 @@ int main(void) {
     goto cleanup;
   }
 
-  for (size_t i = 0; i < 3; ++i) {
-    *mtx_ptr(gauss_X, i, 0) = *mtx_cptr(aug, i, 3);
-  }
+  mtx_assign(gauss_X, &aug_b);
 
   mtx_print_titled("Гаусс A (Система 1)", gauss_A);
   mtx_print_titled("Гаусс B (Система 1)", gauss_B);
@@ -270,12 +267,10 @@ int main(void) {
     goto cleanup;
   }
 
-  for (size_t i = 0; i < 3; ++i) {
-    for (size_t j = 0; j < 3; ++j) {
-      *mtx_ptr(aug, i, j) = *mtx_cptr(gauss_A, i, j);
-    }
-    *mtx_ptr(aug, i, 3) = *mtx_cptr(gauss_B, i, 0);
-  }
+  mtx_view(&aug_a, aug, 0, 0, 3, 3);
+  mtx_view(&aug_b, aug, 0, 3, 3, 1);
+  mtx_assign(&aug_a, gauss_A);
+  mtx_assign(&aug_b, gauss_B);
 
   if (mtx_gauss_elimination(aug) != 0) {
     printf("Ошибка: Не удалось выполнить метод Гаусса.\n");
@@ -284,9 +279,7 @@ int main(void) {
     goto cleanup;
   }
 
-  for (size_t i = 0; i < 3; ++i) {
-    *mtx_ptr(gauss_X, i, 0) = *mtx_cptr(aug, i, 3);
-  }
+  mtx_assign(gauss_X, &aug_b);
 
   mtx_print_titled("Гаусс A (Система 2)", gauss_A);
   mtx_print_titled("Гаусс B (Система 2)", gauss_B);
@@ -1,19 +1,57 @@
 #include "matrix.h"
+#include "matrix_stats.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-matrix_t *mtx_alloc(size_t rows, size_t cols) {
-  if (rows == 0 || cols == 0)
+#define MTX_ALIGN_DOUBLES (MTX_ALIGN / sizeof(double))
+#define MTX_PAGE_BYTES 4096
+
+size_t mtx_padded_ld(size_t cols) {
+  size_t ld = (cols + MTX_ALIGN_DOUBLES - 1) / MTX_ALIGN_DOUBLES *
+              MTX_ALIGN_DOUBLES;
+  if ((ld * sizeof(double)) % MTX_PAGE_BYTES == 0)
+    ld += MTX_ALIGN_DOUBLES;
+  return ld;
+}
+
+int mtx_is_contiguous(const matrix_t *m) {
+  return m && (m->ld == m->cols || m->rows <= 1);
+}
+
+void *mtx_alloc_elems(size_t rows, size_t ld, size_t size) {
+  // Leaves room to round up to MTX_ALIGN as well.
+  if (size == 0 || (ld && rows > (SIZE_MAX - MTX_ALIGN) / size / ld))
+    return NULL;
+  size_t bytes = rows * ld * size;
+  bytes = (bytes + MTX_ALIGN - 1) / MTX_ALIGN * MTX_ALIGN;
+  MTX_STATS_ALLOC(bytes);
+  void *data = aligned_alloc(MTX_ALIGN, bytes);
+  if (data)
+    memset(data, 0, bytes);
+  return data;
+}
+
+double *mtx_alloc_buffer(size_t rows, size_t ld) {
+  return (double *)mtx_alloc_elems(rows, ld, sizeof(double));
+}
+
+matrix_t *mtx_alloc_ld(size_t rows, size_t cols, size_t ld) {
+  MTX_STATS_OP(ALLOC_LD);
+  if (rows == 0 || cols == 0 || ld < cols)
     return NULL;
 
+  MTX_STATS_ALLOC(sizeof(matrix_t));
   matrix_t *m = (matrix_t *)malloc(sizeof(matrix_t));
   if (!m)
     return NULL;
 
   m->rows = rows;
   m->cols = cols;
-  m->data = (double *)calloc(rows * cols, sizeof(double));
+  m->ld = ld;
+  m->view = 0;
+  m->data = mtx_alloc_buffer(rows, ld);
   if (!m->data) {
     free(m);
     return NULL;
@@ -22,11 +60,23 @@ matrix_t *mtx_alloc(size_t rows, size_t cols) {
   return m;
 }
 
+matrix_t *mtx_alloc(size_t rows, size_t cols) {
+  MTX_STATS_OP(ALLOC);
+  return mtx_alloc_ld(rows, cols, cols);
+}
+
+matrix_t *mtx_alloc_padded(size_t rows, size_t cols) {
+  MTX_STATS_OP(ALLOC_PADDED);
+  return mtx_alloc_ld(rows, cols, mtx_padded_ld(cols));
+}
+
 matrix_t *mtx_alloc_zero(size_t rows, size_t cols) {
+  MTX_STATS_OP(ALLOC_ZERO);
   return mtx_alloc(rows, cols);
 }
 
 matrix_t *mtx_alloc_id(size_t rows, size_t cols) {
+  MTX_STATS_OP(ALLOC_ID);
   if (rows != cols)
     return NULL;
 
@@ -35,25 +85,29 @@ matrix_t *mtx_alloc_id(size_t rows, size_t cols) {
     return NULL;
 
   for (size_t i = 0; i < rows; ++i) {
-    *mtx_ptr(m, i, i) = 1.0;
+    *mtx_at(m, i, i) = 1.0;
   }
 
   return m;
 }
 
 matrix_t *mtx_copy(const matrix_t *m) {
+  MTX_STATS_OP(COPY);
   if (!m || !m->data)
     return NULL;
 
-  matrix_t *copy = mtx_alloc(m->rows, m->cols);
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double), 0);
+  // A view's ld belongs to its parent; its copy is packed.
+  matrix_t *copy = mtx_alloc_ld(m->rows, m->cols, m->view ? m->cols : m->ld);
   if (!copy)
     return NULL;
 
-  memcpy(copy->data, m->data, m->rows * m->cols * sizeof(double));
+  mtx_assign(copy, m);
   return copy;
 }
 
 void mtx_free(matrix_t *m) {
+  MTX_STATS_OP(FREE);
   if (m) {
     free(m->data);
     free(m);
@@ -61,75 +115,207 @@ void mtx_free(matrix_t *m) {
 }
 
 int mtx_assign(matrix_t *dest, const matrix_t *src) {
+  MTX_STATS_OP(ASSIGN);
   if (!dest || !src || !src->data)
     return -1;
   if (dest->rows != src->rows || dest->cols != src->cols)
     return -1;
 
-  memcpy(dest->data, src->data, src->rows * src->cols * sizeof(double));
+  MTX_STATS_WORK(2 * src->rows * src->cols * sizeof(double), 0);
+  if (mtx_is_contiguous(dest) && mtx_is_contiguous(src)) {
+    memcpy(dest->data, src->data, src->rows * src->cols * sizeof(double));
+    return 0;
+  }
+
+  for (size_t i = 0; i < src->rows; ++i) {
+    memcpy(mtx_row(dest, i), mtx_crow(src, i),
+           src->cols * sizeof(double));
+  }
   return 0;
 }
 
 int mtx_move_assign(matrix_t *dest, matrix_t *src) {
+  MTX_STATS_OP(MOVE_ASSIGN);
   if (!dest || !src)
     return -1;
+  if (dest->view || src->view)
+    return -1;
 
   free(dest->data);
   dest->data = src->data;
   dest->rows = src->rows;
   dest->cols = src->cols;
+  dest->ld = src->ld;
 
   src->data = NULL;
   src->rows = 0;
   src->cols = 0;
+  src->ld = 0;
 
   mtx_free(src);
   return 0;
 }
 
+int mtx_view(matrix_t *view, matrix_t *m, size_t r0, size_t c0, size_t rows,
+             size_t cols) {
+  if (!view || !m || !m->data)
+    return -1;
+  if (rows == 0 || cols == 0 || r0 > m->rows || rows > m->rows - r0 ||
+      c0 > m->cols || cols > m->cols - c0)
+    return -1;
+
+  return mtx_view_data(view, mtx_at(m, r0, c0), rows, cols, m->ld);
+}
+
+int mtx_view_data(matrix_t *view, double *data, size_t rows, size_t cols,
+                  size_t ld) {
+  if (!view || !data || ld < cols)
+    return -1;
+
+  view->rows = rows;
+  view->cols = cols;
+  view->ld = ld;
+  view->data = data;
+  view->view = 1;
+  return 0;
+}
+
+int mtx_is_view(const matrix_t *m) { return m && m->view; }
+
+int mtx_overlaps(const matrix_t *a, const matrix_t *b) {
+  if (!a || !b || !a->data || !b->data || a->rows * a->cols == 0 ||
+      b->rows * b->cols == 0)
+    return 0;
+
+  const double *a_end = a->data + (a->rows - 1) * a->ld + a->cols;
+  const double *b_end = b->data + (b->rows - 1) * b->ld + b->cols;
+  if (a->data >= b_end || b->data >= a_end)
+    return 0;
+  if (a->ld != b->ld)
+    return 1;
+
+  // Blocks of one parent: compare row and column ranges.
+  if (b->data < a->data) {
+    const matrix_t *t = a;
+    a = b;
+    b = t;
+  }
+  size_t offset = (size_t)(b->data - a->data);
+  size_t r0 = offset / a->ld, c0 = offset % a->ld;
+  if (c0 + b->cols > a->ld)
+    return 1;
+  return r0 < a->rows && c0 < a->cols;
+}
+
 void mtx_set_zero(matrix_t *m) {
-  if (m && m->data) {
+  MTX_STATS_OP(SET_ZERO);
+  if (!m || !m->data)
+    return;
+
+  MTX_STATS_WORK(m->rows * m->cols * sizeof(double), 0);
+  if (mtx_is_contiguous(m)) {
     memset(m->data, 0, m->rows * m->cols * sizeof(double));
+    return;
+  }
+
+  for (size_t i = 0; i < m->rows; ++i) {
+    memset(mtx_row(m, i), 0, m->cols * sizeof(double));
   }
 }
 
 void mtx_set_id(matrix_t *m) {
+  MTX_STATS_OP(SET_ID);
   if (!m || !m->data || m->rows != m->cols)
     return;
 
+  MTX_STATS_WORK(m->rows * m->cols * sizeof(double), 0);
   mtx_set_zero(m);
   for (size_t i = 0; i < m->rows; ++i) {
-    *mtx_ptr(m, i, i) = 1.0;
+    *mtx_at(m, i, i) = 1.0;
   }
 }
 
 double *mtx_ptr(matrix_t *m, size_t i, size_t j) {
   if (!m || !m->data || i >= m->rows || j >= m->cols)
     return NULL;
-  return &m->data[i * m->cols + j];
+  return &m->data[i * m->ld + j];
 }
 
 const double *mtx_cptr(const matrix_t *m, size_t i, size_t j) {
   if (!m || !m->data || i >= m->rows || j >= m->cols)
     return NULL;
-  return &m->data[i * m->cols + j];
+  return &m->data[i * m->ld + j];
+}
+
+int mtx_row_span(matrix_t *m, size_t i, mtx_span_t *span) {
+  if (!m || !m->data || !span || i >= m->rows)
+    return -1;
+  span->data = mtx_row(m, i);
+  span->len = m->cols;
+  span->stride = 1;
+  return 0;
+}
+
+int mtx_col_span(matrix_t *m, size_t j, mtx_span_t *span) {
+  if (!m || !m->data || !span || j >= m->cols)
+    return -1;
+  span->data = mtx_at(m, 0, j);
+  span->len = m->rows;
+  span->stride = m->ld;
+  return 0;
+}
+
+int mtx_crow_span(const matrix_t *m, size_t i, mtx_cspan_t *span) {
+  if (!m || !m->data || !span || i >= m->rows)
+    return -1;
+  span->data = mtx_crow(m, i);
+  span->len = m->cols;
+  span->stride = 1;
+  return 0;
+}
+
+int mtx_ccol_span(const matrix_t *m, size_t j, mtx_cspan_t *span) {
+  if (!m || !m->data || !span || j >= m->cols)
+    return -1;
+  span->data = mtx_cat(m, 0, j);
+  span->len = m->rows;
+  span->stride = m->ld;
+  return 0;
+}
+
+int mtx_read(matrix_t *m) {
+  MTX_STATS_OP(READ);
+  if (!m || !m->data)
+    return -1;
+
+  MTX_STATS_WORK(m->rows * m->cols * sizeof(double), 0);
+  for (size_t i = 0; i < m->rows; ++i) {
+    for (size_t j = 0; j < m->cols; ++j) {
+      if (scanf("%lf", mtx_at(m, i, j)) != 1)
+        return -1;
+    }
+  }
+  return 0;
 }
 
 void mtx_print(const matrix_t *m) {
+  MTX_STATS_OP(PRINT);
   if (!m || !m->data) {
     printf("NULL matrix\n");
     return;
   }
 
+  MTX_STATS_WORK(m->rows * m->cols * sizeof(double), 0);
   for (size_t i = 0; i < m->rows; ++i) {
     for (size_t j = 0; j < m->cols; ++j) {
-      printf("%8.3f ", *mtx_cptr(m, i, j));
+      printf("%8.3f ", *mtx_cat(m, i, j));
     }
     printf("\n");
   }
 }
 
 void mtx_print_titled(const char *title, const matrix_t *m) {
+  MTX_STATS_OP(PRINT);
   printf("%s:\n", title);
   mtx_print(m);
   printf("\n");
@@ -3,13 +3,22 @@
 
 #include <stddef.h>
 
+#define MTX_ALIGN 64
+
+// Row i starts at data + i * ld; ld >= cols. Buffers from mtx_alloc* are
+// MTX_ALIGN-byte aligned. A view borrows its buffer and never frees or
+// reallocates it.
 typedef struct {
   size_t rows;
   size_t cols;
+  size_t ld;
   double *data;
+  int view;
 } matrix_t;
 
 matrix_t *mtx_alloc(size_t rows, size_t cols);
+matrix_t *mtx_alloc_ld(size_t rows, size_t cols, size_t ld);
+matrix_t *mtx_alloc_padded(size_t rows, size_t cols);
 matrix_t *mtx_alloc_zero(size_t rows, size_t cols);
 matrix_t *mtx_alloc_id(size_t rows, size_t cols);
 matrix_t *mtx_copy(const matrix_t *m);
@@ -20,7 +29,64 @@ void mtx_set_zero(matrix_t *m);
 void mtx_set_id(matrix_t *m);
 double *mtx_ptr(matrix_t *m, size_t i, size_t j);
 const double *mtx_cptr(const matrix_t *m, size_t i, size_t j);
+// Reads rows * cols numbers from stdin in row order.
+int mtx_read(matrix_t *m);
 void mtx_print(const matrix_t *m);
 void mtx_print_titled(const char *title, const matrix_t *m);
 
-#endif 
\ No newline at end of file
+// Leading dimension mtx_alloc_padded uses: whole cache lines per row, nudged
+// off multiples of 4 KiB so columns do not map to the same cache sets.
+size_t mtx_padded_ld(size_t cols);
+int mtx_is_contiguous(const matrix_t *m);
+// Zeroed, MTX_ALIGN-aligned storage for rows * ld elements of `size` bytes,
+// released with free; NULL when the byte count would overflow.
+void *mtx_alloc_elems(size_t rows, size_t ld, size_t size);
+double *mtx_alloc_buffer(size_t rows, size_t ld);
+
+// Block [r0, r0 + rows) x [c0, c0 + cols) of m as a view sharing m's buffer.
+// Views are plain values: they need no freeing but must not outlive m.
+int mtx_view(matrix_t *view, matrix_t *m, size_t r0, size_t c0, size_t rows,
+             size_t cols);
+int mtx_view_data(matrix_t *view, double *data, size_t rows, size_t cols,
+                  size_t ld);
+int mtx_is_view(const matrix_t *m);
+// Whether the element ranges of a and b share any memory.
+int mtx_overlaps(const matrix_t *a, const matrix_t *b);
+
+// Unchecked access for loops whose indices were validated once up front.
+static inline double *mtx_at(matrix_t *m, size_t i, size_t j) {
+  return m->data + i * m->ld + j;
+}
+
+static inline const double *mtx_cat(const matrix_t *m, size_t i, size_t j) {
+  return m->data + i * m->ld + j;
+}
+
+static inline double *mtx_row(matrix_t *m, size_t i) {
+  return m->data + i * m->ld;
+}
+
+static inline const double *mtx_crow(const matrix_t *m, size_t i) {
+  return m->data + i * m->ld;
+}
+
+// len elements, stride apart: stride 1 for a row, ld for a column.
+typedef struct {
+  double *data;
+  size_t len;
+  size_t stride;
+} mtx_span_t;
+
+typedef struct {
+  const double *data;
+  size_t len;
+  size_t stride;
+} mtx_cspan_t;
+
+// Bounds-checked once; return -1 for a missing matrix or index.
+int mtx_row_span(matrix_t *m, size_t i, mtx_span_t *span);
+int mtx_col_span(matrix_t *m, size_t j, mtx_span_t *span);
+int mtx_crow_span(const matrix_t *m, size_t i, mtx_cspan_t *span);
+int mtx_ccol_span(const matrix_t *m, size_t j, mtx_cspan_t *span);
+
+#endif
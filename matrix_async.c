@@ -0,0 +1,524 @@
+#include "matrix_async.h"
+#include "matrix_operations.h"
+#include "matrix_threads.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#define DEQUE_MIN_CAP 16
+
+struct mtx_future {
+  mtx_queue_t *q;
+  mtx_task_fn fn;
+  void *ctx;
+  void *arg[3];
+  const matrix_t *reads[MTX_ASYNC_MAX_OPERANDS];
+  const matrix_t *writes[MTX_ASYNC_MAX_OPERANDS];
+  size_t nreads, nwrites;
+
+  // Graph state, under the queue lock.
+  size_t deps;
+  mtx_future_t **succ;
+  size_t nsucc, succ_cap;
+  mtx_future_t *prev, *next;
+
+  int rc;
+  int done;
+  int refs;
+};
+
+// Ready jobs of one worker: the owner pushes and pops at the tail, thieves
+// take from the head.
+typedef struct {
+  pthread_mutex_t lock;
+  mtx_future_t **buf;
+  size_t head, count, cap;
+} deque_t;
+
+typedef struct {
+  mtx_queue_t *q;
+  size_t id;
+  pthread_t thread;
+} worker_t;
+
+struct mtx_queue {
+  pthread_mutex_t lock;
+  pthread_cond_t cv;
+  mtx_future_t *active_head, *active_tail;
+  size_t ready;
+  size_t next_deque;
+  int failed;
+  int stopping;
+
+  deque_t *deques;
+  worker_t *workers;
+  size_t num_workers;
+  size_t started;
+};
+
+static int deque_push(deque_t *d, mtx_future_t *f) {
+  pthread_mutex_lock(&d->lock);
+  if (d->count == d->cap) {
+    size_t cap = d->cap ? 2 * d->cap : DEQUE_MIN_CAP;
+    mtx_future_t **buf = (mtx_future_t **)malloc(cap * sizeof(*buf));
+    if (!buf) {
+      pthread_mutex_unlock(&d->lock);
+      return -1;
+    }
+    for (size_t i = 0; i < d->count; ++i) {
+      buf[i] = d->buf[(d->head + i) % d->cap];
+    }
+    free(d->buf);
+    d->buf = buf;
+    d->head = 0;
+    d->cap = cap;
+  }
+  d->buf[(d->head + d->count) % d->cap] = f;
+  d->count++;
+  pthread_mutex_unlock(&d->lock);
+  return 0;
+}
+
+static mtx_future_t *deque_take(deque_t *d, int steal) {
+  mtx_future_t *f = NULL;
+  pthread_mutex_lock(&d->lock);
+  if (d->count > 0) {
+    d->count--;
+    if (steal) {
+      f = d->buf[d->head];
+      d->head = (d->head + 1) % d->cap;
+    } else {
+      f = d->buf[(d->head + d->count) % d->cap];
+    }
+  }
+  pthread_mutex_unlock(&d->lock);
+  return f;
+}
+
+static void future_unref(mtx_future_t *f) {
+  if (__atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    free(f);
+}
+
+// Called with the queue lock held. Jobs made ready by a worker stay on its
+// own deque, next to the data they consume.
+static int push_ready(mtx_queue_t *q, size_t w, mtx_future_t *f) {
+  if (w >= q->num_workers)
+    w = q->next_deque++ % q->num_workers;
+  if (deque_push(&q->deques[w], f) != 0)
+    return -1;
+  __atomic_add_fetch(&q->ready, 1, __ATOMIC_RELAXED);
+  pthread_cond_broadcast(&q->cv);
+  return 0;
+}
+
+// Own deque first (newest job), then the others (oldest job). w may be
+// num_workers for a thread outside the queue, which only steals.
+static mtx_future_t *take_job(mtx_queue_t *q, size_t w) {
+  mtx_future_t *f = NULL;
+  if (w < q->num_workers)
+    f = deque_take(&q->deques[w], 0);
+  for (size_t i = 1; !f && i <= q->num_workers; ++i) {
+    f = deque_take(&q->deques[(w + i) % q->num_workers], 1);
+  }
+  if (f)
+    __atomic_sub_fetch(&q->ready, 1, __ATOMIC_RELAXED);
+  return f;
+}
+
+static void run_job(mtx_queue_t *q, mtx_future_t *f, size_t w);
+
+static void complete(mtx_queue_t *q, mtx_future_t *f, size_t w) {
+  pthread_mutex_lock(&q->lock);
+  if (f->prev)
+    f->prev->next = f->next;
+  else
+    q->active_head = f->next;
+  if (f->next)
+    f->next->prev = f->prev;
+  else
+    q->active_tail = f->prev;
+
+  for (size_t i = 0; i < f->nsucc; ++i) {
+    mtx_future_t *s = f->succ[i];
+    // A successor that cannot be queued runs right here instead.
+    if (--s->deps == 0 && push_ready(q, w, s) != 0) {
+      pthread_mutex_unlock(&q->lock);
+      run_job(q, s, w);
+      pthread_mutex_lock(&q->lock);
+    }
+  }
+  free(f->succ);
+  f->succ = NULL;
+  if (f->rc != 0)
+    q->failed = 1;
+  __atomic_store_n(&f->done, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&q->cv);
+  pthread_mutex_unlock(&q->lock);
+  future_unref(f);
+}
+
+static void run_job(mtx_queue_t *q, mtx_future_t *f, size_t w) {
+  f->rc = f->fn(f->ctx);
+  complete(q, f, w);
+}
+
+static void *queue_worker(void *arg) {
+  worker_t *self = (worker_t *)arg;
+  mtx_queue_t *q = self->q;
+  for (;;) {
+    mtx_future_t *f = take_job(q, self->id);
+    if (f) {
+      run_job(q, f, self->id);
+      continue;
+    }
+
+    pthread_mutex_lock(&q->lock);
+    size_t ready;
+    while ((ready = __atomic_load_n(&q->ready, __ATOMIC_RELAXED)) == 0 &&
+           !q->stopping)
+      pthread_cond_wait(&q->cv, &q->lock);
+    int stop = q->stopping && ready == 0;
+    pthread_mutex_unlock(&q->lock);
+    if (stop)
+      break;
+  }
+  return NULL;
+}
+
+mtx_queue_t *mtx_queue_create(size_t workers) {
+  if (workers == 0)
+    workers = mtx_get_num_threads();
+  if (workers > MTX_MAX_THREADS)
+    return NULL;
+
+  mtx_queue_t *q = (mtx_queue_t *)calloc(1, sizeof(mtx_queue_t));
+  if (!q)
+    return NULL;
+  q->deques = (deque_t *)calloc(workers, sizeof(deque_t));
+  q->workers = (worker_t *)calloc(workers, sizeof(worker_t));
+  if (!q->deques || !q->workers) {
+    free(q->deques);
+    free(q->workers);
+    free(q);
+    return NULL;
+  }
+
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->cv, NULL);
+  q->num_workers = workers;
+  for (size_t i = 0; i < workers; ++i) {
+    pthread_mutex_init(&q->deques[i].lock, NULL);
+  }
+  // Deques of workers that failed to start are still drained by stealing.
+  for (; q->started < workers; ++q->started) {
+    worker_t *w = &q->workers[q->started];
+    w->q = q;
+    w->id = q->started;
+    if (pthread_create(&w->thread, NULL, queue_worker, w) != 0)
+      break;
+  }
+  if (q->started == 0) {
+    mtx_queue_destroy(q);
+    return NULL;
+  }
+  return q;
+}
+
+void mtx_queue_destroy(mtx_queue_t *q) {
+  if (!q)
+    return;
+
+  mtx_queue_wait_all(q);
+  pthread_mutex_lock(&q->lock);
+  q->stopping = 1;
+  pthread_cond_broadcast(&q->cv);
+  pthread_mutex_unlock(&q->lock);
+
+  for (size_t i = 0; i < q->started; ++i) {
+    pthread_join(q->workers[i].thread, NULL);
+  }
+  for (size_t i = 0; i < q->num_workers; ++i) {
+    pthread_mutex_destroy(&q->deques[i].lock);
+    free(q->deques[i].buf);
+  }
+  pthread_cond_destroy(&q->cv);
+  pthread_mutex_destroy(&q->lock);
+  free(q->deques);
+  free(q->workers);
+  free(q);
+}
+
+// Blocks until cond(q, arg) holds, running stolen jobs meanwhile. cond is
+// checked under the queue lock.
+static void help_until(mtx_queue_t *q, int (*cond)(mtx_queue_t *, void *),
+                       void *arg) {
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    while (!cond(q, arg) && __atomic_load_n(&q->ready, __ATOMIC_RELAXED) == 0)
+      pthread_cond_wait(&q->cv, &q->lock);
+    int met = cond(q, arg);
+    pthread_mutex_unlock(&q->lock);
+    if (met)
+      return;
+
+    mtx_future_t *f = take_job(q, q->num_workers);
+    if (f)
+      run_job(q, f, q->num_workers);
+  }
+}
+
+static int queue_idle(mtx_queue_t *q, void *arg) {
+  (void)arg;
+  return q->active_head == NULL;
+}
+
+int mtx_queue_wait_all(mtx_queue_t *q) {
+  if (!q)
+    return -1;
+
+  help_until(q, queue_idle, NULL);
+  pthread_mutex_lock(&q->lock);
+  int rc = q->failed ? -1 : 0;
+  q->failed = 0;
+  pthread_mutex_unlock(&q->lock);
+  return rc;
+}
+
+// Whether `later` must wait for `earlier`: read-after-write,
+// write-after-read or write-after-write on overlapping memory.
+static int conflicts(const mtx_future_t *earlier, const mtx_future_t *later) {
+  for (size_t i = 0; i < later->nwrites; ++i) {
+    for (size_t j = 0; j < earlier->nwrites; ++j) {
+      if (mtx_overlaps(later->writes[i], earlier->writes[j]))
+        return 1;
+    }
+    for (size_t j = 0; j < earlier->nreads; ++j) {
+      if (mtx_overlaps(later->writes[i], earlier->reads[j]))
+        return 1;
+    }
+  }
+  for (size_t i = 0; i < later->nreads; ++i) {
+    for (size_t j = 0; j < earlier->nwrites; ++j) {
+      if (mtx_overlaps(later->reads[i], earlier->writes[j]))
+        return 1;
+    }
+  }
+  return 0;
+}
+
+static int reserve_succ(mtx_future_t *f) {
+  if (f->nsucc < f->succ_cap)
+    return 0;
+  size_t cap = f->succ_cap ? 2 * f->succ_cap : 4;
+  mtx_future_t **succ =
+      (mtx_future_t **)realloc(f->succ, cap * sizeof(mtx_future_t *));
+  if (!succ)
+    return -1;
+  f->succ = succ;
+  f->succ_cap = cap;
+  return 0;
+}
+
+static mtx_future_t *future_new(mtx_queue_t *q, mtx_task_fn fn, void *ctx,
+                                const matrix_t *const *reads, size_t nreads,
+                                matrix_t *const *writes, size_t nwrites) {
+  if (!q || !fn || nreads > MTX_ASYNC_MAX_OPERANDS ||
+      nwrites > MTX_ASYNC_MAX_OPERANDS)
+    return NULL;
+
+  mtx_future_t *f = (mtx_future_t *)calloc(1, sizeof(mtx_future_t));
+  if (!f)
+    return NULL;
+  f->q = q;
+  f->fn = fn;
+  f->ctx = ctx;
+  for (size_t i = 0; i < nreads; ++i) {
+    if (reads && reads[i])
+      f->reads[f->nreads++] = reads[i];
+  }
+  for (size_t i = 0; i < nwrites; ++i) {
+    if (writes && writes[i])
+      f->writes[f->nwrites++] = writes[i];
+  }
+  // One reference for the caller, one for the queue until completion.
+  f->refs = 2;
+  return f;
+}
+
+// Whether e is a job of q that has not completed. Called with the queue
+// lock held.
+static int pending_in(const mtx_queue_t *q, const mtx_future_t *e) {
+  return e && e->q == q && !e->done;
+}
+
+static int link_after(mtx_future_t *e, mtx_future_t *f) {
+  if (reserve_succ(e) != 0)
+    return -1;
+  e->succ[e->nsucc++] = f;
+  f->deps++;
+  return 0;
+}
+
+// Links f after its explicit predecessors `after`, or when there are none,
+// after every conflicting active job, and queues it once it has none left.
+// Frees f and returns NULL when memory runs out.
+static mtx_future_t *enqueue(mtx_queue_t *q, mtx_future_t *f,
+                             mtx_future_t *const *after, size_t nafter) {
+  pthread_mutex_lock(&q->lock);
+  if (after) {
+    for (size_t i = 0; i < nafter; ++i) {
+      if (pending_in(q, after[i]) && link_after(after[i], f) != 0) {
+        // Edges were appended last, so dropping them unwinds in reverse.
+        while (i-- > 0) {
+          if (pending_in(q, after[i]))
+            after[i]->nsucc--;
+        }
+        pthread_mutex_unlock(&q->lock);
+        free(f);
+        return NULL;
+      }
+    }
+  } else {
+    // Make room on every predecessor before linking any, so a failed
+    // allocation leaves the graph untouched.
+    for (mtx_future_t *e = q->active_head; e; e = e->next) {
+      if (conflicts(e, f) && reserve_succ(e) != 0) {
+        pthread_mutex_unlock(&q->lock);
+        free(f);
+        return NULL;
+      }
+    }
+    for (mtx_future_t *e = q->active_head; e; e = e->next) {
+      if (conflicts(e, f))
+        link_after(e, f);
+    }
+  }
+
+  f->prev = q->active_tail;
+  if (q->active_tail)
+    q->active_tail->next = f;
+  else
+    q->active_head = f;
+  q->active_tail = f;
+
+  int rc = 0;
+  if (f->deps == 0)
+    rc = push_ready(q, q->num_workers, f);
+  pthread_mutex_unlock(&q->lock);
+  if (rc != 0)
+    run_job(q, f, q->num_workers);
+  return f;
+}
+
+mtx_future_t *mtx_async_call(mtx_queue_t *q, mtx_task_fn fn, void *ctx,
+                             const matrix_t *const *reads, size_t nreads,
+                             matrix_t *const *writes, size_t nwrites) {
+  mtx_future_t *f = future_new(q, fn, ctx, reads, nreads, writes, nwrites);
+  return f ? enqueue(q, f, NULL, 0) : NULL;
+}
+
+mtx_future_t *mtx_async_after(mtx_queue_t *q, mtx_task_fn fn, void *ctx,
+                              mtx_future_t *const *after, size_t nafter) {
+  if (nafter > 0 && !after)
+    return NULL;
+  mtx_future_t *f = future_new(q, fn, ctx, NULL, 0, NULL, 0);
+  if (!f)
+    return NULL;
+  // An empty list still opts out of the operand scan.
+  static mtx_future_t *const none[1] = {NULL};
+  return enqueue(q, f, nafter ? after : none, nafter);
+}
+
+// Built-in jobs keep their arguments in the future itself.
+static int run_mul3(void *ctx) {
+  mtx_future_t *f = (mtx_future_t *)ctx;
+  return mtx_mul3((matrix_t *)f->arg[0], (const matrix_t *)f->arg[1],
+                  (const matrix_t *)f->arg[2]);
+}
+
+static int run_inverse(void *ctx) {
+  mtx_future_t *f = (mtx_future_t *)ctx;
+  return mtx_inverse((const matrix_t *)f->arg[0], (matrix_t *)f->arg[1]);
+}
+
+static int run_exp(void *ctx) {
+  mtx_future_t *f = (mtx_future_t *)ctx;
+  return mtx_exp((const matrix_t *)f->arg[0], (matrix_t *)f->arg[1]);
+}
+
+static int run_solve(void *ctx) {
+  mtx_future_t *f = (mtx_future_t *)ctx;
+  return mtx_solve((const matrix_t *)f->arg[0], (const matrix_t *)f->arg[1],
+                   (matrix_t *)f->arg[2]);
+}
+
+static mtx_future_t *submit_op(mtx_queue_t *q, mtx_task_fn fn,
+                               const matrix_t *in0, const matrix_t *in1,
+                               matrix_t *out, void *a0, void *a1, void *a2) {
+  if (!in0 || !out)
+    return NULL;
+  const matrix_t *reads[2] = {in0, in1};
+  mtx_future_t *f = future_new(q, fn, NULL, reads, 2, &out, 1);
+  if (!f)
+    return NULL;
+  f->ctx = f;
+  f->arg[0] = a0;
+  f->arg[1] = a1;
+  f->arg[2] = a2;
+  return enqueue(q, f, NULL, 0);
+}
+
+mtx_future_t *mtx_async_mul3(mtx_queue_t *q, matrix_t *result,
+                             const matrix_t *m1, const matrix_t *m2) {
+  if (!m2)
+    return NULL;
+  return submit_op(q, run_mul3, m1, m2, result, result, (void *)m1,
+                   (void *)m2);
+}
+
+mtx_future_t *mtx_async_inverse(mtx_queue_t *q, const matrix_t *m,
+                                matrix_t *inv) {
+  return submit_op(q, run_inverse, m, NULL, inv, (void *)m, inv, NULL);
+}
+
+mtx_future_t *mtx_async_exp(mtx_queue_t *q, const matrix_t *m,
+                            matrix_t *result) {
+  return submit_op(q, run_exp, m, NULL, result, (void *)m, result, NULL);
+}
+
+mtx_future_t *mtx_async_solve(mtx_queue_t *q, const matrix_t *a,
+                              const matrix_t *b, matrix_t *x) {
+  if (!b)
+    return NULL;
+  // x may be b itself; the write to x already orders it against b's
+  // readers and writers.
+  return submit_op(q, run_solve, a, x == b ? NULL : b, x, (void *)a,
+                   (void *)b, x);
+}
+
+int mtx_future_poll(const mtx_future_t *f) {
+  return f && __atomic_load_n(&f->done, __ATOMIC_ACQUIRE);
+}
+
+static int future_done(mtx_queue_t *q, void *arg) {
+  (void)q;
+  return mtx_future_poll((const mtx_future_t *)arg);
+}
+
+int mtx_future_wait(mtx_future_t *f) {
+  if (!f)
+    return -1;
+  if (!mtx_future_poll(f))
+    help_until(f->q, future_done, f);
+  return f->rc;
+}
+
+void mtx_future_retain(mtx_future_t *f) {
+  if (f)
+    __atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+}
+
+void mtx_future_release(mtx_future_t *f) {
+  if (f)
+    future_unref(f);
+}
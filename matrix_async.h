@@ -0,0 +1,66 @@
+#ifndef MATRIX_ASYNC_H
+#define MATRIX_ASYNC_H
+
+#include "matrix.h"
+
+#define MTX_ASYNC_MAX_OPERANDS 8
+
+typedef struct mtx_queue mtx_queue_t;
+typedef struct mtx_future mtx_future_t;
+
+typedef int (*mtx_task_fn)(void *ctx);
+
+// Queue of matrix operations run by its own worker threads. Each worker
+// keeps a deque of ready jobs, takes the newest from its own, and steals
+// the oldest from the others when it runs dry. 0 workers means
+// mtx_get_num_threads(). A job that gets the library pool for its
+// mtx_parallel_for regions splits across it; jobs running alongside it
+// stay serial, as with any concurrent callers.
+mtx_queue_t *mtx_queue_create(size_t workers);
+// Waits for every submitted job, then stops the workers. Futures stay valid
+// until released.
+void mtx_queue_destroy(mtx_queue_t *q);
+// Waits for every job submitted so far. Returns -1 if any job failed since
+// the previous call.
+int mtx_queue_wait_all(mtx_queue_t *q);
+
+// Submission returns at once, or NULL when out of memory. Each job is
+// ordered after every earlier unfinished job that writes memory it reads,
+// or reads or writes memory it writes (mtx_overlaps, so views of one parent
+// only conflict when their blocks intersect). Operands must stay allocated
+// and must not be touched by the caller until the job completes. A failed
+// job still releases the jobs behind it; check each future, or
+// mtx_queue_wait_all, for errors.
+mtx_future_t *mtx_async_mul3(mtx_queue_t *q, matrix_t *result,
+                             const matrix_t *m1, const matrix_t *m2);
+mtx_future_t *mtx_async_inverse(mtx_queue_t *q, const matrix_t *m,
+                                matrix_t *inv);
+mtx_future_t *mtx_async_exp(mtx_queue_t *q, const matrix_t *m,
+                            matrix_t *result);
+mtx_future_t *mtx_async_solve(mtx_queue_t *q, const matrix_t *a,
+                              const matrix_t *b, matrix_t *x);
+// Any other operation: fn(ctx) returning 0 or -1, with the operands it
+// reads and writes declared for ordering (at most MTX_ASYNC_MAX_OPERANDS
+// of each).
+mtx_future_t *mtx_async_call(mtx_queue_t *q, mtx_task_fn fn, void *ctx,
+                             const matrix_t *const *reads, size_t nreads,
+                             matrix_t *const *writes, size_t nwrites);
+// fn(ctx) ordered only after the listed futures of this queue (NULL
+// entries and completed jobs are skipped). No operands are tracked, and
+// operand-tracked jobs are not ordered against it; callers that build
+// their own dependency graphs, such as matrix_tile.h, use this.
+mtx_future_t *mtx_async_after(mtx_queue_t *q, mtx_task_fn fn, void *ctx,
+                              mtx_future_t *const *after, size_t nafter);
+
+// 1 once the job has completed, 0 before.
+int mtx_future_poll(const mtx_future_t *f);
+// Blocks until the job completes and returns its result. The waiting thread
+// runs ready jobs meanwhile, so a job may wait on an earlier one without
+// tying up its worker.
+int mtx_future_wait(mtx_future_t *f);
+// Takes another handle on f, released separately.
+void mtx_future_retain(mtx_future_t *f);
+// Drops the caller's handle; a pending job still runs.
+void mtx_future_release(mtx_future_t *f);
+
+#endif // MATRIX_ASYNC_H
@@ -0,0 +1,447 @@
+#include "matrix_batch.h"
+#include "matrix.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MTX_SIMD_X86 1
+#endif
+
+#define L MTX_BATCH_LANES
+
+typedef void (*batch_mul_fn)(const double *a, const double *b, double *c,
+                             size_t m, size_t k, size_t n);
+typedef unsigned (*batch_solve_fn)(double *w, double *r, size_t n, size_t m);
+
+// Offset of element (i, j) of an interleaved group with `cols` columns.
+#define AT(i, j, cols) (((i) * (cols) + (j)) * L)
+
+mtx_batch_t *mtx_batch_alloc(size_t count, size_t rows, size_t cols) {
+  if (count == 0 || rows == 0 || cols == 0)
+    return NULL;
+
+  mtx_batch_t *b = (mtx_batch_t *)malloc(sizeof(mtx_batch_t));
+  if (!b)
+    return NULL;
+
+  b->count = count;
+  b->rows = rows;
+  b->cols = cols;
+  b->groups = (count + L - 1) / L;
+  b->data = mtx_alloc_buffer(b->groups, rows * cols * L);
+  if (!b->data) {
+    free(b);
+    return NULL;
+  }
+  return b;
+}
+
+void mtx_batch_free(mtx_batch_t *b) {
+  if (b) {
+    free(b->data);
+    free(b);
+  }
+}
+
+static size_t group_size(const mtx_batch_t *b) { return b->rows * b->cols * L; }
+
+int mtx_batch_set(mtx_batch_t *b, size_t idx, const matrix_t *m) {
+  if (!b || !m || !m->data || idx >= b->count)
+    return -1;
+  if (m->rows != b->rows || m->cols != b->cols)
+    return -1;
+
+  for (size_t i = 0; i < b->rows; ++i) {
+    const double *row = mtx_crow(m, i);
+    for (size_t j = 0; j < b->cols; ++j) {
+      *mtx_batch_at(b, idx, i, j) = row[j];
+    }
+  }
+  return 0;
+}
+
+int mtx_batch_get(const mtx_batch_t *b, size_t idx, matrix_t *m) {
+  if (!b || !m || !m->data || idx >= b->count)
+    return -1;
+  if (m->rows != b->rows || m->cols != b->cols)
+    return -1;
+
+  for (size_t i = 0; i < b->rows; ++i) {
+    double *row = mtx_row(m, i);
+    for (size_t j = 0; j < b->cols; ++j) {
+      row[j] = *mtx_batch_at((mtx_batch_t *)b, idx, i, j);
+    }
+  }
+  return 0;
+}
+
+int mtx_batch_pack(mtx_batch_t *b, const matrix_t *const *ms) {
+  if (!b || !ms)
+    return -1;
+  for (size_t idx = 0; idx < b->count; ++idx) {
+    if (mtx_batch_set(b, idx, ms[idx]) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+int mtx_batch_unpack(const mtx_batch_t *b, matrix_t *const *ms) {
+  if (!b || !ms)
+    return -1;
+  for (size_t idx = 0; idx < b->count; ++idx) {
+    if (mtx_batch_get(b, idx, ms[idx]) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+int mtx_batch_pack_strided(mtx_batch_t *b, const double *src, size_t stride) {
+  if (!b || !src || stride < b->rows * b->cols)
+    return -1;
+
+  size_t elems = b->rows * b->cols;
+  for (size_t idx = 0; idx < b->count; ++idx) {
+    double *g = b->data + idx / L * group_size(b) + idx % L;
+    const double *m = src + idx * stride;
+    for (size_t e = 0; e < elems; ++e) {
+      g[e * L] = m[e];
+    }
+  }
+  return 0;
+}
+
+int mtx_batch_unpack_strided(const mtx_batch_t *b, double *dst,
+                             size_t stride) {
+  if (!b || !dst || stride < b->rows * b->cols)
+    return -1;
+
+  size_t elems = b->rows * b->cols;
+  for (size_t idx = 0; idx < b->count; ++idx) {
+    const double *g = b->data + idx / L * group_size(b) + idx % L;
+    double *m = dst + idx * stride;
+    for (size_t e = 0; e < elems; ++e) {
+      m[e] = g[e * L];
+    }
+  }
+  return 0;
+}
+
+typedef struct {
+  batch_mul_fn mul[MTX_BATCH_MAX_UNROLLED + 1];
+  batch_solve_fn solve[MTX_BATCH_MAX_UNROLLED + 1];
+  batch_mul_fn mul_any;
+  batch_solve_fn solve_any;
+} batch_kernels_t;
+
+// Kernels are instantiated per square size, with the size a constant so the
+// loops over it unroll, and per instruction set, so that each group entry is
+// a few full-width registers.
+#define BATCH_SIZES(X)                                                         \
+  X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14)  \
+      X(15) X(16)
+#define BATCH_PASTE2(a, b) a##_##b
+#define BATCH_PASTE(a, b) BATCH_PASTE2(a, b)
+#define BATCH_FN(name) BATCH_PASTE(name, BATCH_ISA)
+#define BATCH_FN_N(name, N) BATCH_PASTE(BATCH_FN(name), N)
+
+typedef double vec2_t __attribute__((vector_size(16)));
+typedef int64_t mask2_t __attribute__((vector_size(16)));
+#define BATCH_ISA base
+#define BATCH_ATTR
+#define BATCH_VEC vec2_t
+#define BATCH_MASK mask2_t
+#include "matrix_batch_kernels.h"
+#undef BATCH_ISA
+#undef BATCH_ATTR
+#undef BATCH_VEC
+#undef BATCH_MASK
+
+#ifdef MTX_SIMD_X86
+typedef double vec4_t __attribute__((vector_size(32)));
+typedef int64_t mask4_t __attribute__((vector_size(32)));
+#define BATCH_ISA avx2
+#define BATCH_ATTR __attribute__((target("avx2,fma")))
+#define BATCH_VEC vec4_t
+#define BATCH_MASK mask4_t
+#include "matrix_batch_kernels.h"
+#undef BATCH_ISA
+#undef BATCH_ATTR
+#undef BATCH_VEC
+#undef BATCH_MASK
+
+typedef double vec8_t __attribute__((vector_size(64)));
+typedef int64_t mask8_t __attribute__((vector_size(64)));
+#define BATCH_ISA avx512
+#define BATCH_ATTR __attribute__((target("avx512f")))
+#define BATCH_VEC vec8_t
+#define BATCH_MASK mask8_t
+#include "matrix_batch_kernels.h"
+#undef BATCH_ISA
+#undef BATCH_ATTR
+#undef BATCH_VEC
+#undef BATCH_MASK
+#endif // MTX_SIMD_X86
+
+static const batch_kernels_t *batch_kernels(void) {
+#ifdef MTX_SIMD_X86
+  mtx_simd_level_t level = mtx_simd_ops()->level;
+  if (level >= MTX_SIMD_AVX512)
+    return &kernels_avx512;
+  if (level >= MTX_SIMD_AVX2)
+    return &kernels_avx2;
+#endif
+  return &kernels_base;
+}
+
+static batch_mul_fn mul_kernel(size_t m, size_t k, size_t n) {
+  const batch_kernels_t *kernels = batch_kernels();
+  if (m == k && k == n && n <= MTX_BATCH_MAX_UNROLLED)
+    return kernels->mul[n];
+  return kernels->mul_any;
+}
+
+static batch_solve_fn solve_kernel(size_t n) {
+  const batch_kernels_t *kernels = batch_kernels();
+  return n <= MTX_BATCH_MAX_UNROLLED ? kernels->solve[n]
+                                     : kernels->solve_any;
+}
+
+static const double pade13[] = {64764752532480000.0,
+                                32382376266240000.0,
+                                7771770303897600.0,
+                                1187353796428800.0,
+                                129060195264000.0,
+                                10559470521600.0,
+                                670442572800.0,
+                                33522128640.0,
+                                1323241920.0,
+                                40840800.0,
+                                960960.0,
+                                16380.0,
+                                182.0,
+                                1.0};
+static const double pade13_theta = 5.371920351148152;
+
+#define EXP_BUFFERS 8
+
+// dst = c1 * x1 + c2 * x2 + c3 * x3 + c0 * I over one n x n group.
+static void comb_group(double *dst, size_t n, double c0, double c1,
+                       const double *x1, double c2, const double *x2,
+                       double c3, const double *x3) {
+  for (size_t e = 0; e < n * n * L; ++e) {
+    dst[e] = c1 * x1[e] + c2 * x2[e] + c3 * x3[e];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t l = 0; l < L; ++l) {
+      dst[AT(i, i, n) + l] += c0;
+    }
+  }
+}
+
+// Pade(13) with per-lane scaling and squaring; lanes that need fewer
+// squarings keep their value while the others continue.
+static unsigned exp_group(const double *a, double *r, size_t n,
+                          double *scratch) {
+  size_t sz = n * n * L;
+  double *x = scratch, *x2 = x + sz, *x4 = x2 + sz, *x6 = x4 + sz;
+  double *u = x6 + sz, *v = u + sz, *t = v + sz, *w = t + sz;
+  batch_mul_fn mul = mul_kernel(n, n, n);
+  const double *b = pade13;
+  unsigned bad = 0;
+  int s[L], max_s = 0;
+
+  memcpy(x, a, sz * sizeof(double));
+  for (size_t l = 0; l < L; ++l) {
+    double norm = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+      double sum = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        sum += fabs(x[AT(i, j, n) + l]);
+      }
+      norm = sum > norm ? sum : norm;
+    }
+    s[l] = 0;
+    if (!isfinite(norm))
+      bad |= 1u << l;
+    else if (norm > pade13_theta)
+      s[l] = (int)ceil(log2(norm / pade13_theta));
+    max_s = s[l] > max_s ? s[l] : max_s;
+  }
+
+  double f[L];
+  for (size_t l = 0; l < L; ++l) {
+    f[l] = ldexp(1.0, -s[l]);
+  }
+  for (size_t e = 0; e < n * n; ++e) {
+    for (size_t l = 0; l < L; ++l) {
+      x[e * L + l] *= f[l];
+    }
+  }
+
+  mul(x, x, x2, n, n, n);
+  mul(x2, x2, x4, n, n, n);
+  mul(x4, x2, x6, n, n, n);
+
+  comb_group(t, n, 0.0, b[13], x6, b[11], x4, b[9], x2);
+  mul(x6, t, u, n, n, n);
+  comb_group(t, n, b[1], b[7], x6, b[5], x4, b[3], x2);
+  for (size_t e = 0; e < sz; ++e) {
+    t[e] += u[e];
+  }
+  mul(x, t, u, n, n, n);
+
+  comb_group(t, n, 0.0, b[12], x6, b[10], x4, b[8], x2);
+  mul(x6, t, v, n, n, n);
+  comb_group(t, n, b[0], b[6], x6, b[4], x4, b[2], x2);
+
+  // exp(A) ~ (V - U)^-1 (V + U).
+  for (size_t e = 0; e < sz; ++e) {
+    double ve = v[e] + t[e];
+    r[e] = ve + u[e];
+    w[e] = ve - u[e];
+  }
+  bad |= solve_kernel(n)(w, r, n, n);
+
+  for (int k = 0; k < max_s; ++k) {
+    mul(r, r, t, n, n, n);
+    for (size_t e = 0; e < n * n; ++e) {
+      for (size_t l = 0; l < L; ++l) {
+        if (k < s[l])
+          r[e * L + l] = t[e * L + l];
+      }
+    }
+  }
+  return bad;
+}
+
+typedef enum { BATCH_MUL, BATCH_INVERSE, BATCH_SOLVE, BATCH_EXP } batch_op_t;
+
+typedef struct {
+  batch_op_t op;
+  const mtx_batch_t *a;
+  const mtx_batch_t *b;
+  mtx_batch_t *out;
+  int failed;
+  pthread_mutex_t lock;
+} batch_job_t;
+
+static void batch_range(void *ctx, size_t begin, size_t end) {
+  batch_job_t *job = (batch_job_t *)ctx;
+  const mtx_batch_t *a = job->a;
+  mtx_batch_t *out = job->out;
+  size_t n = a->rows, asz = group_size(a), osz = group_size(out);
+  double *scratch = NULL;
+  int failed = 0;
+
+  if (job->op != BATCH_MUL) {
+    size_t count = job->op == BATCH_EXP ? EXP_BUFFERS * asz : asz;
+    scratch = mtx_alloc_buffer(1, count);
+    if (!scratch)
+      failed = 1;
+  }
+
+  for (size_t g = begin; g < end && !failed; ++g) {
+    const double *ag = a->data + g * asz;
+    double *og = out->data + g * osz;
+    size_t lanes = a->count - g * L < L ? a->count - g * L : L;
+    unsigned valid = (1u << lanes) - 1, bad = 0;
+
+    switch (job->op) {
+    case BATCH_MUL: {
+      const mtx_batch_t *b = job->b;
+      mul_kernel(a->rows, a->cols, b->cols)(ag, b->data + g * group_size(b),
+                                            og, a->rows, a->cols, b->cols);
+      break;
+    }
+    case BATCH_INVERSE:
+      memcpy(scratch, ag, asz * sizeof(double));
+      memset(og, 0, osz * sizeof(double));
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t l = 0; l < L; ++l) {
+          og[AT(i, i, n) + l] = 1.0;
+        }
+      }
+      bad = solve_kernel(n)(scratch, og, n, n);
+      break;
+    case BATCH_SOLVE:
+      memcpy(scratch, ag, asz * sizeof(double));
+      bad = solve_kernel(n)(scratch, og, n, out->cols);
+      break;
+    case BATCH_EXP:
+      bad = exp_group(ag, og, n, scratch);
+      break;
+    }
+    if (bad & valid)
+      failed = 1;
+  }
+
+  free(scratch);
+  if (failed) {
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_mutex_unlock(&job->lock);
+  }
+}
+
+static int batch_run(batch_op_t op, const mtx_batch_t *a, const mtx_batch_t *b,
+                     mtx_batch_t *out) {
+  batch_job_t job = {op, a, b, out, 0, PTHREAD_MUTEX_INITIALIZER};
+  size_t n = a->rows;
+  size_t work = n * n * (op == BATCH_MUL || op == BATCH_SOLVE ? out->cols : n) * L;
+  size_t grain = work >= MTX_PARALLEL_MIN_ELEMENTS
+                     ? 1
+                     : MTX_PARALLEL_MIN_ELEMENTS / work;
+  mtx_parallel_for(a->groups, grain, batch_range, &job);
+  pthread_mutex_destroy(&job.lock);
+  return job.failed ? -1 : 0;
+}
+
+int mtx_batch_mul(mtx_batch_t *c, const mtx_batch_t *a, const mtx_batch_t *b) {
+  if (!c || !a || !b)
+    return -1;
+  if (a->count != b->count || a->count != c->count)
+    return -1;
+  if (a->cols != b->rows || c->rows != a->rows || c->cols != b->cols)
+    return -1;
+  if (c == a || c == b)
+    return -1;
+
+  return batch_run(BATCH_MUL, a, b, c);
+}
+
+int mtx_batch_inverse(const mtx_batch_t *a, mtx_batch_t *inv) {
+  if (!a || !inv)
+    return -1;
+  if (a->count != inv->count || a->rows != a->cols || inv->rows != a->rows ||
+      inv->cols != a->cols)
+    return -1;
+
+  return batch_run(BATCH_INVERSE, a, NULL, inv);
+}
+
+int mtx_batch_solve(const mtx_batch_t *a, mtx_batch_t *b) {
+  if (!a || !b)
+    return -1;
+  if (a->count != b->count || a->rows != a->cols || b->rows != a->rows)
+    return -1;
+  if (a == b)
+    return -1;
+
+  return batch_run(BATCH_SOLVE, a, NULL, b);
+}
+
+int mtx_batch_exp(const mtx_batch_t *a, mtx_batch_t *result) {
+  if (!a || !result)
+    return -1;
+  if (a->count != result->count || a->rows != a->cols ||
+      result->rows != a->rows || result->cols != a->cols)
+    return -1;
+
+  return batch_run(BATCH_EXP, a, NULL, result);
+}
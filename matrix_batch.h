@@ -0,0 +1,48 @@
+#ifndef MATRIX_BATCH_H
+#define MATRIX_BATCH_H
+
+#include "matrix.h"
+
+// Matrices are grouped MTX_BATCH_LANES at a time and interleaved element by
+// element, so one SIMD register holds the same entry of a whole group.
+#define MTX_BATCH_LANES 8
+// Square sizes up to this one get kernels specialized for their size.
+#define MTX_BATCH_MAX_UNROLLED 16
+
+typedef struct {
+  size_t count;
+  size_t rows;
+  size_t cols;
+  size_t groups;
+  double *data;
+} mtx_batch_t;
+
+mtx_batch_t *mtx_batch_alloc(size_t count, size_t rows, size_t cols);
+void mtx_batch_free(mtx_batch_t *b);
+
+static inline double *mtx_batch_at(mtx_batch_t *b, size_t idx, size_t i,
+                                   size_t j) {
+  size_t g = idx / MTX_BATCH_LANES, l = idx % MTX_BATCH_LANES;
+  return b->data + ((g * b->rows + i) * b->cols + j) * MTX_BATCH_LANES + l;
+}
+
+// Copy between the interleaved layout and ordinary matrices: one matrix, a
+// pointer array of b->count matrices, or b->count packed row-major matrices
+// `stride` doubles apart.
+int mtx_batch_set(mtx_batch_t *b, size_t idx, const matrix_t *m);
+int mtx_batch_get(const mtx_batch_t *b, size_t idx, matrix_t *m);
+int mtx_batch_pack(mtx_batch_t *b, const matrix_t *const *ms);
+int mtx_batch_unpack(const mtx_batch_t *b, matrix_t *const *ms);
+int mtx_batch_pack_strided(mtx_batch_t *b, const double *src, size_t stride);
+int mtx_batch_unpack_strided(const mtx_batch_t *b, double *dst,
+                             size_t stride);
+
+// Per-matrix c = a * b, inv = a^-1, b = a^-1 * b and result = exp(a).
+// Return -1 on mismatched batches or when any matrix is singular; the other
+// matrices are still computed.
+int mtx_batch_mul(mtx_batch_t *c, const mtx_batch_t *a, const mtx_batch_t *b);
+int mtx_batch_inverse(const mtx_batch_t *a, mtx_batch_t *inv);
+int mtx_batch_solve(const mtx_batch_t *a, mtx_batch_t *b);
+int mtx_batch_exp(const mtx_batch_t *a, mtx_batch_t *result);
+
+#endif // MATRIX_BATCH_H
@@ -0,0 +1,147 @@
+// Batched group kernels for one instruction set. matrix_batch.c includes
+// this file once per set, defining BATCH_ISA (name suffix), BATCH_ATTR
+// (function attributes), and BATCH_VEC / BATCH_MASK (the widest native
+// double and int64 vectors). Each group entry is CH such vectors.
+
+#define CH (MTX_BATCH_LANES * sizeof(double) / sizeof(BATCH_VEC))
+#define VW (sizeof(BATCH_VEC) / sizeof(double))
+#define SELECT(m, a, b)                                                        \
+  ((BATCH_VEC)(((BATCH_MASK)(a) & (m)) | ((BATCH_MASK)(b) & ~(m))))
+#define ABS(v) ((BATCH_VEC)((BATCH_MASK)(v) & INT64_MAX))
+
+// c = a * b for one group.
+static inline __attribute__((always_inline)) BATCH_ATTR void
+BATCH_FN(mul_group)(const double *restrict a, const double *restrict b,
+                    double *restrict c, size_t m, size_t k, size_t n) {
+  const BATCH_VEC *va = (const BATCH_VEC *)a, *vb = (const BATCH_VEC *)b;
+  BATCH_VEC *vc = (BATCH_VEC *)c;
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      BATCH_VEC acc[CH];
+      for (size_t h = 0; h < CH; ++h) {
+        acc[h] = va[(i * k) * CH + h] * vb[j * CH + h];
+      }
+      for (size_t p = 1; p < k; ++p) {
+        for (size_t h = 0; h < CH; ++h) {
+          acc[h] += va[(i * k + p) * CH + h] * vb[(p * n + j) * CH + h];
+        }
+      }
+      for (size_t h = 0; h < CH; ++h) {
+        vc[(i * n + j) * CH + h] = acc[h];
+      }
+    }
+  }
+}
+
+// Gauss-Jordan with per-lane partial pivoting: r = w^-1 * r for an n x n w
+// and n x m r, destroying w. Pivot rows are swapped in with lane masks so
+// every operation still covers the whole group. Returns a bit mask of the
+// lanes that met a pivot below EPSILON, the dense LU's singularity test.
+static inline __attribute__((always_inline)) BATCH_ATTR unsigned
+BATCH_FN(solve_group)(double *restrict w, double *restrict r, size_t n,
+                      size_t m) {
+  BATCH_VEC *vw = (BATCH_VEC *)w, *vr = (BATCH_VEC *)r;
+  unsigned singular = 0;
+  for (size_t k = 0; k < n; ++k) {
+    for (size_t h = 0; h < CH; ++h) {
+      BATCH_VEC best = ABS(vw[(k * n + k) * CH + h]);
+      BATCH_MASK p = (BATCH_MASK){0} + (int64_t)k;
+      for (size_t i = k + 1; i < n; ++i) {
+        BATCH_VEC v = ABS(vw[(i * n + k) * CH + h]);
+        BATCH_MASK gt = (BATCH_MASK)(v > best);
+        best = SELECT(gt, v, best);
+        p = (gt & (int64_t)i) | (p & ~gt);
+      }
+      BATCH_MASK tiny = (BATCH_MASK)(best < EPSILON);
+      for (size_t l = 0; l < VW; ++l) {
+        if (tiny[l])
+          singular |= 1u << (h * VW + l);
+      }
+
+      for (size_t i = k + 1; i < n; ++i) {
+        BATCH_MASK sel = (BATCH_MASK)(p == (int64_t)i);
+        int any = 0;
+        for (size_t l = 0; l < VW; ++l) {
+          any |= sel[l] != 0;
+        }
+        if (!any)
+          continue;
+        for (size_t j = k; j < n; ++j) {
+          BATCH_VEC x = vw[(k * n + j) * CH + h], y = vw[(i * n + j) * CH + h];
+          vw[(k * n + j) * CH + h] = SELECT(sel, y, x);
+          vw[(i * n + j) * CH + h] = SELECT(sel, x, y);
+        }
+        for (size_t j = 0; j < m; ++j) {
+          BATCH_VEC x = vr[(k * m + j) * CH + h], y = vr[(i * m + j) * CH + h];
+          vr[(k * m + j) * CH + h] = SELECT(sel, y, x);
+          vr[(i * m + j) * CH + h] = SELECT(sel, x, y);
+        }
+      }
+
+      BATCH_VEC d = 1.0 / vw[(k * n + k) * CH + h];
+      for (size_t j = k; j < n; ++j) {
+        vw[(k * n + j) * CH + h] *= d;
+      }
+      for (size_t j = 0; j < m; ++j) {
+        vr[(k * m + j) * CH + h] *= d;
+      }
+
+      for (size_t i = 0; i < n; ++i) {
+        if (i == k)
+          continue;
+        BATCH_VEC f = vw[(i * n + k) * CH + h];
+        for (size_t j = k; j < n; ++j) {
+          vw[(i * n + j) * CH + h] -= f * vw[(k * n + j) * CH + h];
+        }
+        for (size_t j = 0; j < m; ++j) {
+          vr[(i * m + j) * CH + h] -= f * vr[(k * m + j) * CH + h];
+        }
+      }
+    }
+  }
+  return singular;
+}
+
+#define BATCH_DEFINE_SIZE(N)                                                   \
+  static BATCH_ATTR void BATCH_FN_N(mul, N)(const double *a, const double *b, \
+                                            double *c, size_t m, size_t k,     \
+                                            size_t n) {                        \
+    (void)m;                                                                   \
+    (void)k;                                                                   \
+    (void)n;                                                                   \
+    BATCH_FN(mul_group)(a, b, c, N, N, N);                                     \
+  }                                                                            \
+  static BATCH_ATTR unsigned BATCH_FN_N(solve, N)(double *w, double *r,        \
+                                                  size_t n, size_t m) {        \
+    (void)n;                                                                   \
+    return BATCH_FN(solve_group)(w, r, N, m);                                  \
+  }
+#define BATCH_MUL_ENTRY(N) BATCH_FN_N(mul, N),
+#define BATCH_SOLVE_ENTRY(N) BATCH_FN_N(solve, N),
+
+BATCH_SIZES(BATCH_DEFINE_SIZE)
+
+static BATCH_ATTR void BATCH_FN(mul_any)(const double *a, const double *b,
+                                         double *c, size_t m, size_t k,
+                                         size_t n) {
+  BATCH_FN(mul_group)(a, b, c, m, k, n);
+}
+
+static BATCH_ATTR unsigned BATCH_FN(solve_any)(double *w, double *r, size_t n,
+                                               size_t m) {
+  return BATCH_FN(solve_group)(w, r, n, m);
+}
+
+static const batch_kernels_t BATCH_FN(kernels) = {
+    {NULL, BATCH_SIZES(BATCH_MUL_ENTRY)},
+    {NULL, BATCH_SIZES(BATCH_SOLVE_ENTRY)},
+    BATCH_FN(mul_any),
+    BATCH_FN(solve_any)};
+
+#undef CH
+#undef VW
+#undef SELECT
+#undef ABS
+#undef BATCH_DEFINE_SIZE
+#undef BATCH_MUL_ENTRY
+#undef BATCH_SOLVE_ENTRY
@@ -0,0 +1,321 @@
+#include "matrix_chol.h"
+#include "matrix_gemm.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MTX_CHOL_SOLVE_GRAIN 32
+#define MTX_CHOL_NARROW 8
+
+mtx_chol_t *mtx_chol_alloc(size_t n) {
+  if (n == 0)
+    return NULL;
+
+  mtx_chol_t *chol = (mtx_chol_t *)malloc(sizeof(mtx_chol_t));
+  if (!chol)
+    return NULL;
+
+  chol->n = n;
+  chol->l = mtx_alloc(n, n);
+  if (!chol->l) {
+    free(chol);
+    return NULL;
+  }
+
+  return chol;
+}
+
+void mtx_chol_free(mtx_chol_t *chol) {
+  if (chol) {
+    mtx_free(chol->l);
+    free(chol);
+  }
+}
+
+size_t mtx_chol_workspace_size(size_t n) {
+  return mtx_workspace_bytes(n * n * sizeof(double)) +
+         mtx_chol_decompose_workspace_size(n);
+}
+
+int mtx_chol_init_workspace(mtx_chol_t *chol, matrix_t *storage, size_t n,
+                            mtx_workspace_t *ws) {
+  if (!chol || !storage || n == 0)
+    return -1;
+  if (mtx_workspace_matrix(ws, n, n, storage) != 0)
+    return -1;
+
+  chol->n = n;
+  chol->l = storage;
+  return 0;
+}
+
+int mtx_is_symmetric(const matrix_t *m, double tol) {
+  if (!m || !m->data || m->rows != m->cols)
+    return 0;
+
+  for (size_t i = 1; i < m->rows; ++i) {
+    const double *row = mtx_crow(m, i);
+    for (size_t j = 0; j < i; ++j) {
+      double x = row[j], y = *mtx_cat(m, j, i);
+      if (fabs(x - y) > tol * (fabs(x) + fabs(y)))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+// dst -= alpha * src over w elements; short rows skip the dispatch call.
+static void row_update(double *dst, const double *src, double alpha, size_t w,
+                       const mtx_simd_ops_t *ops) {
+  if (w < MTX_CHOL_NARROW) {
+    for (size_t j = 0; j < w; ++j) {
+      dst[j] -= alpha * src[j];
+    }
+  } else {
+    ops->axpy(dst, src, -alpha, w);
+  }
+}
+
+static double dot(const double *x, const double *y, size_t n) {
+  double s = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+typedef struct {
+  double *a;
+  size_t lda;
+  size_t n;
+  size_t k0, kb;
+  // L21^T, kb x (n - k0 - kb), for the trailing update's GEMM.
+  double *panel;
+  // L11^T, kb x kb, so the panel solve walks rows instead of columns.
+  double *l11t;
+  size_t tasks;
+} chol_blocked_t;
+
+// Left-looking factorization of the kb x kb diagonal block at k0. d is the
+// pivot LU without row swaps would see; below EPSILON (or NaN), as in
+// mtx_lu_decompose, the matrix is singular or not positive definite.
+static int diagonal_factor(double *a, size_t lda, size_t k0, size_t kb) {
+  for (size_t j = k0; j < k0 + kb; ++j) {
+    double *rj = a + j * lda;
+    double d = rj[j] - dot(rj + k0, rj + k0, j - k0);
+    if (!(d >= EPSILON))
+      return -1;
+    rj[j] = sqrt(d);
+    for (size_t i = j + 1; i < k0 + kb; ++i) {
+      double *ri = a + i * lda;
+      ri[j] = (ri[j] - dot(ri + k0, rj + k0, j - k0)) / rj[j];
+    }
+  }
+  return 0;
+}
+
+// L21 = A21 * L11^-T one row at a time, also scattering each row into the
+// transposed panel.
+static void panel_rows(void *ctx, size_t begin, size_t end) {
+  chol_blocked_t *s = (chol_blocked_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t kb = s->kb, k1 = s->k0 + kb, ldp = s->n - k1;
+  for (size_t r = begin; r < end; ++r) {
+    double *x = s->a + (k1 + r) * s->lda + s->k0;
+    for (size_t j = 0; j < kb; ++j) {
+      const double *lt = s->l11t + j * kb;
+      x[j] /= lt[j];
+      row_update(x + j + 1, lt + j + 1, x[j], kb - j - 1, ops);
+      s->panel[j * ldp + r] = x[j];
+    }
+  }
+}
+
+// A22 -= L21 * L21^T on the lower triangle, MTX_CHOL_BLOCK columns per slab.
+// Slabs are dealt round-robin because the left ones reach more rows.
+static void trailing_slabs(void *ctx, size_t begin, size_t end) {
+  chol_blocked_t *s = (chol_blocked_t *)ctx;
+  size_t k0 = s->k0, k1 = s->k0 + s->kb, ldp = s->n - k1;
+  for (size_t t = begin; t < end; ++t) {
+    for (size_t c0 = k1 + t * MTX_CHOL_BLOCK; c0 < s->n;
+         c0 += s->tasks * MTX_CHOL_BLOCK) {
+      size_t c1 = s->n - c0 < MTX_CHOL_BLOCK ? s->n : c0 + MTX_CHOL_BLOCK;
+      mtx_gemm(s->n - c0, c1 - c0, s->kb, -1.0, s->a + c0 * s->lda + k0,
+               s->lda, s->panel + (c0 - k1), ldp, 1.0,
+               s->a + c0 * s->lda + c0, s->lda);
+    }
+  }
+}
+
+size_t mtx_chol_decompose_workspace_size(size_t n) {
+  return mtx_workspace_bytes(MTX_CHOL_BLOCK * n * sizeof(double)) +
+         mtx_workspace_bytes(MTX_CHOL_BLOCK * MTX_CHOL_BLOCK * sizeof(double));
+}
+
+int mtx_chol_decompose(matrix_t *m, mtx_workspace_t *ws) {
+  if (!m || !m->data || m->rows != m->cols)
+    return -1;
+
+  size_t n = m->rows;
+  // A non-positive diagonal entry already rules out positive definiteness.
+  for (size_t i = 0; i < n; ++i) {
+    if (!(*mtx_at(m, i, i) > 0.0))
+      return -1;
+  }
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_chol_decompose_workspace_size(n)) !=
+      0)
+    return -1;
+
+  chol_blocked_t s;
+  s.a = m->data;
+  s.lda = m->ld;
+  s.n = n;
+  s.panel = mtx_workspace_doubles(scratch.ws, MTX_CHOL_BLOCK * n);
+  s.l11t = mtx_workspace_doubles(scratch.ws, MTX_CHOL_BLOCK * MTX_CHOL_BLOCK);
+  int rc = 0;
+
+  for (s.k0 = 0; s.k0 < n && rc == 0; s.k0 += s.kb) {
+    s.kb = n - s.k0 < MTX_CHOL_BLOCK ? n - s.k0 : MTX_CHOL_BLOCK;
+    if (diagonal_factor(s.a, s.lda, s.k0, s.kb) != 0) {
+      rc = -1;
+      break;
+    }
+
+    size_t rest = n - s.k0 - s.kb;
+    if (rest == 0)
+      break;
+    for (size_t i = 0; i < s.kb; ++i) {
+      for (size_t j = 0; j <= i; ++j) {
+        s.l11t[j * s.kb + i] = *mtx_at(m, s.k0 + i, s.k0 + j);
+      }
+    }
+    size_t grain = MTX_PARALLEL_MIN_ELEMENTS / (s.kb * s.kb) + 1;
+    mtx_parallel_for(rest, grain, panel_rows, &s);
+
+    size_t slabs = (rest + MTX_CHOL_BLOCK - 1) / MTX_CHOL_BLOCK;
+    s.tasks = mtx_get_num_threads();
+    if (rest * rest * s.kb < MTX_PARALLEL_MIN_ELEMENTS * MTX_CHOL_BLOCK)
+      s.tasks = 1;
+    if (s.tasks > slabs)
+      s.tasks = slabs;
+    mtx_parallel_for(s.tasks, 1, trailing_slabs, &s);
+  }
+
+  mtx_scratch_end(&scratch);
+  if (rc != 0)
+    return -1;
+
+  for (size_t i = 0; i + 1 < n; ++i) {
+    memset(mtx_at(m, i, i + 1), 0, (n - i - 1) * sizeof(double));
+  }
+  return 0;
+}
+
+int mtx_chol_factor(mtx_chol_t *chol, const matrix_t *m) {
+  return mtx_chol_factor_ws(chol, m, NULL);
+}
+
+int mtx_chol_factor_ws(mtx_chol_t *chol, const matrix_t *m,
+                       mtx_workspace_t *ws) {
+  if (!chol || !m || !m->data)
+    return -1;
+  if (m->rows != m->cols || m->rows != chol->n)
+    return -1;
+
+  if (m != chol->l && mtx_assign(chol->l, m) != 0)
+    return -1;
+
+  return mtx_chol_decompose(chol->l, ws);
+}
+
+typedef struct {
+  const mtx_chol_t *chol;
+  double *b;
+  size_t ldb;
+} chol_solve_job_t;
+
+static void row_divide(double *dst, double d, size_t w) {
+  for (size_t j = 0; j < w; ++j) {
+    dst[j] /= d;
+  }
+}
+
+static void chol_solve_cols(void *ctx, size_t c0, size_t c1) {
+  chol_solve_job_t *job = (chol_solve_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const double *a = job->chol->l->data;
+  size_t n = job->chol->n, lda = job->chol->l->ld, ldb = job->ldb;
+  size_t w = c1 - c0;
+  double *b = job->b + c0;
+
+  // L y = b, MTX_CHOL_BLOCK rows at a time with GEMM below each block.
+  size_t nb = w < MTX_CHOL_NARROW ? n : MTX_CHOL_BLOCK;
+  for (size_t i0 = 0; i0 < n; i0 += nb) {
+    size_t i1 = n - i0 < nb ? n : i0 + nb;
+    for (size_t i = i0; i < i1; ++i) {
+      const double *lrow = a + i * lda;
+      for (size_t j = i0; j < i; ++j) {
+        if (lrow[j] != 0.0)
+          row_update(b + i * ldb, b + j * ldb, lrow[j], w, ops);
+      }
+      row_divide(b + i * ldb, lrow[i], w);
+    }
+    if (i1 < n)
+      mtx_gemm(n - i1, w, i1 - i0, -1.0, a + i1 * lda + i0, lda, b + i0 * ldb,
+               ldb, 1.0, b + i1 * ldb, ldb);
+  }
+
+  // L^T x = y from the bottom; row i of L holds column i of L^T.
+  for (size_t i = n; i-- > 0;) {
+    const double *lrow = a + i * lda;
+    row_divide(b + i * ldb, lrow[i], w);
+    for (size_t j = 0; j < i; ++j) {
+      if (lrow[j] != 0.0)
+        row_update(b + j * ldb, b + i * ldb, lrow[j], w, ops);
+    }
+  }
+}
+
+int mtx_chol_solve(const mtx_chol_t *chol, matrix_t *b) {
+  if (!chol || !b || !b->data)
+    return -1;
+  if (b->rows != chol->n)
+    return -1;
+
+  size_t n = chol->n, work = n * n;
+  size_t target = MTX_PARALLEL_MIN_ELEMENTS * MTX_CHOL_SOLVE_GRAIN;
+  size_t grain = work >= target ? 1 : target / work;
+  if (grain < MTX_CHOL_SOLVE_GRAIN)
+    grain = MTX_CHOL_SOLVE_GRAIN;
+
+  chol_solve_job_t job = {chol, b->data, b->ld};
+  mtx_parallel_for(b->cols, grain, chol_solve_cols, &job);
+  return 0;
+}
+
+int mtx_chol_inverse(const mtx_chol_t *chol, matrix_t *inv) {
+  if (!chol || !inv || !inv->data)
+    return -1;
+  if (inv->rows != chol->n || inv->cols != chol->n)
+    return -1;
+
+  mtx_set_id(inv);
+  return mtx_chol_solve(chol, inv);
+}
+
+double mtx_chol_det(const mtx_chol_t *chol) {
+  if (!chol)
+    return 0.0;
+
+  double det = 1.0;
+  for (size_t i = 0; i < chol->n; ++i) {
+    double d = *mtx_cat(chol->l, i, i);
+    det *= d * d;
+  }
+  return det;
+}
@@ -0,0 +1,46 @@
+#ifndef MATRIX_CHOL_H
+#define MATRIX_CHOL_H
+
+#include "matrix.h"
+#include "matrix_workspace.h"
+
+#define MTX_CHOL_BLOCK 64
+// Entries a_ij and a_ji count as equal within this relative difference.
+#define MTX_SYMMETRY_TOL 1e-13
+
+// A = L * L^T for symmetric positive definite A. L is the lower triangle of
+// `l`; its strict upper triangle is zero.
+typedef struct {
+  size_t n;
+  matrix_t *l;
+} mtx_chol_t;
+
+mtx_chol_t *mtx_chol_alloc(size_t n);
+void mtx_chol_free(mtx_chol_t *chol);
+
+// As mtx_lu_init_workspace: the factor lives in `ws`, backed by `storage`.
+size_t mtx_chol_workspace_size(size_t n);
+int mtx_chol_init_workspace(mtx_chol_t *chol, matrix_t *storage, size_t n,
+                            mtx_workspace_t *ws);
+
+int mtx_is_symmetric(const matrix_t *m, double tol);
+
+// Only the lower triangle of m is read. Returns -1, usually within the first
+// block, when m is not positive definite or a pivot falls below EPSILON.
+int mtx_chol_factor(mtx_chol_t *chol, const matrix_t *m);
+int mtx_chol_factor_ws(mtx_chol_t *chol, const matrix_t *m,
+                       mtx_workspace_t *ws);
+
+// Blocked right-looking factorization of m in place, parallel over panel
+// rows and trailing columns. Needs mtx_chol_decompose_workspace_size bytes
+// of scratch from `ws` (NULL allocates).
+int mtx_chol_decompose(matrix_t *m, mtx_workspace_t *ws);
+size_t mtx_chol_decompose_workspace_size(size_t n);
+
+// Overwrite B with A^-1 * B, and set inv = A^-1.
+int mtx_chol_solve(const mtx_chol_t *chol, matrix_t *b);
+int mtx_chol_inverse(const mtx_chol_t *chol, matrix_t *inv);
+
+double mtx_chol_det(const mtx_chol_t *chol);
+
+#endif // MATRIX_CHOL_H
@@ -0,0 +1,155 @@
+#include "matrix_expr.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <string.h>
+
+static void expr_start(mtx_expr_t *e, matrix_t *dst, double dst_coef) {
+  if (!e)
+    return;
+  e->dst = dst;
+  e->dst_coef = dst_coef;
+  e->id_coef = 0.0;
+  e->count = 0;
+  e->failed = !dst || !dst->data;
+}
+
+void mtx_expr_begin(mtx_expr_t *e, matrix_t *dst) { expr_start(e, dst, 1.0); }
+
+void mtx_expr_assign(mtx_expr_t *e, matrix_t *dst) {
+  expr_start(e, dst, 0.0);
+}
+
+static int same_block(const matrix_t *a, const matrix_t *b) {
+  return a->data == b->data && a->ld == b->ld;
+}
+
+int mtx_expr_add_scaled(mtx_expr_t *e, const matrix_t *m, double scale) {
+  if (!e || e->failed)
+    return -1;
+  if (!m || !m->data || m->rows != e->dst->rows || m->cols != e->dst->cols) {
+    e->failed = 1;
+    return -1;
+  }
+
+  // dst itself folds into its own coefficient; any other overlap would read
+  // elements the pass has already overwritten.
+  if (same_block(m, e->dst)) {
+    e->dst_coef += scale;
+    return 0;
+  }
+  if (mtx_overlaps(m, e->dst)) {
+    e->failed = 1;
+    return -1;
+  }
+
+  for (size_t i = 0; i < e->count; ++i) {
+    if (same_block(e->src[i], m)) {
+      e->coef[i] += scale;
+      return 0;
+    }
+  }
+  if (e->count == MTX_EXPR_MAX_TERMS) {
+    e->failed = 1;
+    return -1;
+  }
+
+  e->src[e->count] = m;
+  e->coef[e->count] = scale;
+  e->count++;
+  return 0;
+}
+
+int mtx_expr_add(mtx_expr_t *e, const matrix_t *m) {
+  return mtx_expr_add_scaled(e, m, 1.0);
+}
+
+int mtx_expr_sub(mtx_expr_t *e, const matrix_t *m) {
+  return mtx_expr_add_scaled(e, m, -1.0);
+}
+
+int mtx_expr_add_id(mtx_expr_t *e, double scale) {
+  if (!e || e->failed)
+    return -1;
+  e->id_coef += scale;
+  return 0;
+}
+
+int mtx_expr_scale(mtx_expr_t *e, double scale) {
+  if (!e || e->failed)
+    return -1;
+  e->dst_coef *= scale;
+  e->id_coef *= scale;
+  for (size_t i = 0; i < e->count; ++i) {
+    e->coef[i] *= scale;
+  }
+  return 0;
+}
+
+typedef struct {
+  const mtx_expr_t *e;
+  int packed;
+} expr_job_t;
+
+// Position f of the row-major element order maps to data + f when every
+// operand is packed, and to row f / cols otherwise.
+static const double *expr_ptr(const matrix_t *m, size_t f, int packed) {
+  return packed ? m->data + f : mtx_crow(m, f / m->cols) + f % m->cols;
+}
+
+static void expr_tile(const mtx_expr_t *e, const mtx_simd_ops_t *ops,
+                      size_t f, size_t len, int packed) {
+  double *d = (double *)expr_ptr(e->dst, f, packed);
+  size_t first = 0;
+  if (e->dst_coef == 0.0) {
+    if (e->count == 0) {
+      memset(d, 0, len * sizeof(double));
+    } else {
+      memcpy(d, expr_ptr(e->src[0], f, packed), len * sizeof(double));
+      if (e->coef[0] != 1.0)
+        ops->scal(d, e->coef[0], len);
+      first = 1;
+    }
+  } else if (e->dst_coef != 1.0) {
+    ops->scal(d, e->dst_coef, len);
+  }
+
+  for (size_t t = first; t < e->count; ++t) {
+    ops->axpy(d, expr_ptr(e->src[t], f, packed), e->coef[t], len);
+  }
+
+  if (e->id_coef != 0.0) {
+    size_t cols = e->dst->cols, step = cols + 1;
+    size_t diag = e->dst->rows < cols ? e->dst->rows : cols;
+    for (size_t r = (f + cols) / step; r < diag && r * step < f + len; ++r) {
+      d[r * step - f] += e->id_coef;
+    }
+  }
+}
+
+static void expr_range(void *ctx, size_t begin, size_t end) {
+  expr_job_t *job = (expr_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t cols = job->e->dst->cols;
+  while (begin < end) {
+    size_t len = end - begin;
+    if (!job->packed && cols - begin % cols < len)
+      len = cols - begin % cols;
+    if (len > MTX_EXPR_TILE)
+      len = MTX_EXPR_TILE;
+    expr_tile(job->e, ops, begin, len, job->packed);
+    begin += len;
+  }
+}
+
+int mtx_expr_eval(const mtx_expr_t *e) {
+  if (!e || e->failed)
+    return -1;
+
+  expr_job_t job = {e, mtx_is_contiguous(e->dst)};
+  for (size_t i = 0; i < e->count; ++i) {
+    job.packed &= mtx_is_contiguous(e->src[i]);
+  }
+  mtx_parallel_for(e->dst->rows * e->dst->cols, MTX_PARALLEL_MIN_ELEMENTS,
+                   expr_range, &job);
+  return 0;
+}
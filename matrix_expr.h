@@ -0,0 +1,38 @@
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include "matrix.h"
+
+#define MTX_EXPR_MAX_TERMS 8
+// Elements per tile; a tile stays in L1 while every term is folded in.
+#define MTX_EXPR_TILE 512
+
+// Deferred linear combination dst = a * dst + sum(c_i * m_i) + d * I.
+// The builder calls only record coefficients (scaling rescales what is
+// already recorded), and mtx_expr_eval writes dst in one pass without
+// temporaries. Sources must stay valid until then. A failed call (shape
+// mismatch, too many terms, a source partly overlapping dst) makes the
+// evaluation fail without touching dst.
+typedef struct {
+  matrix_t *dst;
+  double dst_coef;
+  double id_coef;
+  size_t count;
+  const matrix_t *src[MTX_EXPR_MAX_TERMS];
+  double coef[MTX_EXPR_MAX_TERMS];
+  int failed;
+} mtx_expr_t;
+
+// Starts from dst's current value, or from zero (dst is then never read).
+void mtx_expr_begin(mtx_expr_t *e, matrix_t *dst);
+void mtx_expr_assign(mtx_expr_t *e, matrix_t *dst);
+
+int mtx_expr_add(mtx_expr_t *e, const matrix_t *m);
+int mtx_expr_sub(mtx_expr_t *e, const matrix_t *m);
+int mtx_expr_add_scaled(mtx_expr_t *e, const matrix_t *m, double scale);
+int mtx_expr_add_id(mtx_expr_t *e, double scale);
+int mtx_expr_scale(mtx_expr_t *e, double scale);
+
+int mtx_expr_eval(const mtx_expr_t *e);
+
+#endif // MATRIX_EXPR_H
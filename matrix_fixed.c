@@ -0,0 +1,309 @@
+#include "matrix_fixed.h"
+#include "matrix_operations.h"
+#include <math.h>
+
+#if defined(__clang__)
+#define UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define UNROLL _Pragma("GCC unroll 8")
+#else
+#define UNROLL
+#endif
+
+#define INLINE static inline __attribute__((always_inline))
+
+// Every loop below runs over a constant n, so each size unrolls completely.
+INLINE void mul_n(double *restrict c, size_t ldc, const double *restrict a,
+                  size_t lda, const double *restrict b, size_t ldb, size_t n) {
+  UNROLL
+  for (size_t i = 0; i < n; ++i) {
+    double acc[MTX_FIXED_MAX];
+    UNROLL
+    for (size_t j = 0; j < n; ++j) {
+      acc[j] = a[i * lda] * b[j];
+    }
+    UNROLL
+    for (size_t p = 1; p < n; ++p) {
+      UNROLL
+      for (size_t j = 0; j < n; ++j) {
+        acc[j] += a[i * lda + p] * b[p * ldb + j];
+      }
+    }
+    UNROLL
+    for (size_t j = 0; j < n; ++j) {
+      c[i * ldc + j] = acc[j];
+    }
+  }
+}
+
+INLINE void transpose_n(double *a, size_t lda, size_t n) {
+  UNROLL
+  for (size_t i = 1; i < n; ++i) {
+    UNROLL
+    for (size_t j = 0; j < i; ++j) {
+      double t = a[i * lda + j];
+      a[i * lda + j] = a[j * lda + i];
+      a[j * lda + i] = t;
+    }
+  }
+}
+
+// Pivot k of partial pivoting is the ratio of the k x k leading minors of the
+// rows it has picked, and each pick maximizes the next minor. So the pivot
+// test of inverse_n and mtx_lu_decompose reads: the largest minor extending
+// the path must reach EPSILON times the previous one.
+INLINE int small_pivot(double minor, double prev) {
+  return !(minor >= EPSILON * prev);
+}
+
+// Row of the largest |a(i, 0)|, the first pick of partial pivoting.
+INLINE size_t first_pivot(const double *a, size_t lda, size_t n,
+                          double *best) {
+  size_t p = 0;
+  *best = fabs(a[0]);
+  UNROLL
+  for (size_t i = 1; i < n; ++i) {
+    double m = fabs(a[i * lda]);
+    p = m > *best ? i : p;
+    *best = m > *best ? m : *best;
+  }
+  return p;
+}
+
+// Gauss-Jordan on local copies, so inv may alias a.
+INLINE int inverse_n(double *inv, size_t ldi, const double *a, size_t lda,
+                     size_t n) {
+  double w[MTX_FIXED_MAX][MTX_FIXED_MAX], r[MTX_FIXED_MAX][MTX_FIXED_MAX];
+  UNROLL
+  for (size_t i = 0; i < n; ++i) {
+    UNROLL
+    for (size_t j = 0; j < n; ++j) {
+      w[i][j] = a[i * lda + j];
+      r[i][j] = i == j ? 1.0 : 0.0;
+    }
+  }
+
+  UNROLL
+  for (size_t k = 0; k < n; ++k) {
+    size_t p = k;
+    double best = fabs(w[k][k]);
+    UNROLL
+    for (size_t i = k + 1; i < n; ++i) {
+      if (fabs(w[i][k]) > best) {
+        best = fabs(w[i][k]);
+        p = i;
+      }
+    }
+    if (best < EPSILON)
+      return -1;
+    if (p != k) {
+      UNROLL
+      for (size_t j = 0; j < n; ++j) {
+        double t = w[k][j];
+        w[k][j] = w[p][j];
+        w[p][j] = t;
+        t = r[k][j];
+        r[k][j] = r[p][j];
+        r[p][j] = t;
+      }
+    }
+
+    double d = 1.0 / w[k][k];
+    UNROLL
+    for (size_t j = 0; j < n; ++j) {
+      w[k][j] *= d;
+      r[k][j] *= d;
+    }
+    UNROLL
+    for (size_t i = 0; i < n; ++i) {
+      if (i == k)
+        continue;
+      double f = w[i][k];
+      UNROLL
+      for (size_t j = 0; j < n; ++j) {
+        w[i][j] -= f * w[k][j];
+        r[i][j] -= f * r[k][j];
+      }
+    }
+  }
+
+  UNROLL
+  for (size_t i = 0; i < n; ++i) {
+    UNROLL
+    for (size_t j = 0; j < n; ++j) {
+      inv[i * ldi + j] = r[i][j];
+    }
+  }
+  return 0;
+}
+
+int mtx_inverse_2x2(double *inv, size_t ldi, const double *a, size_t lda) {
+  double a00 = a[0], a01 = a[1], a10 = a[lda], a11 = a[lda + 1];
+  double det = a00 * a11 - a01 * a10, m1;
+  first_pivot(a, lda, 2, &m1);
+  if (small_pivot(m1, 1.0) || small_pivot(fabs(det), m1))
+    return -1;
+  double d = 1.0 / det;
+  inv[0] = a11 * d;
+  inv[1] = -a01 * d;
+  inv[ldi] = -a10 * d;
+  inv[ldi + 1] = a00 * d;
+  return 0;
+}
+
+int mtx_inverse_3x3(double *inv, size_t ldi, const double *a, size_t lda) {
+  const double *r0 = a, *r1 = a + lda, *r2 = a + 2 * lda;
+  double c00 = r1[1] * r2[2] - r1[2] * r2[1];
+  double c01 = r1[2] * r2[0] - r1[0] * r2[2];
+  double c02 = r1[0] * r2[1] - r1[1] * r2[0];
+  double det = r0[0] * c00 + r0[1] * c01 + r0[2] * c02;
+  // Minors on columns 0 and 1, indexed by the row they leave out. Those
+  // that keep row p extend the first pivot.
+  double m01[3] = {c02, r0[0] * r2[1] - r0[1] * r2[0],
+                   r0[0] * r1[1] - r0[1] * r1[0]};
+  double m1, m2 = 0.0;
+  size_t p = first_pivot(a, lda, 3, &m1);
+  UNROLL
+  for (size_t i = 0; i < 3; ++i) {
+    double m = fabs(m01[i]) * (i != p);
+    m2 = m > m2 ? m : m2;
+  }
+  if (small_pivot(m1, 1.0) || small_pivot(m2, m1) ||
+      small_pivot(fabs(det), m2))
+    return -1;
+  double d = 1.0 / det;
+  double t[9] = {c00 * d,
+                 (r0[2] * r2[1] - r0[1] * r2[2]) * d,
+                 (r0[1] * r1[2] - r0[2] * r1[1]) * d,
+                 c01 * d,
+                 (r0[0] * r2[2] - r0[2] * r2[0]) * d,
+                 (r0[2] * r1[0] - r0[0] * r1[2]) * d,
+                 c02 * d,
+                 -m01[1] * d,
+                 m01[2] * d};
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      inv[i * ldi + j] = t[i * 3 + j];
+    }
+  }
+  return 0;
+}
+
+// Cofactors from the 2 x 2 minors of the top and bottom row pairs.
+int mtx_inverse_4x4(double *inv, size_t ldi, const double *a, size_t lda) {
+  const double *r0 = a, *r1 = a + lda, *r2 = a + 2 * lda, *r3 = a + 3 * lda;
+  double s0 = r0[0] * r1[1] - r1[0] * r0[1];
+  double s1 = r0[0] * r1[2] - r1[0] * r0[2];
+  double s2 = r0[0] * r1[3] - r1[0] * r0[3];
+  double s3 = r0[1] * r1[2] - r1[1] * r0[2];
+  double s4 = r0[1] * r1[3] - r1[1] * r0[3];
+  double s5 = r0[2] * r1[3] - r1[2] * r0[3];
+  double c5 = r2[2] * r3[3] - r3[2] * r2[3];
+  double c4 = r2[1] * r3[3] - r3[1] * r2[3];
+  double c3 = r2[1] * r3[2] - r3[1] * r2[2];
+  double c2 = r2[0] * r3[3] - r3[0] * r2[3];
+  double c1 = r2[0] * r3[2] - r3[0] * r2[2];
+  double c0 = r2[0] * r3[1] - r3[0] * r2[1];
+  double det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  // Minors on columns 0 to 2, indexed by the row they leave out, are the
+  // numerators of the last row of the inverse.
+  double m012[4] = {-r1[0] * c3 + r1[1] * c1 - r1[2] * c0,
+                    r0[0] * c3 - r0[1] * c1 + r0[2] * c0,
+                    -r3[0] * s3 + r3[1] * s1 - r3[2] * s0,
+                    r2[0] * s3 - r2[1] * s1 + r2[2] * s0};
+  double m1, m2 = 0.0, m3 = 0.0;
+  size_t p = first_pivot(a, lda, 4, &m1), q = p;
+  UNROLL
+  for (size_t i = 0; i < 4; ++i) {
+    const double *rp = a + p * lda, *ri = a + i * lda;
+    double m = fabs(rp[0] * ri[1] - ri[0] * rp[1]) * (i != p);
+    q = m > m2 ? i : q;
+    m2 = m > m2 ? m : m2;
+  }
+  UNROLL
+  for (size_t i = 0; i < 4; ++i) {
+    double m = fabs(m012[i]) * (i != p && i != q);
+    m3 = m > m3 ? m : m3;
+  }
+  if (small_pivot(m1, 1.0) || small_pivot(m2, m1) || small_pivot(m3, m2) ||
+      small_pivot(fabs(det), m3))
+    return -1;
+  double d = 1.0 / det;
+  double t[16] = {
+      (r1[1] * c5 - r1[2] * c4 + r1[3] * c3) * d,
+      (-r0[1] * c5 + r0[2] * c4 - r0[3] * c3) * d,
+      (r3[1] * s5 - r3[2] * s4 + r3[3] * s3) * d,
+      (-r2[1] * s5 + r2[2] * s4 - r2[3] * s3) * d,
+      (-r1[0] * c5 + r1[2] * c2 - r1[3] * c1) * d,
+      (r0[0] * c5 - r0[2] * c2 + r0[3] * c1) * d,
+      (-r3[0] * s5 + r3[2] * s2 - r3[3] * s1) * d,
+      (r2[0] * s5 - r2[2] * s2 + r2[3] * s1) * d,
+      (r1[0] * c4 - r1[1] * c2 + r1[3] * c0) * d,
+      (-r0[0] * c4 + r0[1] * c2 - r0[3] * c0) * d,
+      (r3[0] * s4 - r3[1] * s2 + r3[3] * s0) * d,
+      (-r2[0] * s4 + r2[1] * s2 - r2[3] * s0) * d,
+      m012[0] * d,
+      m012[1] * d,
+      m012[2] * d,
+      m012[3] * d};
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      inv[i * ldi + j] = t[i * 4 + j];
+    }
+  }
+  return 0;
+}
+
+#define DEFINE_FIXED(N)                                                        \
+  void mtx_mul_##N##x##N(double *c, size_t ldc, const double *a, size_t lda,  \
+                         const double *b, size_t ldb) {                        \
+    mul_n(c, ldc, a, lda, b, ldb, N);                                          \
+  }                                                                            \
+  void mtx_transpose_##N##x##N(double *a, size_t lda) {                        \
+    transpose_n(a, lda, N);                                                    \
+  }
+
+#define DEFINE_FIXED_INVERSE(N)                                                \
+  int mtx_inverse_##N##x##N(double *inv, size_t ldi, const double *a,          \
+                            size_t lda) {                                      \
+    return inverse_n(inv, ldi, a, lda, N);                                     \
+  }
+
+DEFINE_FIXED(2)
+DEFINE_FIXED(3)
+DEFINE_FIXED(4)
+DEFINE_FIXED(5)
+DEFINE_FIXED(6)
+DEFINE_FIXED(7)
+DEFINE_FIXED(8)
+DEFINE_FIXED_INVERSE(5)
+DEFINE_FIXED_INVERSE(6)
+DEFINE_FIXED_INVERSE(7)
+DEFINE_FIXED_INVERSE(8)
+
+static const mtx_fixed_mul_fn fixed_mul[] = {
+    mtx_mul_2x2, mtx_mul_3x3, mtx_mul_4x4, mtx_mul_5x5,
+    mtx_mul_6x6, mtx_mul_7x7, mtx_mul_8x8};
+static const mtx_fixed_inverse_fn fixed_inverse[] = {
+    mtx_inverse_2x2, mtx_inverse_3x3, mtx_inverse_4x4, mtx_inverse_5x5,
+    mtx_inverse_6x6, mtx_inverse_7x7, mtx_inverse_8x8};
+static const mtx_fixed_transpose_fn fixed_transpose[] = {
+    mtx_transpose_2x2, mtx_transpose_3x3, mtx_transpose_4x4,
+    mtx_transpose_5x5, mtx_transpose_6x6, mtx_transpose_7x7,
+    mtx_transpose_8x8};
+
+static int has_fixed(size_t n) {
+  return n >= MTX_FIXED_MIN && n <= MTX_FIXED_MAX;
+}
+
+mtx_fixed_mul_fn mtx_fixed_mul(size_t n) {
+  return has_fixed(n) ? fixed_mul[n - MTX_FIXED_MIN] : NULL;
+}
+
+mtx_fixed_inverse_fn mtx_fixed_inverse(size_t n) {
+  return has_fixed(n) ? fixed_inverse[n - MTX_FIXED_MIN] : NULL;
+}
+
+mtx_fixed_transpose_fn mtx_fixed_transpose(size_t n) {
+  return has_fixed(n) ? fixed_transpose[n - MTX_FIXED_MIN] : NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef MATRIX_FIXED_H
+#define MATRIX_FIXED_H
+
+#include <stddef.h>
+
+// Square sizes with kernels whose dimensions are compile-time constants.
+// mtx_mul3, mtx_inverse and mtx_transpose switch to them automatically.
+#define MTX_FIXED_MIN 2
+#define MTX_FIXED_MAX 8
+
+// c = a * b, inv = a^-1 and in-place a = a^T on N x N blocks whose rows are
+// ld* doubles apart, for N in MTX_FIXED_MIN..MTX_FIXED_MAX. c must not alias
+// a or b; inv may alias a. Inverses up to 4 x 4 use cofactors, larger ones
+// Gauss-Jordan with partial pivoting. Inverse returns -1 when a partial
+// pivoting pivot falls below EPSILON, as mtx_lu_decompose does.
+#define MTX_FIXED_DECLARE(N)                                                   \
+  void mtx_mul_##N##x##N(double *c, size_t ldc, const double *a, size_t lda,  \
+                         const double *b, size_t ldb);                         \
+  int mtx_inverse_##N##x##N(double *inv, size_t ldi, const double *a,          \
+                            size_t lda);                                       \
+  void mtx_transpose_##N##x##N(double *a, size_t lda);
+
+MTX_FIXED_DECLARE(2)
+MTX_FIXED_DECLARE(3)
+MTX_FIXED_DECLARE(4)
+MTX_FIXED_DECLARE(5)
+MTX_FIXED_DECLARE(6)
+MTX_FIXED_DECLARE(7)
+MTX_FIXED_DECLARE(8)
+
+#undef MTX_FIXED_DECLARE
+
+typedef void (*mtx_fixed_mul_fn)(double *c, size_t ldc, const double *a,
+                                 size_t lda, const double *b, size_t ldb);
+typedef int (*mtx_fixed_inverse_fn)(double *inv, size_t ldi, const double *a,
+                                    size_t lda);
+typedef void (*mtx_fixed_transpose_fn)(double *a, size_t lda);
+
+// Kernels for an n x n size, or NULL when n has none.
+mtx_fixed_mul_fn mtx_fixed_mul(size_t n);
+mtx_fixed_inverse_fn mtx_fixed_inverse(size_t n);
+mtx_fixed_transpose_fn mtx_fixed_transpose(size_t n);
+
+#endif // MATRIX_FIXED_H
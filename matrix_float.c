@@ -0,0 +1,596 @@
+#include "matrix_float.h"
+#include "matrix_gemm.h"
+#include "matrix_lu.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MTXF_NARROW 16
+
+matrixf_t *mtxf_alloc(size_t rows, size_t cols) {
+  if (rows == 0 || cols == 0)
+    return NULL;
+
+  matrixf_t *m = (matrixf_t *)malloc(sizeof(matrixf_t));
+  if (!m)
+    return NULL;
+
+  m->data = (float *)mtx_alloc_elems(rows, cols, sizeof(float));
+  if (!m->data) {
+    free(m);
+    return NULL;
+  }
+
+  m->rows = rows;
+  m->cols = cols;
+  m->ld = cols;
+  m->view = 0;
+  return m;
+}
+
+void mtxf_free(matrixf_t *m) {
+  if (m) {
+    free(m->data);
+    free(m);
+  }
+}
+
+int mtxf_is_contiguous(const matrixf_t *m) {
+  return m && (m->ld == m->cols || m->rows <= 1);
+}
+
+void mtxf_set_zero(matrixf_t *m) {
+  if (!m || !m->data)
+    return;
+
+  for (size_t i = 0; i < m->rows; ++i) {
+    memset(mtxf_at(m, i, 0), 0, m->cols * sizeof(float));
+  }
+}
+
+int mtxf_view(matrixf_t *view, matrixf_t *m, size_t r0, size_t c0,
+              size_t rows, size_t cols) {
+  if (!view || !m || !m->data)
+    return -1;
+  if (rows == 0 || cols == 0 || r0 > m->rows || rows > m->rows - r0 ||
+      c0 > m->cols || cols > m->cols - c0)
+    return -1;
+
+  return mtxf_view_data(view, mtxf_at(m, r0, c0), rows, cols, m->ld);
+}
+
+int mtxf_view_data(matrixf_t *view, float *data, size_t rows, size_t cols,
+                   size_t ld) {
+  if (!view || !data || ld < cols)
+    return -1;
+
+  view->rows = rows;
+  view->cols = cols;
+  view->ld = ld;
+  view->data = data;
+  view->view = 1;
+  return 0;
+}
+
+int mtxf_overlaps(const matrixf_t *a, const matrixf_t *b) {
+  if (!a || !b || !a->data || !b->data || a->rows * a->cols == 0 ||
+      b->rows * b->cols == 0)
+    return 0;
+
+  const float *a_end = a->data + (a->rows - 1) * a->ld + a->cols;
+  const float *b_end = b->data + (b->rows - 1) * b->ld + b->cols;
+  if (a->data >= b_end || b->data >= a_end)
+    return 0;
+  if (a->ld != b->ld)
+    return 1;
+
+  // Blocks of one parent: compare row and column ranges.
+  if (b->data < a->data) {
+    const matrixf_t *t = a;
+    a = b;
+    b = t;
+  }
+  size_t offset = (size_t)(b->data - a->data);
+  size_t r0 = offset / a->ld, c0 = offset % a->ld;
+  if (c0 + b->cols > a->ld)
+    return 1;
+  return r0 < a->rows && c0 < a->cols;
+}
+
+int mtxf_from_double(matrixf_t *dst, const matrix_t *src) {
+  if (!dst || !src || !dst->data || !src->data)
+    return -1;
+  if (dst->rows != src->rows || dst->cols != src->cols)
+    return -1;
+
+  for (size_t i = 0; i < src->rows; ++i) {
+    float *d = mtxf_at(dst, i, 0);
+    const double *s = mtx_crow(src, i);
+    for (size_t j = 0; j < src->cols; ++j) {
+      d[j] = (float)s[j];
+    }
+  }
+  return 0;
+}
+
+int mtxf_to_double(matrix_t *dst, const matrixf_t *src) {
+  if (!dst || !src || !dst->data || !src->data)
+    return -1;
+  if (dst->rows != src->rows || dst->cols != src->cols)
+    return -1;
+
+  for (size_t i = 0; i < src->rows; ++i) {
+    double *d = mtx_row(dst, i);
+    const float *s = mtxf_cat(src, i, 0);
+    for (size_t j = 0; j < src->cols; ++j) {
+      d[j] = s[j];
+    }
+  }
+  return 0;
+}
+
+// Same row walk as the double elementwise ops; add and sub are axpy with
+// alpha = +-1, which rounds identically.
+typedef struct {
+  float *dst;
+  const float *src;
+  size_t dst_ld;
+  size_t src_ld;
+  size_t cols;
+  float scale;
+} elementwise_job_t;
+
+static void elementwise_range(void *ctx, size_t begin, size_t end) {
+  elementwise_job_t *job = (elementwise_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  while (begin < end) {
+    size_t i = begin / job->cols, j = begin % job->cols;
+    size_t len = job->cols - j < end - begin ? job->cols - j : end - begin;
+    float *dst = job->dst + i * job->dst_ld + j;
+    if (job->src) {
+      ops->saxpy(dst, job->src + i * job->src_ld + j, job->scale, len);
+    } else {
+      for (size_t k = 0; k < len; ++k) {
+        dst[k] *= job->scale;
+      }
+    }
+    begin += len;
+  }
+}
+
+static int elementwise(matrixf_t *dst, const matrixf_t *src, float scale) {
+  if (!dst || !dst->data || (src && !src->data))
+    return -1;
+  if (src && (dst->rows != src->rows || dst->cols != src->cols))
+    return -1;
+
+  size_t count = dst->rows * dst->cols;
+  elementwise_job_t job = {dst->data, src ? src->data : NULL, dst->ld,
+                           src ? src->ld : 0, dst->cols, scale};
+  if (mtxf_is_contiguous(dst) && (!src || mtxf_is_contiguous(src)))
+    job.cols = count;
+  mtx_parallel_for(count, MTX_PARALLEL_MIN_ELEMENTS, elementwise_range, &job);
+  return 0;
+}
+
+int mtxf_add(matrixf_t *m1, const matrixf_t *m2) {
+  return m2 ? elementwise(m1, m2, 1.0f) : -1;
+}
+
+int mtxf_sub(matrixf_t *m1, const matrixf_t *m2) {
+  return m2 ? elementwise(m1, m2, -1.0f) : -1;
+}
+
+int mtxf_add_scaled(matrixf_t *m1, const matrixf_t *m2, float scale) {
+  return m2 ? elementwise(m1, m2, scale) : -1;
+}
+
+int mtxf_scale(matrixf_t *m, float scale) {
+  return elementwise(m, NULL, scale);
+}
+
+int mtxf_mul3(matrixf_t *result, const matrixf_t *m1, const matrixf_t *m2) {
+  if (!result || !m1 || !m2 || !result->data || !m1->data || !m2->data)
+    return -1;
+  if (m1->cols != m2->rows || result->rows != m1->rows ||
+      result->cols != m2->cols)
+    return -1;
+  if (mtxf_overlaps(result, m1) || mtxf_overlaps(result, m2))
+    return -1;
+
+  return mtx_sgemm(m1->rows, m2->cols, m1->cols, 1.0f, m1->data, m1->ld,
+                   m2->data, m2->ld, 0.0f, result->data, result->ld);
+}
+
+mtxf_lu_t *mtxf_lu_alloc(size_t n) {
+  if (n == 0)
+    return NULL;
+
+  mtxf_lu_t *lu = (mtxf_lu_t *)malloc(sizeof(mtxf_lu_t));
+  if (!lu)
+    return NULL;
+
+  lu->n = n;
+  lu->sign = 1;
+  lu->lu = mtxf_alloc(n, n);
+  lu->piv = (size_t *)malloc(n * sizeof(size_t));
+  if (!lu->lu || !lu->piv) {
+    mtxf_lu_free(lu);
+    return NULL;
+  }
+
+  return lu;
+}
+
+void mtxf_lu_free(mtxf_lu_t *lu) {
+  if (lu) {
+    mtxf_free(lu->lu);
+    free(lu->piv);
+    free(lu);
+  }
+}
+
+size_t mtxf_lu_workspace_size(size_t n) {
+  return mtx_workspace_bytes(n * n * sizeof(float)) +
+         mtx_workspace_bytes(n * sizeof(size_t));
+}
+
+int mtxf_lu_init_workspace(mtxf_lu_t *lu, matrixf_t *storage, size_t n,
+                           mtx_workspace_t *ws) {
+  if (!lu || !storage || n == 0)
+    return -1;
+
+  float *data = (float *)mtx_workspace_push(ws, n * n * sizeof(float));
+  lu->piv = (size_t *)mtx_workspace_push(ws, n * sizeof(size_t));
+  if (!data || !lu->piv || mtxf_view_data(storage, data, n, n, n) != 0)
+    return -1;
+
+  lu->n = n;
+  lu->lu = storage;
+  lu->sign = 1;
+  return 0;
+}
+
+static void swap_rows(float *a, float *b, size_t w) {
+  for (size_t j = 0; j < w; ++j) {
+    float t = a[j];
+    a[j] = b[j];
+    b[j] = t;
+  }
+}
+
+// dst -= alpha * src over w elements; short rows skip the dispatch call.
+static void row_update(float *dst, const float *src, float alpha, size_t w,
+                       const mtx_simd_ops_t *ops) {
+  if (w < MTXF_NARROW) {
+    for (size_t j = 0; j < w; ++j) {
+      dst[j] -= alpha * src[j];
+    }
+  } else {
+    ops->saxpy(dst, src, -alpha, w);
+  }
+}
+
+// Unblocked factorization of columns [k0, k0 + kb) over rows [k0, n); row
+// swaps stay inside the panel.
+static int panel_factor(float *a, size_t lda, size_t n, size_t k0, size_t kb,
+                        size_t *piv, int *sign) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+
+  for (size_t k = k0; k < k0 + kb; ++k) {
+    size_t p = k;
+    float max_val = fabsf(a[k * lda + k]);
+    for (size_t i = k + 1; i < n; ++i) {
+      float val = fabsf(a[i * lda + k]);
+      if (val > max_val) {
+        max_val = val;
+        p = i;
+      }
+    }
+
+    if (!(max_val >= MTXF_EPSILON))
+      return -1;
+
+    piv[k] = p;
+    if (p != k) {
+      swap_rows(a + k * lda + k0, a + p * lda + k0, kb);
+      *sign = -*sign;
+    }
+
+    const float *prow = a + k * lda;
+    for (size_t r = k + 1; r < n; ++r) {
+      float *row = a + r * lda;
+      float l = row[k] / prow[k];
+      row[k] = l;
+      row_update(row + k + 1, prow + k + 1, l, k0 + kb - k - 1, ops);
+    }
+  }
+
+  return 0;
+}
+
+// Right-looking blocked LU; the trailing update is one SGEMM per panel.
+static int lu_decompose(matrixf_t *m, size_t *piv, int *sign) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  float *a = m->data;
+  size_t n = m->rows, lda = m->ld;
+  *sign = 1;
+
+  for (size_t k0 = 0; k0 < n; k0 += MTX_LU_BLOCK) {
+    size_t kb = n - k0 < MTX_LU_BLOCK ? n - k0 : MTX_LU_BLOCK;
+    size_t k1 = k0 + kb;
+    if (panel_factor(a, lda, n, k0, kb, piv, sign) != 0)
+      return -1;
+
+    for (size_t k = k0; k < k1; ++k) {
+      if (piv[k] == k)
+        continue;
+      swap_rows(a + k * lda, a + piv[k] * lda, k0);
+      swap_rows(a + k * lda + k1, a + piv[k] * lda + k1, n - k1);
+    }
+    if (k1 == n)
+      break;
+
+    for (size_t i = k0 + 1; i < k1; ++i) {
+      const float *lrow = a + i * lda;
+      for (size_t j = k0; j < i; ++j) {
+        if (lrow[j] != 0.0f)
+          row_update(a + i * lda + k1, a + j * lda + k1, lrow[j], n - k1,
+                     ops);
+      }
+    }
+    if (mtx_sgemm(n - k1, n - k1, kb, -1.0f, a + k1 * lda + k0, lda,
+                  a + k0 * lda + k1, lda, 1.0f, a + k1 * lda + k1, lda) != 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+int mtxf_lu_factor(mtxf_lu_t *lu, const matrixf_t *m) {
+  if (!lu || !m || !m->data)
+    return -1;
+  if (m->rows != m->cols || m->rows != lu->n)
+    return -1;
+
+  if (m != lu->lu) {
+    for (size_t i = 0; i < m->rows; ++i) {
+      memcpy(mtxf_at(lu->lu, i, 0), mtxf_cat(m, i, 0),
+             m->cols * sizeof(float));
+    }
+  }
+
+  return lu_decompose(lu->lu, lu->piv, &lu->sign);
+}
+
+typedef struct {
+  const mtxf_lu_t *lu;
+  float *b;
+  size_t ldb;
+} lu_solve_job_t;
+
+// Sum of l[j] * x[j * stride] with four partial sums.
+static float dot_strided(const float *l, const float *x, size_t stride,
+                         size_t n) {
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    s0 += l[j] * x[j * stride];
+    s1 += l[j + 1] * x[(j + 1) * stride];
+    s2 += l[j + 2] * x[(j + 2) * stride];
+    s3 += l[j + 3] * x[(j + 3) * stride];
+  }
+  for (; j < n; ++j) {
+    s0 += l[j] * x[j * stride];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+static void lu_solve_cols(void *ctx, size_t c0, size_t c1) {
+  lu_solve_job_t *job = (lu_solve_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const float *a = job->lu->lu->data;
+  size_t n = job->lu->n, lda = job->lu->lu->ld, ldb = job->ldb, w = c1 - c0;
+  float *b = job->b + c0;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (job->lu->piv[i] != i)
+      swap_rows(b + i * ldb, b + job->lu->piv[i] * ldb, w);
+  }
+
+  // A few right-hand sides substitute with dot products along the rows of
+  // L and U; more of them share each row update across the columns.
+  if (w < MTXF_NARROW) {
+    for (size_t c = 0; c < w; ++c) {
+      float *x = b + c;
+      for (size_t i = 1; i < n; ++i) {
+        x[i * ldb] -= dot_strided(a + i * lda, x, ldb, i);
+      }
+      for (size_t i = n; i-- > 0;) {
+        const float *urow = a + i * lda;
+        x[i * ldb] = (x[i * ldb] - dot_strided(urow + i + 1, x + (i + 1) * ldb,
+                                               ldb, n - i - 1)) /
+                     urow[i];
+      }
+    }
+    return;
+  }
+
+  for (size_t i = 1; i < n; ++i) {
+    const float *lrow = a + i * lda;
+    for (size_t j = 0; j < i; ++j) {
+      if (lrow[j] != 0.0f)
+        row_update(b + i * ldb, b + j * ldb, lrow[j], w, ops);
+    }
+  }
+
+  for (size_t i = n; i-- > 0;) {
+    const float *urow = a + i * lda;
+    float *row = b + i * ldb;
+    for (size_t j = i + 1; j < n; ++j) {
+      if (urow[j] != 0.0f)
+        row_update(row, b + j * ldb, urow[j], w, ops);
+    }
+    for (size_t j = 0; j < w; ++j) {
+      row[j] /= urow[i];
+    }
+  }
+}
+
+int mtxf_lu_solve(const mtxf_lu_t *lu, matrixf_t *b) {
+  if (!lu || !b || !b->data)
+    return -1;
+  if (b->rows != lu->n)
+    return -1;
+
+  size_t work = lu->n * lu->n;
+  size_t grain = work >= MTX_PARALLEL_MIN_ELEMENTS
+                     ? 1
+                     : MTX_PARALLEL_MIN_ELEMENTS / work;
+  lu_solve_job_t job = {lu, b->data, b->ld};
+  mtx_parallel_for(b->cols, grain, lu_solve_cols, &job);
+  return 0;
+}
+
+size_t mtx_solve_mixed_workspace_size(const matrix_t *a, const matrix_t *b) {
+  if (!a || !b)
+    return 0;
+
+  size_t n = a->rows, count = n * b->cols;
+  size_t mixed = mtxf_lu_workspace_size(n) +
+                 mtx_workspace_bytes(count * sizeof(float)) +
+                 mtx_workspace_bytes(count * sizeof(double));
+  size_t fallback = mtx_solve_workspace_size(a) +
+                    mtx_workspace_bytes(count * sizeof(double));
+  return mixed > fallback ? mixed : fallback;
+}
+
+static double backward_error(double rnorm, double anorm, const matrix_t *x,
+                             double bnorm) {
+  double scale = anorm * mtx_norm(x) + bnorm;
+  if (rnorm == 0.0)
+    return 0.0;
+  return scale > 0.0 ? rnorm / scale : INFINITY;
+}
+
+// The residual is scaled to unit norm before narrowing so that it neither
+// overflows nor underflows float as it shrinks.
+static void narrow_scaled(matrixf_t *dst, const matrix_t *src, double scale) {
+  for (size_t i = 0; i < src->rows; ++i) {
+    float *d = mtxf_at(dst, i, 0);
+    const double *s = mtx_crow(src, i);
+    for (size_t j = 0; j < src->cols; ++j) {
+      d[j] = (float)(s[j] * scale);
+    }
+  }
+}
+
+static void widen_add(matrix_t *dst, const matrixf_t *src, double scale) {
+  for (size_t i = 0; i < dst->rows; ++i) {
+    double *d = mtx_row(dst, i);
+    const float *s = mtxf_cat(src, i, 0);
+    for (size_t j = 0; j < dst->cols; ++j) {
+      d[j] += scale * s[j];
+    }
+  }
+}
+
+// Returns 0 once the tolerance is met, 1 when float precision is not
+// enough and the caller should fall back, and -1 on errors.
+static int refine(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                  double tol, size_t max_iter, mtx_refine_info_t *info,
+                  mtx_workspace_t *ws) {
+  size_t n = a->rows, cols = b->cols;
+  mtxf_lu_t lu;
+  matrixf_t storage, f;
+  matrix_t r;
+  float *fdata = NULL;
+  if (mtxf_lu_init_workspace(&lu, &storage, n, ws) != 0 ||
+      !(fdata = (float *)mtx_workspace_push(ws, n * cols * sizeof(float))) ||
+      mtxf_view_data(&f, fdata, n, cols, cols) != 0 ||
+      mtx_workspace_matrix(ws, n, cols, &r) != 0)
+    return -1;
+
+  if (mtxf_from_double(&storage, a) != 0 || mtxf_lu_factor(&lu, &storage) != 0)
+    return 1;
+
+  double anorm = mtx_norm(a), bnorm = mtx_norm(b), prev = INFINITY;
+  mtx_set_zero(x);
+  for (size_t it = 0;; ++it) {
+    // x starts at zero, so the first residual is b itself.
+    if ((it == 0 ? mtx_assign(&r, b) : mtx_residual(a, x, b, &r)) != 0)
+      return -1;
+    double rnorm = mtx_norm(&r);
+    info->iterations = it;
+    info->backward_error = backward_error(rnorm, anorm, x, bnorm);
+    if (info->backward_error <= tol)
+      return 0;
+    // Each step should gain several digits; one that does not halve the
+    // error means the float factor is too inaccurate for this system.
+    if (it >= max_iter || !(info->backward_error < 0.5 * prev))
+      return 1;
+    prev = info->backward_error;
+
+    narrow_scaled(&f, &r, 1.0 / rnorm);
+    if (mtxf_lu_solve(&lu, &f) != 0)
+      return -1;
+    widen_add(x, &f, rnorm);
+  }
+}
+
+int mtx_solve_mixed(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                    const mtx_refine_opts_t *opts, mtx_refine_info_t *info) {
+  return mtx_solve_mixed_ws(a, b, x, opts, info, NULL);
+}
+
+int mtx_solve_mixed_ws(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                       const mtx_refine_opts_t *opts, mtx_refine_info_t *info,
+                       mtx_workspace_t *ws) {
+  if (!a || !b || !x)
+    return -1;
+  if (a->rows != a->cols || b->rows != a->rows)
+    return -1;
+  if (x->rows != b->rows || x->cols != b->cols)
+    return -1;
+  if (a->rows * b->cols == 0)
+    return 0;
+  if (!a->data || !b->data || !x->data)
+    return -1;
+  if (mtx_overlaps(x, a) || mtx_overlaps(x, b))
+    return -1;
+
+  size_t n = a->rows;
+  double tol = opts && opts->tol > 0.0 ? opts->tol
+                                       : sqrt((double)n) * DBL_EPSILON;
+  size_t max_iter = opts && opts->max_iter ? opts->max_iter
+                                           : MTX_REFINE_MAX_ITER;
+  mtx_refine_info_t local;
+  if (!info)
+    info = &local;
+  memset(info, 0, sizeof(*info));
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws,
+                        mtx_solve_mixed_workspace_size(a, b)) != 0)
+    return -1;
+
+  size_t mark = mtx_workspace_mark(scratch.ws);
+  int rc = refine(a, b, x, tol, max_iter, info, scratch.ws);
+  if (rc == 1) {
+    mtx_workspace_release(scratch.ws, mark);
+    info->fallback = 1;
+    rc = mtx_solve_ws(a, b, x, scratch.ws);
+    matrix_t r;
+    if (rc == 0 && mtx_workspace_matrix(scratch.ws, n, b->cols, &r) == 0 &&
+        mtx_residual(a, x, b, &r) == 0)
+      info->backward_error =
+          backward_error(mtx_norm(&r), mtx_norm(a), x, mtx_norm(b));
+  }
+
+  mtx_scratch_end(&scratch);
+  return rc;
+}
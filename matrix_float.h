@@ -0,0 +1,97 @@
+#ifndef MATRIX_FLOAT_H
+#define MATRIX_FLOAT_H
+
+#include "matrix.h"
+#include "matrix_workspace.h"
+
+// Pivots below this magnitude make the single-precision LU fail.
+#define MTXF_EPSILON 1e-6f
+
+#define MTX_REFINE_MAX_ITER 30
+
+// Single-precision counterpart of matrix_t, with the same layout rules.
+typedef struct {
+  size_t rows;
+  size_t cols;
+  size_t ld;
+  float *data;
+  int view;
+} matrixf_t;
+
+matrixf_t *mtxf_alloc(size_t rows, size_t cols);
+void mtxf_free(matrixf_t *m);
+void mtxf_set_zero(matrixf_t *m);
+int mtxf_view(matrixf_t *view, matrixf_t *m, size_t r0, size_t c0,
+              size_t rows, size_t cols);
+int mtxf_view_data(matrixf_t *view, float *data, size_t rows, size_t cols,
+                   size_t ld);
+int mtxf_is_contiguous(const matrixf_t *m);
+// As mtx_overlaps.
+int mtxf_overlaps(const matrixf_t *a, const matrixf_t *b);
+
+static inline float *mtxf_at(matrixf_t *m, size_t i, size_t j) {
+  return m->data + i * m->ld + j;
+}
+
+static inline const float *mtxf_cat(const matrixf_t *m, size_t i, size_t j) {
+  return m->data + i * m->ld + j;
+}
+
+// Conversions between precisions; shapes must match. Narrowing rounds to
+// nearest, so doubles beyond the float range become infinities.
+int mtxf_from_double(matrixf_t *dst, const matrix_t *src);
+int mtxf_to_double(matrix_t *dst, const matrixf_t *src);
+
+int mtxf_add(matrixf_t *m1, const matrixf_t *m2);
+int mtxf_sub(matrixf_t *m1, const matrixf_t *m2);
+int mtxf_add_scaled(matrixf_t *m1, const matrixf_t *m2, float scale);
+int mtxf_scale(matrixf_t *m, float scale);
+int mtxf_mul3(matrixf_t *result, const matrixf_t *m1, const matrixf_t *m2);
+
+// PA = LU in single precision, laid out like mtx_lu_t.
+typedef struct {
+  size_t n;
+  matrixf_t *lu;
+  size_t *piv;
+  int sign;
+} mtxf_lu_t;
+
+mtxf_lu_t *mtxf_lu_alloc(size_t n);
+void mtxf_lu_free(mtxf_lu_t *lu);
+size_t mtxf_lu_workspace_size(size_t n);
+int mtxf_lu_init_workspace(mtxf_lu_t *lu, matrixf_t *storage, size_t n,
+                           mtx_workspace_t *ws);
+int mtxf_lu_factor(mtxf_lu_t *lu, const matrixf_t *m);
+// Overwrites b with A^-1 * b.
+int mtxf_lu_solve(const mtxf_lu_t *lu, matrixf_t *b);
+
+typedef struct {
+  // Stop once ||b - A x|| <= tol * (||A|| ||x|| + ||b||) in the Frobenius
+  // norm; 0 picks sqrt(n) * DBL_EPSILON.
+  double tol;
+  // Correction steps, counting the first solve from x = 0, before falling
+  // back to double precision; 0 picks MTX_REFINE_MAX_ITER.
+  size_t max_iter;
+} mtx_refine_opts_t;
+
+typedef struct {
+  size_t iterations;
+  // Normwise backward error of the returned x.
+  double backward_error;
+  // Set when the float factorization failed or refinement stalled and the
+  // system was solved with mtx_solve instead.
+  int fallback;
+} mtx_refine_info_t;
+
+// x = a^-1 * b to double accuracy from a single-precision LU: the float
+// solution is corrected with residuals computed in double until the backward
+// error reaches the tolerance. Systems too ill-conditioned for float fall
+// back to mtx_solve. x must not overlap a or b; opts and info may be NULL.
+int mtx_solve_mixed(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                    const mtx_refine_opts_t *opts, mtx_refine_info_t *info);
+int mtx_solve_mixed_ws(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                       const mtx_refine_opts_t *opts, mtx_refine_info_t *info,
+                       mtx_workspace_t *ws);
+size_t mtx_solve_mixed_workspace_size(const matrix_t *a, const matrix_t *b);
+
+#endif // MATRIX_FLOAT_H
@@ -0,0 +1,109 @@
+#include "matrix_gemm.h"
+#include "matrix_simd.h"
+#include "matrix_stats.h"
+#include "matrix_threads.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MR MTX_GEMM_MR
+#define NR MTX_GEMM_NR
+
+static size_t gemm_mc = MTX_GEMM_DEFAULT_MC;
+static size_t gemm_kc = MTX_GEMM_DEFAULT_KC;
+static size_t gemm_nc = MTX_GEMM_DEFAULT_NC;
+
+typedef struct {
+  void *buf;
+  size_t cap;
+} pack_cache_t;
+
+static pthread_key_t pack_key;
+static pthread_once_t pack_once = PTHREAD_ONCE_INIT;
+
+static size_t round_up(size_t x, size_t to) { return (x + to - 1) / to * to; }
+
+static void pack_cache_free(void *p) {
+  pack_cache_t *cache = (pack_cache_t *)p;
+  free(cache->buf);
+  free(cache);
+}
+
+static void pack_key_init(void) { pthread_key_create(&pack_key, pack_cache_free); }
+
+// Packing buffers persist per thread and only grow, so repeated products of
+// the same shape never reach malloc. Both element types share the buffer.
+static void *pack_buffer(size_t bytes) {
+  pthread_once(&pack_once, pack_key_init);
+  pack_cache_t *cache = (pack_cache_t *)pthread_getspecific(pack_key);
+  if (!cache) {
+    cache = (pack_cache_t *)calloc(1, sizeof(pack_cache_t));
+    if (!cache || pthread_setspecific(pack_key, cache) != 0) {
+      free(cache);
+      return NULL;
+    }
+  }
+
+  if (cache->cap < bytes) {
+    bytes = round_up(bytes, 64);
+    MTX_STATS_ALLOC(bytes);
+    void *buf = aligned_alloc(64, bytes);
+    if (!buf)
+      return NULL;
+    free(cache->buf);
+    cache->buf = buf;
+    cache->cap = bytes;
+  }
+  return cache->buf;
+}
+
+void mtx_gemm_set_blocking(size_t mc, size_t kc, size_t nc) {
+  gemm_mc = mc ? round_up(mc, MR) : MTX_GEMM_DEFAULT_MC;
+  gemm_kc = kc ? kc : MTX_GEMM_DEFAULT_KC;
+  gemm_nc = nc ? round_up(nc, NR) : MTX_GEMM_DEFAULT_NC;
+}
+
+void mtx_gemm_get_blocking(size_t *mc, size_t *kc, size_t *nc) {
+  if (mc)
+    *mc = gemm_mc;
+  if (kc)
+    *kc = gemm_kc;
+  if (nc)
+    *nc = gemm_nc;
+}
+
+#define GEMM_PASTE_(a, b) a##_##b
+#define GEMM_PASTE(a, b) GEMM_PASTE_(a, b)
+#define GEMM_FN(name) GEMM_PASTE(name, GEMM_SUFFIX)
+
+#define GEMM_T double
+#define GEMM_SUFFIX d
+#define GEMM_NR NR
+#define GEMM_KERNEL gemm_kernel
+#include "matrix_gemm_kernels.h"
+#undef GEMM_T
+#undef GEMM_SUFFIX
+#undef GEMM_NR
+#undef GEMM_KERNEL
+
+#define GEMM_T float
+#define GEMM_SUFFIX s
+#define GEMM_NR MTX_SGEMM_NR
+#define GEMM_KERNEL sgemm_kernel
+#include "matrix_gemm_kernels.h"
+#undef GEMM_T
+#undef GEMM_SUFFIX
+#undef GEMM_NR
+#undef GEMM_KERNEL
+
+int mtx_gemm(size_t m, size_t n, size_t k, double alpha, const double *a,
+             size_t lda, const double *b, size_t ldb, double beta, double *c,
+             size_t ldc) {
+  return gemm_d(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+int mtx_sgemm(size_t m, size_t n, size_t k, float alpha, const float *a,
+              size_t lda, const float *b, size_t ldb, float beta, float *c,
+              size_t ldc) {
+  return gemm_s(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
@@ -0,0 +1,30 @@
+#ifndef MATRIX_GEMM_H
+#define MATRIX_GEMM_H
+
+#include <stddef.h>
+
+#define MTX_GEMM_MR 4
+#define MTX_GEMM_NR 8
+#define MTX_SGEMM_NR 16
+
+#define MTX_GEMM_DEFAULT_MC 128
+#define MTX_GEMM_DEFAULT_KC 256
+#define MTX_GEMM_DEFAULT_NC 4096
+
+#define MTX_GEMM_SMALL_FLOPS (32 * 32 * 32)
+#define MTX_GEMM_PARALLEL_FLOPS (128 * 128 * 128)
+
+void mtx_gemm_set_blocking(size_t mc, size_t kc, size_t nc);
+void mtx_gemm_get_blocking(size_t *mc, size_t *kc, size_t *nc);
+
+// C = alpha * A * B + beta * C for row-major A (m x k), B (k x n), C (m x n).
+// C must not alias A or B. When beta == 0, C is not read.
+int mtx_gemm(size_t m, size_t n, size_t k, double alpha, const double *a,
+             size_t lda, const double *b, size_t ldb, double beta, double *c,
+             size_t ldc);
+// Single-precision mtx_gemm with the same blocking.
+int mtx_sgemm(size_t m, size_t n, size_t k, float alpha, const float *a,
+              size_t lda, const float *b, size_t ldb, float beta, float *c,
+              size_t ldc);
+
+#endif // MATRIX_GEMM_H
@@ -0,0 +1,195 @@
+// Blocked GEMM for one element type. matrix_gemm.c includes this file once
+// per type, defining GEMM_T (element type), GEMM_SUFFIX (name suffix),
+// GEMM_NR (micro-tile width) and GEMM_KERNEL (the mtx_simd_ops_t member
+// computing one MR x GEMM_NR tile).
+
+static void GEMM_FN(scale_c)(size_t m, size_t n, GEMM_T beta, GEMM_T *c,
+                             size_t ldc) {
+  for (size_t i = 0; i < m; ++i) {
+    GEMM_T *row = c + i * ldc;
+    if (beta == 0) {
+      memset(row, 0, n * sizeof(GEMM_T));
+    } else if (beta != 1) {
+      for (size_t j = 0; j < n; ++j) {
+        row[j] *= beta;
+      }
+    }
+  }
+}
+
+static void GEMM_FN(gemm_small)(size_t m, size_t n, size_t k, GEMM_T alpha,
+                                const GEMM_T *a, size_t lda, const GEMM_T *b,
+                                size_t ldb, GEMM_T beta, GEMM_T *c,
+                                size_t ldc) {
+  GEMM_FN(scale_c)(m, n, beta, c, ldc);
+  for (size_t i = 0; i < m; ++i) {
+    GEMM_T *crow = c + i * ldc;
+    for (size_t p = 0; p < k; ++p) {
+      GEMM_T aip = alpha * a[i * lda + p];
+      const GEMM_T *brow = b + p * ldb;
+      for (size_t j = 0; j < n; ++j) {
+        crow[j] += aip * brow[j];
+      }
+    }
+  }
+}
+
+// Packs an mc x kc block of A into MR-row panels, zero-padding the last one.
+static void GEMM_FN(pack_a)(size_t mc, size_t kc, const GEMM_T *a, size_t lda,
+                            GEMM_T *buf) {
+  for (size_t i = 0; i < mc; i += MR) {
+    size_t mr = mc - i < MR ? mc - i : MR;
+    for (size_t p = 0; p < kc; ++p) {
+      for (size_t ii = 0; ii < mr; ++ii) {
+        buf[ii] = a[(i + ii) * lda + p];
+      }
+      for (size_t ii = mr; ii < MR; ++ii) {
+        buf[ii] = 0;
+      }
+      buf += MR;
+    }
+  }
+}
+
+// Packs a kc x nc block of B into GEMM_NR-column panels, zero-padding the
+// last one.
+static void GEMM_FN(pack_b)(size_t kc, size_t nc, const GEMM_T *b, size_t ldb,
+                            GEMM_T *buf) {
+  for (size_t j = 0; j < nc; j += GEMM_NR) {
+    size_t nr = nc - j < GEMM_NR ? nc - j : GEMM_NR;
+    for (size_t p = 0; p < kc; ++p) {
+      const GEMM_T *src = b + p * ldb + j;
+      for (size_t jj = 0; jj < nr; ++jj) {
+        buf[jj] = src[jj];
+      }
+      for (size_t jj = nr; jj < GEMM_NR; ++jj) {
+        buf[jj] = 0;
+      }
+      buf += GEMM_NR;
+    }
+  }
+}
+
+static void GEMM_FN(macro_kernel)(size_t mc, size_t nc, size_t kc,
+                                  GEMM_T alpha, const GEMM_T *apack,
+                                  const GEMM_T *bpack, GEMM_T *c, size_t ldc) {
+  void (*kernel)(size_t, const GEMM_T *, const GEMM_T *, GEMM_T *) =
+      mtx_simd_ops()->GEMM_KERNEL;
+  GEMM_T acc[MR][GEMM_NR];
+  for (size_t j = 0; j < nc; j += GEMM_NR) {
+    size_t nr = nc - j < GEMM_NR ? nc - j : GEMM_NR;
+    const GEMM_T *bp = bpack + j * kc;
+    for (size_t i = 0; i < mc; i += MR) {
+      size_t mr = mc - i < MR ? mc - i : MR;
+      kernel(kc, apack + i * kc, bp, &acc[0][0]);
+      for (size_t ii = 0; ii < mr; ++ii) {
+        GEMM_T *crow = c + (i + ii) * ldc + j;
+        for (size_t jj = 0; jj < nr; ++jj) {
+          crow[jj] += alpha * acc[ii][jj];
+        }
+      }
+    }
+  }
+}
+
+static int GEMM_FN(gemm_packed)(size_t m, size_t n, size_t k, GEMM_T alpha,
+                                const GEMM_T *a, size_t lda, const GEMM_T *b,
+                                size_t ldb, GEMM_T beta, GEMM_T *c,
+                                size_t ldc) {
+  size_t mc_max = gemm_mc, kc_max = gemm_kc, nc_max = gemm_nc;
+  size_t nc_cap = round_up(n < nc_max ? n : nc_max, GEMM_NR);
+  size_t mc_cap = round_up(m < mc_max ? m : mc_max, MR);
+  size_t kc_cap = k < kc_max ? k : kc_max;
+
+  size_t asize = round_up(mc_cap * kc_cap, 64 / sizeof(GEMM_T));
+  GEMM_T *apack =
+      (GEMM_T *)pack_buffer((asize + kc_cap * nc_cap) * sizeof(GEMM_T));
+  if (!apack)
+    return -1;
+  GEMM_T *bpack = apack + asize;
+
+  GEMM_FN(scale_c)(m, n, beta, c, ldc);
+
+  for (size_t jc = 0; jc < n; jc += nc_max) {
+    size_t nc = n - jc < nc_max ? n - jc : nc_max;
+    for (size_t pc = 0; pc < k; pc += kc_max) {
+      size_t kc = k - pc < kc_max ? k - pc : kc_max;
+      GEMM_FN(pack_b)(kc, nc, b + pc * ldb + jc, ldb, bpack);
+      for (size_t ic = 0; ic < m; ic += mc_max) {
+        size_t mc = m - ic < mc_max ? m - ic : mc_max;
+        GEMM_FN(pack_a)(mc, kc, a + ic * lda + pc, lda, apack);
+        GEMM_FN(macro_kernel)(mc, nc, kc, alpha, apack, bpack,
+                              c + ic * ldc + jc, ldc);
+      }
+    }
+  }
+
+  return 0;
+}
+
+typedef struct {
+  size_t m, n, k;
+  GEMM_T alpha, beta;
+  const GEMM_T *a, *b;
+  GEMM_T *c;
+  size_t lda, ldb, ldc;
+  int split_rows;
+  int status;
+} GEMM_FN(gemm_job_t);
+
+// Every element of C is owned by exactly one slab and accumulated in the same
+// k order, so the result does not depend on the thread count.
+static void GEMM_FN(gemm_slab)(void *ctx, size_t begin, size_t end) {
+  GEMM_FN(gemm_job_t) *job = (GEMM_FN(gemm_job_t) *)ctx;
+  int rc;
+
+  if (job->split_rows) {
+    size_t r0 = begin * MR;
+    size_t r1 = end * MR < job->m ? end * MR : job->m;
+    rc = GEMM_FN(gemm_packed)(r1 - r0, job->n, job->k, job->alpha,
+                              job->a + r0 * job->lda, job->lda, job->b,
+                              job->ldb, job->beta, job->c + r0 * job->ldc,
+                              job->ldc);
+  } else {
+    size_t c0 = begin * GEMM_NR;
+    size_t c1 = end * GEMM_NR < job->n ? end * GEMM_NR : job->n;
+    rc = GEMM_FN(gemm_packed)(job->m, c1 - c0, job->k, job->alpha, job->a,
+                              job->lda, job->b + c0, job->ldb, job->beta,
+                              job->c + c0, job->ldc);
+  }
+
+  if (rc != 0)
+    job->status = -1;
+}
+
+static int GEMM_FN(gemm)(size_t m, size_t n, size_t k, GEMM_T alpha,
+                         const GEMM_T *a, size_t lda, const GEMM_T *b,
+                         size_t ldb, GEMM_T beta, GEMM_T *c, size_t ldc) {
+  if (m == 0 || n == 0)
+    return 0;
+  if (!c || (k > 0 && (!a || !b)))
+    return -1;
+
+  if (k == 0 || alpha == 0) {
+    GEMM_FN(scale_c)(m, n, beta, c, ldc);
+    return 0;
+  }
+
+  if (m * n * k <= MTX_GEMM_SMALL_FLOPS) {
+    GEMM_FN(gemm_small)(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+    return 0;
+  }
+
+  if (m * n * k < MTX_GEMM_PARALLEL_FLOPS)
+    return GEMM_FN(gemm_packed)(m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+
+  GEMM_FN(gemm_job_t) job = {m,   n,   k,   alpha, beta,   a, b,
+                             c,   lda, ldb, ldc,   m >= n, 0};
+  if (job.split_rows)
+    mtx_parallel_for((m + MR - 1) / MR, MTX_GEMM_DEFAULT_MC / MR,
+                     GEMM_FN(gemm_slab), &job);
+  else
+    mtx_parallel_for((n + GEMM_NR - 1) / GEMM_NR,
+                     MTX_GEMM_DEFAULT_MC / GEMM_NR, GEMM_FN(gemm_slab), &job);
+  return job.status;
+}
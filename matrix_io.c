@@ -0,0 +1,443 @@
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
+#include "matrix_io.h"
+#include "matrix.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MTX_FILE_IO_CHUNK (1 << 26)
+
+#define FNV_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+_Static_assert(sizeof(mtx_file_header_t) <= MTX_FILE_ALIGN,
+               "header must fit before the payload");
+
+void mtx_checksum_init(mtx_checksum_t *c) {
+  for (size_t i = 0; i < 4; ++i) {
+    c->lane[i] = FNV_BASIS ^ (0x9e3779b97f4a7c15ull * (i + 1));
+  }
+  c->words = 0;
+}
+
+static uint64_t word_at(const double *p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+void mtx_checksum_update(mtx_checksum_t *c, const double *data, size_t count) {
+  size_t i = 0;
+  for (; i < count && (c->words & 3) != 0; ++i, ++c->words) {
+    uint64_t *h = &c->lane[c->words & 3];
+    *h = (*h ^ word_at(data + i)) * FNV_PRIME;
+  }
+
+  uint64_t h0 = c->lane[0], h1 = c->lane[1], h2 = c->lane[2], h3 = c->lane[3];
+  for (; i + 4 <= count; i += 4) {
+    h0 = (h0 ^ word_at(data + i)) * FNV_PRIME;
+    h1 = (h1 ^ word_at(data + i + 1)) * FNV_PRIME;
+    h2 = (h2 ^ word_at(data + i + 2)) * FNV_PRIME;
+    h3 = (h3 ^ word_at(data + i + 3)) * FNV_PRIME;
+    c->words += 4;
+  }
+  c->lane[0] = h0;
+  c->lane[1] = h1;
+  c->lane[2] = h2;
+  c->lane[3] = h3;
+
+  for (; i < count; ++i, ++c->words) {
+    uint64_t *h = &c->lane[c->words & 3];
+    *h = (*h ^ word_at(data + i)) * FNV_PRIME;
+  }
+}
+
+uint64_t mtx_checksum_final(const mtx_checksum_t *c) {
+  uint64_t h = FNV_BASIS;
+  for (size_t i = 0; i < 4; ++i) {
+    h = (h ^ c->lane[i]) * FNV_PRIME;
+  }
+  h = (h ^ c->words) * FNV_PRIME;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t header_checksum(const mtx_file_header_t *header) {
+  mtx_file_header_t h = *header;
+  h.header_checksum = 0;
+  // The header is a whole number of 8-byte words.
+  mtx_checksum_t c;
+  mtx_checksum_init(&c);
+  mtx_checksum_update(&c, (const double *)(const void *)&h,
+                      sizeof(h) / sizeof(double));
+  return mtx_checksum_final(&c);
+}
+
+static int write_all(int fd, const void *data, size_t bytes, uint64_t offset) {
+  const char *p = (const char *)data;
+  while (bytes > 0) {
+    size_t chunk = bytes < MTX_FILE_IO_CHUNK ? bytes : MTX_FILE_IO_CHUNK;
+    ssize_t n = pwrite(fd, p, chunk, (off_t)offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    p += n;
+    bytes -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+  return 0;
+}
+
+static int read_all(int fd, void *data, size_t bytes, uint64_t offset) {
+  char *p = (char *)data;
+  while (bytes > 0) {
+    size_t chunk = bytes < MTX_FILE_IO_CHUNK ? bytes : MTX_FILE_IO_CHUNK;
+    ssize_t n = pread(fd, p, chunk, (off_t)offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    p += n;
+    bytes -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+  return 0;
+}
+
+struct mtx_file_writer {
+  int fd;
+  size_t rows;
+  size_t cols;
+  size_t written;
+  // Elements placed by mtx_file_write_block.
+  size_t placed;
+  uint64_t offset;
+  mtx_checksum_t sum;
+  double *buf;
+  size_t buf_len;
+  size_t buf_cap;
+  int failed;
+};
+
+mtx_file_writer_t *mtx_file_create(const char *path, size_t rows,
+                                   size_t cols) {
+  if (!path || rows == 0 || cols == 0)
+    return NULL;
+  if (rows > SIZE_MAX / sizeof(double) / cols)
+    return NULL;
+
+  mtx_file_writer_t *w = (mtx_file_writer_t *)calloc(1, sizeof(*w));
+  if (!w)
+    return NULL;
+
+  w->buf_cap = MTX_FILE_BUFFER / sizeof(double);
+  w->buf = (double *)malloc(MTX_FILE_BUFFER);
+  // Readable too, for the checksum pass after in-place block writes.
+  w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (!w->buf || w->fd < 0) {
+    if (w->fd >= 0)
+      close(w->fd);
+    free(w->buf);
+    free(w);
+    return NULL;
+  }
+
+  w->rows = rows;
+  w->cols = cols;
+  w->offset = MTX_FILE_ALIGN;
+  mtx_checksum_init(&w->sum);
+  return w;
+}
+
+static int writer_flush(mtx_file_writer_t *w) {
+  if (w->buf_len == 0)
+    return 0;
+  if (write_all(w->fd, w->buf, w->buf_len * sizeof(double), w->offset) != 0)
+    return -1;
+  w->offset += w->buf_len * sizeof(double);
+  w->buf_len = 0;
+  return 0;
+}
+
+int mtx_file_write_rows(mtx_file_writer_t *w, const matrix_t *block) {
+  if (!w || !block || !block->data || w->failed || w->placed)
+    return -1;
+  if (block->cols != w->cols || block->rows > w->rows - w->written)
+    return -1;
+
+  size_t count = block->rows * block->cols;
+  // Large packed blocks go straight to the file; the rest is gathered row
+  // by row so that narrow rows do not turn into tiny writes.
+  if (mtx_is_contiguous(block) && count >= w->buf_cap) {
+    mtx_checksum_update(&w->sum, block->data, count);
+    if (writer_flush(w) != 0 ||
+        write_all(w->fd, block->data, count * sizeof(double), w->offset) !=
+            0) {
+      w->failed = 1;
+      return -1;
+    }
+    w->offset += count * sizeof(double);
+    w->written += block->rows;
+    return 0;
+  }
+
+  for (size_t i = 0; i < block->rows; ++i) {
+    const double *row = mtx_crow(block, i);
+    mtx_checksum_update(&w->sum, row, block->cols);
+    for (size_t j = 0; j < block->cols;) {
+      size_t n = block->cols - j;
+      if (n > w->buf_cap - w->buf_len)
+        n = w->buf_cap - w->buf_len;
+      memcpy(w->buf + w->buf_len, row + j, n * sizeof(double));
+      w->buf_len += n;
+      j += n;
+      if (w->buf_len == w->buf_cap && writer_flush(w) != 0) {
+        w->failed = 1;
+        return -1;
+      }
+    }
+  }
+  w->written += block->rows;
+  return 0;
+}
+
+int mtx_file_write_block(mtx_file_writer_t *w, size_t r0, size_t c0,
+                         const matrix_t *block) {
+  if (!w || !block || !block->data || w->failed || w->written)
+    return -1;
+  if (r0 > w->rows || block->rows > w->rows - r0 || c0 > w->cols ||
+      block->cols > w->cols - c0)
+    return -1;
+
+  uint64_t offset =
+      MTX_FILE_ALIGN + ((uint64_t)r0 * w->cols + c0) * sizeof(double);
+  int rc = 0;
+  // Whole rows from a packed block are one contiguous write.
+  if (block->cols == w->cols && mtx_is_contiguous(block)) {
+    rc = write_all(w->fd, block->data,
+                   block->rows * block->cols * sizeof(double), offset);
+  } else {
+    for (size_t i = 0; i < block->rows && rc == 0; ++i) {
+      rc = write_all(w->fd, mtx_crow(block, i), block->cols * sizeof(double),
+                     offset + (uint64_t)i * w->cols * sizeof(double));
+    }
+  }
+  if (rc != 0) {
+    w->failed = 1;
+    return -1;
+  }
+  w->placed += block->rows * block->cols;
+  return 0;
+}
+
+// Checksum of a payload written in place, read back a buffer at a time.
+static int checksum_placed(mtx_file_writer_t *w) {
+  size_t total = w->rows * w->cols;
+  for (size_t done = 0; done < total;) {
+    size_t n = total - done < w->buf_cap ? total - done : w->buf_cap;
+    if (read_all(w->fd, w->buf, n * sizeof(double),
+                 MTX_FILE_ALIGN + (uint64_t)done * sizeof(double)) != 0)
+      return -1;
+    mtx_checksum_update(&w->sum, w->buf, n);
+    done += n;
+  }
+  return 0;
+}
+
+int mtx_file_close(mtx_file_writer_t *w) {
+  if (!w)
+    return -1;
+
+  int complete = 0;
+  if (!w->failed && w->placed)
+    complete = w->placed == w->rows * w->cols && checksum_placed(w) == 0;
+  else if (!w->failed)
+    complete = w->written == w->rows && writer_flush(w) == 0;
+
+  int rc = -1;
+  if (complete) {
+    mtx_file_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MTX_FILE_MAGIC, sizeof(h.magic));
+    h.version = MTX_FILE_VERSION;
+    h.byte_order = MTX_FILE_BYTE_ORDER;
+    h.dtype = MTX_DTYPE_F64;
+    h.layout = MTX_LAYOUT_ROW_MAJOR;
+    h.rows = w->rows;
+    h.cols = w->cols;
+    h.payload_offset = MTX_FILE_ALIGN;
+    h.payload_bytes = w->rows * w->cols * sizeof(double);
+    h.payload_checksum = mtx_checksum_final(&w->sum);
+    h.header_checksum = header_checksum(&h);
+    if (write_all(w->fd, &h, sizeof(h), 0) == 0)
+      rc = 0;
+  }
+
+  if (close(w->fd) != 0)
+    rc = -1;
+  free(w->buf);
+  free(w);
+  return rc;
+}
+
+int mtx_save(const char *path, const matrix_t *m) {
+  if (!m || !m->data)
+    return -1;
+
+  mtx_file_writer_t *w = mtx_file_create(path, m->rows, m->cols);
+  if (!w)
+    return -1;
+  int rc = mtx_file_write_rows(w, m);
+  return mtx_file_close(w) == 0 ? rc : -1;
+}
+
+// Checks the header against itself and the file size.
+int mtx_file_open(const char *path, mtx_file_header_t *h) {
+  if (!path || !h)
+    return -1;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || read_all(fd, h, sizeof(*h), 0) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  int ok = memcmp(h->magic, MTX_FILE_MAGIC, sizeof(h->magic)) == 0 &&
+           h->version == MTX_FILE_VERSION &&
+           h->byte_order == MTX_FILE_BYTE_ORDER &&
+           h->header_checksum == header_checksum(h) &&
+           h->dtype == MTX_DTYPE_F64 && h->layout == MTX_LAYOUT_ROW_MAJOR &&
+           h->rows > 0 && h->cols > 0 &&
+           h->rows <= SIZE_MAX / sizeof(double) / h->cols &&
+           h->payload_bytes == h->rows * h->cols * sizeof(double) &&
+           h->payload_offset >= sizeof(*h) &&
+           h->payload_offset % MTX_FILE_ALIGN == 0 &&
+           (uint64_t)st.st_size >= h->payload_offset &&
+           (uint64_t)st.st_size - h->payload_offset >= h->payload_bytes;
+  if (!ok) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int mtx_file_info(const char *path, mtx_file_header_t *header) {
+  int fd = mtx_file_open(path, header);
+  if (fd < 0)
+    return -1;
+  close(fd);
+  return 0;
+}
+
+matrix_t *mtx_load(const char *path) {
+  mtx_file_header_t h;
+  int fd = mtx_file_open(path, &h);
+  if (fd < 0)
+    return NULL;
+
+  matrix_t *m = mtx_alloc(h.rows, h.cols);
+  if (m && read_all(fd, m->data, h.payload_bytes, h.payload_offset) != 0) {
+    mtx_free(m);
+    m = NULL;
+  }
+  close(fd);
+
+  if (m) {
+    mtx_checksum_t c;
+    mtx_checksum_init(&c);
+    mtx_checksum_update(&c, m->data, h.rows * h.cols);
+    if (mtx_checksum_final(&c) != h.payload_checksum) {
+      mtx_free(m);
+      m = NULL;
+    }
+  }
+  return m;
+}
+
+int mtx_file_read_block(int fd, const mtx_file_header_t *header, size_t r0,
+                        size_t c0, matrix_t *block) {
+  if (fd < 0 || !header || !block || !block->data)
+    return -1;
+  if (r0 > header->rows || block->rows > header->rows - r0 ||
+      c0 > header->cols || block->cols > header->cols - c0)
+    return -1;
+
+  uint64_t offset = header->payload_offset +
+                    ((uint64_t)r0 * header->cols + c0) * sizeof(double);
+  // Whole rows into a packed block are one contiguous read.
+  if (block->cols == header->cols && mtx_is_contiguous(block))
+    return read_all(fd, block->data, block->rows * block->cols * sizeof(double),
+                    offset);
+
+  for (size_t i = 0; i < block->rows; ++i) {
+    if (read_all(fd, mtx_row(block, i), block->cols * sizeof(double),
+                 offset + (uint64_t)i * header->cols * sizeof(double)) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+// The matrix comes first so mtx_unmap can recover the mapping from it.
+typedef struct {
+  matrix_t m;
+  void *base;
+  size_t length;
+} mapped_t;
+
+const matrix_t *mtx_map(const char *path, int flags) {
+  mtx_file_header_t h;
+  int fd = mtx_file_open(path, &h);
+  if (fd < 0)
+    return NULL;
+
+  mapped_t *map = (mapped_t *)malloc(sizeof(mapped_t));
+  size_t length = h.payload_offset + h.payload_bytes;
+  void *base = map ? mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0)
+                   : MAP_FAILED;
+  close(fd);
+  if (base == MAP_FAILED) {
+    free(map);
+    return NULL;
+  }
+
+  map->base = base;
+  map->length = length;
+  map->m.rows = h.rows;
+  map->m.cols = h.cols;
+  map->m.ld = h.cols;
+  map->m.data = (double *)((char *)base + h.payload_offset);
+  map->m.view = 1;
+
+  if (flags & MTX_MAP_VERIFY) {
+    mtx_checksum_t c;
+    mtx_checksum_init(&c);
+    mtx_checksum_update(&c, map->m.data, h.rows * h.cols);
+    if (mtx_checksum_final(&c) != h.payload_checksum) {
+      mtx_unmap(&map->m);
+      return NULL;
+    }
+  }
+  return &map->m;
+}
+
+void mtx_unmap(const matrix_t *m) {
+  if (m) {
+    mapped_t *map = (mapped_t *)m;
+    munmap(map->base, map->length);
+    free(map);
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include "matrix.h"
+#include <stdint.h>
+
+// Binary matrix files: a fixed header in the first page, then the payload
+// from MTX_FILE_ALIGN on, row after row with no padding. Multi-byte fields
+// are in host byte order; byte_order tells readers on other hosts to refuse.
+#define MTX_FILE_MAGIC "MTXBIN\r\n"
+#define MTX_FILE_VERSION 1
+#define MTX_FILE_ALIGN 4096
+#define MTX_FILE_BYTE_ORDER 0x01020304u
+// Bytes a streamed writer buffers before writing.
+#define MTX_FILE_BUFFER (1 << 20)
+
+typedef enum { MTX_DTYPE_F64 = 1 } mtx_dtype_t;
+typedef enum { MTX_LAYOUT_ROW_MAJOR = 1 } mtx_layout_t;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t dtype;
+  uint32_t layout;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t payload_offset;
+  uint64_t payload_bytes;
+  // mtx_checksum of the payload, and of this header with header_checksum 0.
+  uint64_t payload_checksum;
+  uint64_t header_checksum;
+} mtx_file_header_t;
+
+// Incremental 64-bit checksum over 8-byte words: four interleaved FNV-1a
+// style lanes, so large payloads hash at memory speed. The result does not
+// depend on how the words are split across updates.
+typedef struct {
+  uint64_t lane[4];
+  uint64_t words;
+} mtx_checksum_t;
+
+void mtx_checksum_init(mtx_checksum_t *c);
+void mtx_checksum_update(mtx_checksum_t *c, const double *data, size_t count);
+uint64_t mtx_checksum_final(const mtx_checksum_t *c);
+
+// Streamed writer: rows are appended in blocks through a bounded buffer, and
+// the header is written last by mtx_file_close, which fails unless exactly
+// `rows` rows arrived. A file that was not closed has no valid header.
+typedef struct mtx_file_writer mtx_file_writer_t;
+
+mtx_file_writer_t *mtx_file_create(const char *path, size_t rows,
+                                   size_t cols);
+int mtx_file_write_rows(mtx_file_writer_t *w, const matrix_t *block);
+// Writes block in place at (r0, c0), in any order, instead of appending
+// rows; a writer takes one kind of write or the other. The blocks must
+// cover the matrix exactly once. mtx_file_close then reads the payload back
+// through the write buffer for its checksum.
+int mtx_file_write_block(mtx_file_writer_t *w, size_t r0, size_t c0,
+                         const matrix_t *block);
+int mtx_file_close(mtx_file_writer_t *w);
+
+int mtx_save(const char *path, const matrix_t *m);
+// Reads the header without touching the payload.
+int mtx_file_info(const char *path, mtx_file_header_t *header);
+// Reads a file into a new packed matrix, verifying the payload checksum.
+matrix_t *mtx_load(const char *path);
+
+// Random access without loading everything: mtx_file_open validates the
+// header and returns a descriptor (or -1) for mtx_file_read_block, which
+// fills `block` from the file rows and columns starting at (r0, c0). The
+// payload checksum is not verified.
+int mtx_file_open(const char *path, mtx_file_header_t *header);
+int mtx_file_read_block(int fd, const mtx_file_header_t *header, size_t r0,
+                        size_t c0, matrix_t *block);
+
+#define MTX_MAP_VERIFY 1
+
+// Maps a file as a read-only view with no copy: pages load on first touch.
+// MTX_MAP_VERIFY reads the whole payload once to check its checksum. The
+// result must be released with mtx_unmap, never mtx_free.
+const matrix_t *mtx_map(const char *path, int flags);
+void mtx_unmap(const matrix_t *m);
+
+#endif // MATRIX_IO_H
@@ -0,0 +1,423 @@
+#include "matrix_lu.h"
+#include "matrix_gemm.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MTX_LU_SOLVE_GRAIN 32
+#define MTX_LU_NARROW 8
+#define MTX_LU_MIN_SLAB 64
+
+mtx_lu_t *mtx_lu_alloc(size_t n) {
+  if (n == 0)
+    return NULL;
+
+  mtx_lu_t *lu = (mtx_lu_t *)malloc(sizeof(mtx_lu_t));
+  if (!lu)
+    return NULL;
+
+  lu->n = n;
+  lu->sign = 1;
+  lu->lu = mtx_alloc(n, n);
+  lu->piv = (size_t *)malloc(n * sizeof(size_t));
+  if (!lu->lu || !lu->piv) {
+    mtx_lu_free(lu);
+    return NULL;
+  }
+
+  return lu;
+}
+
+void mtx_lu_free(mtx_lu_t *lu) {
+  if (lu) {
+    mtx_free(lu->lu);
+    free(lu->piv);
+    free(lu);
+  }
+}
+
+size_t mtx_lu_workspace_size(size_t n) {
+  return mtx_workspace_bytes(n * n * sizeof(double)) +
+         mtx_workspace_bytes(n * sizeof(size_t));
+}
+
+int mtx_lu_init_workspace(mtx_lu_t *lu, matrix_t *storage, size_t n,
+                          mtx_workspace_t *ws) {
+  if (!lu || !storage || n == 0)
+    return -1;
+  if (mtx_workspace_matrix(ws, n, n, storage) != 0)
+    return -1;
+
+  lu->piv = (size_t *)mtx_workspace_push(ws, n * sizeof(size_t));
+  if (!lu->piv)
+    return -1;
+
+  lu->n = n;
+  lu->lu = storage;
+  lu->sign = 1;
+  return 0;
+}
+
+static void swap_rows(double *a, double *b, size_t w) {
+  for (size_t j = 0; j < w; ++j) {
+    double t = a[j];
+    a[j] = b[j];
+    b[j] = t;
+  }
+}
+
+// dst -= alpha * src over w elements; short rows skip the dispatch call.
+static void row_update(double *dst, const double *src, double alpha, size_t w,
+                       const mtx_simd_ops_t *ops) {
+  if (w < MTX_LU_NARROW) {
+    for (size_t j = 0; j < w; ++j) {
+      dst[j] -= alpha * src[j];
+    }
+  } else {
+    ops->axpy(dst, src, -alpha, w);
+  }
+}
+
+static void row_divide(double *dst, double d, size_t w) {
+  for (size_t j = 0; j < w; ++j) {
+    dst[j] /= d;
+  }
+}
+
+// Factors columns [k0, k0 + kb) of rows [k0, n). Rows are swapped only inside
+// the panel; the caller applies the swaps to the other columns.
+static int panel_factor(double *a, size_t lda, size_t n, size_t k0, size_t kb,
+                        size_t *piv, int *sign) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+
+  for (size_t k = k0; k < k0 + kb; ++k) {
+    size_t p = k;
+    double max_val = fabs(a[k * lda + k]);
+    for (size_t i = k + 1; i < n; ++i) {
+      double val = fabs(a[i * lda + k]);
+      if (val > max_val) {
+        max_val = val;
+        p = i;
+      }
+    }
+
+    if (max_val < EPSILON)
+      return -1;
+
+    piv[k] = p;
+    if (p != k) {
+      swap_rows(a + k * lda + k0, a + p * lda + k0, kb);
+      *sign = -*sign;
+    }
+
+    const double *prow = a + k * lda;
+    for (size_t r = k + 1; r < n; ++r) {
+      double *row = a + r * lda;
+      double l = row[k] / prow[k];
+      row[k] = l;
+      row_update(row + k + 1, prow + k + 1, l, k0 + kb - k - 1, ops);
+    }
+  }
+
+  return 0;
+}
+
+typedef struct {
+  double *a;
+  size_t lda;
+  size_t n;
+  size_t ncols;
+  size_t *piv;
+  int sign;
+  int status;
+  size_t k0, kb;
+  size_t next0, nextb;
+  size_t rest0, slabs;
+} lu_blocked_t;
+
+static void apply_swaps(const lu_blocked_t *s, size_t c0, size_t c1) {
+  for (size_t k = s->k0; k < s->k0 + s->kb; ++k) {
+    if (s->piv[k] != k)
+      swap_rows(s->a + k * s->lda + c0, s->a + s->piv[k] * s->lda + c0,
+                c1 - c0);
+  }
+}
+
+// Brings columns [c0, c1) up to date with the current panel: row swaps,
+// U12 = L11^-1 * A12, then A22 -= L21 * U12.
+static int update_columns(const lu_blocked_t *s, size_t c0, size_t c1) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  double *a = s->a;
+  size_t lda = s->lda, k0 = s->k0, kb = s->kb, w = c1 - c0;
+
+  apply_swaps(s, c0, c1);
+
+  for (size_t i = k0 + 1; i < k0 + kb; ++i) {
+    const double *lrow = a + i * lda;
+    for (size_t j = k0; j < i; ++j) {
+      if (lrow[j] != 0.0)
+        row_update(a + i * lda + c0, a + j * lda + c0, lrow[j], w, ops);
+    }
+  }
+
+  size_t below = k0 + kb;
+  return mtx_gemm(s->n - below, w, kb, -1.0, a + below * lda + k0, lda,
+                  a + k0 * lda + c0, lda, 1.0, a + below * lda + c0, lda);
+}
+
+// Task 0 factors the next panel while the others update the remaining
+// trailing columns, so the panel stays off the critical path.
+static void lu_step_task(void *ctx, size_t begin, size_t end) {
+  lu_blocked_t *s = (lu_blocked_t *)ctx;
+
+  for (size_t t = begin; t < end; ++t) {
+    if (s->nextb && t == 0) {
+      if (panel_factor(s->a, s->lda, s->n, s->next0, s->nextb, s->piv,
+                       &s->sign) != 0)
+        s->status = -1;
+      continue;
+    }
+
+    size_t slab = s->nextb ? t - 1 : t;
+    size_t width = s->ncols - s->rest0;
+    size_t c0 = s->rest0 + width * slab / s->slabs;
+    size_t c1 = s->rest0 + width * (slab + 1) / s->slabs;
+    if (c0 < c1 && update_columns(s, c0, c1) != 0)
+      s->status = -1;
+  }
+}
+
+int mtx_lu_decompose(matrix_t *m, size_t *piv, int *sign) {
+  if (!m || !m->data || !piv || !sign)
+    return -1;
+  if (m->cols < m->rows)
+    return -1;
+
+  lu_blocked_t s;
+  s.a = m->data;
+  s.lda = m->ld;
+  s.n = m->rows;
+  s.ncols = m->cols;
+  s.piv = piv;
+  s.sign = 1;
+  s.status = 0;
+
+  size_t threads = mtx_get_num_threads();
+  size_t nb = MTX_LU_BLOCK;
+
+  s.kb = s.n < nb ? s.n : nb;
+  if (panel_factor(s.a, s.lda, s.n, 0, s.kb, piv, &s.sign) != 0)
+    return -1;
+
+  for (s.k0 = 0; s.k0 < s.n; s.k0 += s.kb) {
+    s.kb = s.n - s.k0 < nb ? s.n - s.k0 : nb;
+    apply_swaps(&s, 0, s.k0);
+
+    s.next0 = s.k0 + s.kb;
+    s.nextb = s.next0 < s.n ? (s.n - s.next0 < nb ? s.n - s.next0 : nb) : 0;
+    if (s.nextb && update_columns(&s, s.next0, s.next0 + s.nextb) != 0)
+      return -1;
+
+    s.rest0 = s.next0 + s.nextb;
+    size_t width = s.ncols - s.rest0;
+    size_t max_slabs = threads > 1 && s.nextb ? threads - 1 : threads;
+    s.slabs = (width + MTX_LU_MIN_SLAB - 1) / MTX_LU_MIN_SLAB;
+    if (s.slabs > max_slabs)
+      s.slabs = max_slabs;
+
+    size_t tasks = s.slabs + (s.nextb ? 1 : 0);
+    mtx_parallel_for(tasks, 1, lu_step_task, &s);
+    if (s.status != 0)
+      return -1;
+  }
+
+  *sign = s.sign;
+  return 0;
+}
+
+int mtx_lu_factor(mtx_lu_t *lu, const matrix_t *m) {
+  if (!lu || !m || !m->data)
+    return -1;
+  if (m->rows != m->cols || m->rows != lu->n)
+    return -1;
+
+  if (m != lu->lu && mtx_assign(lu->lu, m) != 0)
+    return -1;
+
+  return mtx_lu_decompose(lu->lu, lu->piv, &lu->sign);
+}
+
+typedef struct {
+  const mtx_lu_t *lu;
+  double *b;
+  size_t ldb;
+} lu_solve_job_t;
+
+static void lu_solve_cols(void *ctx, size_t c0, size_t c1) {
+  lu_solve_job_t *job = (lu_solve_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const double *a = job->lu->lu->data;
+  size_t n = job->lu->n, lda = job->lu->lu->ld, ldb = job->ldb, w = c1 - c0;
+  double *b = job->b + c0;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (job->lu->piv[i] != i)
+      swap_rows(b + i * ldb, b + job->lu->piv[i] * ldb, w);
+  }
+
+  // Narrow slabs substitute row by row; wide ones solve MTX_LU_BLOCK rows at
+  // a time and push each block into the remaining rows with GEMM.
+  size_t nb = w < MTX_LU_NARROW ? n : MTX_LU_BLOCK;
+
+  for (size_t i0 = 0; i0 < n; i0 += nb) {
+    size_t i1 = n - i0 < nb ? n : i0 + nb;
+    for (size_t i = i0 + 1; i < i1; ++i) {
+      const double *lrow = a + i * lda;
+      for (size_t j = i0; j < i; ++j) {
+        if (lrow[j] != 0.0)
+          row_update(b + i * ldb, b + j * ldb, lrow[j], w, ops);
+      }
+    }
+    if (i1 < n)
+      mtx_gemm(n - i1, w, i1 - i0, -1.0, a + i1 * lda + i0, lda, b + i0 * ldb,
+               ldb, 1.0, b + i1 * ldb, ldb);
+  }
+
+  for (size_t i1 = n; i1 > 0;) {
+    size_t i0 = i1 > nb ? i1 - nb : 0;
+    for (size_t i = i1; i-- > i0;) {
+      const double *urow = a + i * lda;
+      for (size_t j = i + 1; j < i1; ++j) {
+        if (urow[j] != 0.0)
+          row_update(b + i * ldb, b + j * ldb, urow[j], w, ops);
+      }
+      row_divide(b + i * ldb, urow[i], w);
+    }
+    if (i0 > 0)
+      mtx_gemm(i0, w, i1 - i0, -1.0, a + i0, lda, b + i0 * ldb, ldb, 1.0, b,
+               ldb);
+    i1 = i0;
+  }
+}
+
+static void lu_solve_transpose_cols(void *ctx, size_t c0, size_t c1) {
+  lu_solve_job_t *job = (lu_solve_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const double *a = job->lu->lu->data;
+  size_t n = job->lu->n, lda = job->lu->lu->ld, ldb = job->ldb, w = c1 - c0;
+  double *b = job->b + c0;
+
+  // U^T y = b, walking rows of U.
+  for (size_t i = 0; i < n; ++i) {
+    const double *urow = a + i * lda;
+    row_divide(b + i * ldb, urow[i], w);
+    for (size_t j = i + 1; j < n; ++j) {
+      if (urow[j] != 0.0)
+        row_update(b + j * ldb, b + i * ldb, urow[j], w, ops);
+    }
+  }
+
+  // L^T z = y, walking rows of L from the bottom.
+  for (size_t i = n; i-- > 1;) {
+    const double *lrow = a + i * lda;
+    for (size_t j = 0; j < i; ++j) {
+      if (lrow[j] != 0.0)
+        row_update(b + j * ldb, b + i * ldb, lrow[j], w, ops);
+    }
+  }
+
+  for (size_t i = n; i-- > 0;) {
+    if (job->lu->piv[i] != i)
+      swap_rows(b + i * ldb, b + job->lu->piv[i] * ldb, w);
+  }
+}
+
+// Each row x of B solves x * A = b, i.e. x * P^T * L * U = b.
+static void lu_solve_right_rows(void *ctx, size_t r0, size_t r1) {
+  lu_solve_job_t *job = (lu_solve_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const double *a = job->lu->lu->data;
+  size_t n = job->lu->n, lda = job->lu->lu->ld;
+
+  for (size_t r = r0; r < r1; ++r) {
+    double *x = job->b + r * job->ldb;
+
+    for (size_t i = 0; i < n; ++i) {
+      const double *urow = a + i * lda;
+      x[i] /= urow[i];
+      if (x[i] != 0.0)
+        row_update(x + i + 1, urow + i + 1, x[i], n - i - 1, ops);
+    }
+
+    for (size_t i = n; i-- > 1;) {
+      if (x[i] != 0.0)
+        row_update(x, a + i * lda, x[i], i, ops);
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      size_t p = job->lu->piv[i];
+      if (p != i) {
+        double t = x[i];
+        x[i] = x[p];
+        x[p] = t;
+      }
+    }
+  }
+}
+
+// Rows or columns per slab so that each slab does enough O(n^2) work.
+static size_t solve_grain(size_t n, size_t min_grain) {
+  size_t work = n * n;
+  size_t target = MTX_PARALLEL_MIN_ELEMENTS * MTX_LU_SOLVE_GRAIN;
+  size_t grain = work >= target ? 1 : target / work;
+  return grain < min_grain ? min_grain : grain;
+}
+
+int mtx_lu_solve(const mtx_lu_t *lu, matrix_t *b) {
+  if (!lu || !b || !b->data)
+    return -1;
+  if (b->rows != lu->n)
+    return -1;
+
+  lu_solve_job_t job = {lu, b->data, b->ld};
+  mtx_parallel_for(b->cols, solve_grain(lu->n, MTX_LU_SOLVE_GRAIN),
+                   lu_solve_cols, &job);
+  return 0;
+}
+
+int mtx_lu_solve_transpose(const mtx_lu_t *lu, matrix_t *b) {
+  if (!lu || !b || !b->data)
+    return -1;
+  if (b->rows != lu->n)
+    return -1;
+
+  lu_solve_job_t job = {lu, b->data, b->ld};
+  mtx_parallel_for(b->cols, solve_grain(lu->n, MTX_LU_SOLVE_GRAIN),
+                   lu_solve_transpose_cols, &job);
+  return 0;
+}
+
+int mtx_lu_solve_right(const mtx_lu_t *lu, matrix_t *b) {
+  if (!lu || !b || !b->data)
+    return -1;
+  if (b->cols != lu->n)
+    return -1;
+
+  lu_solve_job_t job = {lu, b->data, b->ld};
+  mtx_parallel_for(b->rows, solve_grain(lu->n, 1), lu_solve_right_rows, &job);
+  return 0;
+}
+
+double mtx_lu_det(const mtx_lu_t *lu) {
+  if (!lu)
+    return 0.0;
+
+  double det = lu->sign;
+  for (size_t i = 0; i < lu->n; ++i) {
+    det *= lu->lu->data[i * lu->lu->ld + i];
+  }
+  return det;
+}
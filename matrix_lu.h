@@ -0,0 +1,41 @@
+#ifndef MATRIX_LU_H
+#define MATRIX_LU_H
+
+#include "matrix.h"
+#include "matrix_workspace.h"
+
+#define MTX_LU_BLOCK 64
+
+// PA = LU with partial pivoting. L (unit diagonal) and U share `lu`;
+// row i was swapped with row piv[i] at step i.
+typedef struct {
+  size_t n;
+  matrix_t *lu;
+  size_t *piv;
+  int sign;
+} mtx_lu_t;
+
+mtx_lu_t *mtx_lu_alloc(size_t n);
+void mtx_lu_free(mtx_lu_t *lu);
+
+// Places the factor storage of an n x n LU in `ws`; `storage` backs lu->lu.
+// Such a factor is released with the workspace, not mtx_lu_free.
+size_t mtx_lu_workspace_size(size_t n);
+int mtx_lu_init_workspace(mtx_lu_t *lu, matrix_t *storage, size_t n,
+                          mtx_workspace_t *ws);
+
+int mtx_lu_factor(mtx_lu_t *lu, const matrix_t *m);
+
+// Blocked right-looking factorization of the leading rows x rows block of m,
+// in place. Trailing columns (cols > rows) receive the same row operations,
+// i.e. L^-1 * P * B. piv must hold m->rows entries.
+int mtx_lu_decompose(matrix_t *m, size_t *piv, int *sign);
+
+// Overwrite B with A^-1 * B, A^-T * B and B * A^-1 respectively.
+int mtx_lu_solve(const mtx_lu_t *lu, matrix_t *b);
+int mtx_lu_solve_transpose(const mtx_lu_t *lu, matrix_t *b);
+int mtx_lu_solve_right(const mtx_lu_t *lu, matrix_t *b);
+
+double mtx_lu_det(const mtx_lu_t *lu);
+
+#endif // MATRIX_LU_H
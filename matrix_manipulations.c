@@ -1,90 +1,320 @@
 #include "matrix_manipulations.h"
 #include "matrix.h"
+#include "matrix_fixed.h"
+#include "matrix_simd.h"
+#include "matrix_stats.h"
+#include "matrix_threads.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int mtx_transpose(matrix_t *m) {
+#define MTX_TRANSPOSE_LEAF 16
+#define MTX_TRANSPOSE_TILE 32
+#define MTX_TRANSPOSE_GRID 8
+
+// dst = src^T for a rows x cols block of src, 4 x 4 tiles at a time.
+static void transpose_block(const double *src, size_t lds, double *dst,
+                            size_t ldd, size_t rows, size_t cols,
+                            const mtx_simd_ops_t *ops) {
+  size_t rows4 = rows & ~(size_t)3, cols4 = cols & ~(size_t)3;
+  for (size_t i = 0; i < rows4; i += 4) {
+    for (size_t j = 0; j < cols4; j += 4) {
+      ops->transpose_4x4(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+    }
+    for (size_t j = cols4; j < cols; ++j) {
+      for (size_t k = i; k < i + 4; ++k) {
+        dst[j * ldd + k] = src[k * lds + j];
+      }
+    }
+  }
+  for (size_t i = rows4; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      dst[j * ldd + i] = src[i * lds + j];
+    }
+  }
+}
+
+// Swaps the rows x cols block a with the transpose of the cols x rows block
+// b, halving the longer side until both fit in cache.
+static void swap_transposed(double *a, double *b, size_t ld, size_t rows,
+                            size_t cols, const mtx_simd_ops_t *ops) {
+  if (rows <= MTX_TRANSPOSE_LEAF && cols <= MTX_TRANSPOSE_LEAF) {
+    double tmp[MTX_TRANSPOSE_LEAF * MTX_TRANSPOSE_LEAF];
+    for (size_t i = 0; i < rows; ++i) {
+      memcpy(tmp + i * cols, a + i * ld, cols * sizeof(double));
+    }
+    transpose_block(b, ld, a, ld, cols, rows, ops);
+    transpose_block(tmp, cols, b, ld, rows, cols, ops);
+    return;
+  }
+
+  if (rows >= cols) {
+    size_t h = rows / 2;
+    swap_transposed(a, b, ld, h, cols, ops);
+    swap_transposed(a + h * ld, b + h, ld, rows - h, cols, ops);
+  } else {
+    size_t h = cols / 2;
+    swap_transposed(a, b, ld, rows, h, ops);
+    swap_transposed(a + h, b + h * ld, ld, rows, cols - h, ops);
+  }
+}
+
+// Cache-oblivious in-place transpose of an n x n block.
+static void transpose_square(double *a, size_t ld, size_t n,
+                             const mtx_simd_ops_t *ops) {
+  if (n <= MTX_TRANSPOSE_LEAF) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = i + 1; j < n; ++j) {
+        double t = a[i * ld + j];
+        a[i * ld + j] = a[j * ld + i];
+        a[j * ld + i] = t;
+      }
+    }
+    return;
+  }
+
+  size_t h = n / 2;
+  transpose_square(a, ld, h, ops);
+  transpose_square(a + h * ld + h, ld, n - h, ops);
+  swap_transposed(a + h, a + h * ld, ld, h, n - h, ops);
+}
+
+typedef struct {
+  double *a;
+  size_t ld;
+  size_t n;
+  size_t grid;
+} square_job_t;
+
+// Each task handles one block pair (bi, bj), bi <= bj, of a grid x grid
+// partition; the pairs are numbered row by row.
+static void transpose_square_pairs(void *ctx, size_t begin, size_t end) {
+  square_job_t *job = (square_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t g = job->grid;
+  for (size_t t = begin; t < end; ++t) {
+    size_t bi = 0, first = 0;
+    while (t >= first + (g - bi)) {
+      first += g - bi;
+      bi++;
+    }
+    size_t bj = bi + (t - first);
+    size_t r0 = job->n * bi / g, r1 = job->n * (bi + 1) / g;
+    size_t c0 = job->n * bj / g, c1 = job->n * (bj + 1) / g;
+    if (bi == bj)
+      transpose_square(job->a + r0 * job->ld + r0, job->ld, r1 - r0, ops);
+    else
+      swap_transposed(job->a + r0 * job->ld + c0, job->a + c0 * job->ld + r0,
+                      job->ld, r1 - r0, c1 - c0, ops);
+  }
+}
+
+// In-place transpose of a packed rows x cols array by following the cycles of
+// the permutation k = i * cols + j -> j * rows + i; `done` marks visited
+// positions, one bit each.
+static void transpose_cycles(double *a, size_t rows, size_t cols,
+                             unsigned char *done) {
+  size_t count = rows * cols;
+  memset(done, 0, (count + 7) / 8);
+  for (size_t start = 1; start + 1 < count; ++start) {
+    if (done[start / 8] & (1u << (start % 8)))
+      continue;
+
+    double carry = a[start];
+    size_t k = start;
+    do {
+      size_t next = (k % cols) * rows + k / cols;
+      double t = a[next];
+      a[next] = carry;
+      carry = t;
+      done[next / 8] |= (unsigned char)(1u << (next % 8));
+      k = next;
+    } while (k != start);
+  }
+}
+
+size_t mtx_transpose_workspace_size(const matrix_t *m) {
+  if (!m || m->rows == m->cols)
+    return 0;
+  return mtx_workspace_bytes((m->rows * m->cols + 7) / 8);
+}
+
+int mtx_transpose(matrix_t *m) { return mtx_transpose_ws(m, NULL); }
+
+int mtx_transpose_ws(matrix_t *m, mtx_workspace_t *ws) {
+  MTX_STATS_OP(TRANSPOSE);
   if (!m)
     return -1;
   if (m->rows * m->cols == 0)
     return 0;
   if (!m->data)
     return -1;
+  // A view cannot change shape inside its parent.
+  if (m->view && m->rows != m->cols)
+    return -1;
 
-  matrix_t *temp = mtx_alloc(m->cols, m->rows);
-  if (!temp)
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double), 0);
+  if (m->rows == m->cols) {
+    size_t n = m->rows;
+    mtx_fixed_transpose_fn fixed = mtx_fixed_transpose(n);
+    if (fixed) {
+      fixed(m->data, m->ld);
+      return 0;
+    }
+    // Parallel sizes (n >= 256) always leave grid blocks of 32+ rows.
+    square_job_t job = {m->data, m->ld, n,
+                        n * n >= MTX_PARALLEL_MIN_ELEMENTS ? MTX_TRANSPOSE_GRID
+                                                           : 1};
+    mtx_parallel_for(job.grid * (job.grid + 1) / 2, 1, transpose_square_pairs,
+                     &job);
+    return 0;
+  }
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_transpose_workspace_size(m)) != 0)
     return -1;
 
-  for (size_t i = 0; i < m->rows; ++i) {
-    for (size_t j = 0; j < m->cols; ++j) {
-      *mtx_ptr(temp, j, i) = *mtx_cptr(m, i, j);
+  unsigned char *done = (unsigned char *)mtx_workspace_push(
+      scratch.ws, (m->rows * m->cols + 7) / 8);
+  if (!done) {
+    mtx_scratch_end(&scratch);
+    return -1;
+  }
+
+  // Squeeze out row padding first so the cycles run over a packed array.
+  if (m->ld != m->cols) {
+    for (size_t i = 1; i < m->rows; ++i) {
+      memmove(m->data + i * m->cols, m->data + i * m->ld,
+              m->cols * sizeof(double));
     }
   }
 
-  mtx_move_assign(m, temp);
+  transpose_cycles(m->data, m->rows, m->cols, done);
+  size_t rows = m->rows;
+  m->rows = m->cols;
+  m->cols = rows;
+  m->ld = rows;
+  mtx_scratch_end(&scratch);
+  return 0;
+}
+
+typedef struct {
+  const double *src;
+  size_t lds;
+  double *dst;
+  size_t ldd;
+  size_t rows;
+  size_t cols;
+} transpose_job_t;
+
+static void transpose_tiles(void *ctx, size_t begin, size_t end) {
+  transpose_job_t *job = (transpose_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  for (size_t i0 = begin * MTX_TRANSPOSE_TILE;
+       i0 < end * MTX_TRANSPOSE_TILE && i0 < job->rows;
+       i0 += MTX_TRANSPOSE_TILE) {
+    size_t ib = job->rows - i0 < MTX_TRANSPOSE_TILE ? job->rows - i0
+                                                    : MTX_TRANSPOSE_TILE;
+    for (size_t j0 = 0; j0 < job->cols; j0 += MTX_TRANSPOSE_TILE) {
+      size_t jb = job->cols - j0 < MTX_TRANSPOSE_TILE ? job->cols - j0
+                                                      : MTX_TRANSPOSE_TILE;
+      transpose_block(job->src + i0 * job->lds + j0, job->lds,
+                      job->dst + j0 * job->ldd + i0, job->ldd, ib, jb, ops);
+    }
+  }
+}
+
+int mtx_transpose_to(const matrix_t *m, matrix_t *result) {
+  MTX_STATS_OP(TRANSPOSE_TO);
+  if (!m || !result)
+    return -1;
+  if (result->rows != m->cols || result->cols != m->rows)
+    return -1;
+  if (m->rows * m->cols == 0)
+    return 0;
+  if (!m->data || !result->data || mtx_overlaps(m, result))
+    return -1;
+
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double), 0);
+  transpose_job_t job = {m->data, m->ld,   result->data,
+                         result->ld, m->rows, m->cols};
+  size_t tiles = (m->rows + MTX_TRANSPOSE_TILE - 1) / MTX_TRANSPOSE_TILE;
+  size_t tile_elems = MTX_TRANSPOSE_TILE * m->cols;
+  mtx_parallel_for(tiles,
+                   tile_elems >= MTX_PARALLEL_MIN_ELEMENTS
+                       ? 1
+                       : MTX_PARALLEL_MIN_ELEMENTS / tile_elems,
+                   transpose_tiles, &job);
   return 0;
 }
 
 int mtx_swap_rows(matrix_t *m, size_t row1, size_t row2) {
+  MTX_STATS_OP(SWAP_ROWS);
   if (!m || !m->data)
     return -1;
   if (row1 >= m->rows || row2 >= m->rows)
     return -1;
+  if (row1 == row2)
+    return 0;
 
+  MTX_STATS_WORK(4 * m->cols * sizeof(double), 0);
+  double *restrict r1 = mtx_row(m, row1);
+  double *restrict r2 = mtx_row(m, row2);
   for (size_t j = 0; j < m->cols; ++j) {
-    double temp = *mtx_ptr(m, row1, j);
-    *mtx_ptr(m, row1, j) = *mtx_ptr(m, row2, j);
-    *mtx_ptr(m, row2, j) = temp;
+    double temp = r1[j];
+    r1[j] = r2[j];
+    r2[j] = temp;
   }
   return 0;
 }
 
 int mtx_swap_cols(matrix_t *m, size_t col1, size_t col2) {
-  if (!m || !m->data)
-    return -1;
-  if (col1 >= m->cols || col2 >= m->cols)
+  MTX_STATS_OP(SWAP_COLS);
+  mtx_span_t c1, c2;
+  if (mtx_col_span(m, col1, &c1) != 0 || mtx_col_span(m, col2, &c2) != 0)
     return -1;
 
-  for (size_t i = 0; i < m->rows; ++i) {
-    double temp = *mtx_ptr(m, i, col1);
-    *mtx_ptr(m, i, col1) = *mtx_ptr(m, i, col2);
-    *mtx_ptr(m, i, col2) = temp;
+  MTX_STATS_WORK(4 * c1.len * sizeof(double), 0);
+  for (size_t i = 0; i < c1.len; ++i) {
+    double temp = c1.data[i * c1.stride];
+    c1.data[i * c1.stride] = c2.data[i * c2.stride];
+    c2.data[i * c2.stride] = temp;
   }
   return 0;
 }
 
 int mtx_scale_row(matrix_t *m, size_t row, double scale) {
-  if (!m || !m->data)
-    return -1;
-  if (row >= m->rows)
+  MTX_STATS_OP(SCALE_ROW);
+  mtx_span_t r;
+  if (mtx_row_span(m, row, &r) != 0)
     return -1;
 
-  for (size_t j = 0; j < m->cols; ++j) {
-    *mtx_ptr(m, row, j) *= scale;
-  }
+  MTX_STATS_WORK(2 * r.len * sizeof(double), r.len);
+  mtx_simd_ops()->scal(r.data, scale, r.len);
   return 0;
 }
 
 int mtx_add_rows(matrix_t *m, size_t dest_row, size_t src_row) {
+  MTX_STATS_OP(ADD_ROWS);
   if (!m || !m->data)
     return -1;
   if (dest_row >= m->rows || src_row >= m->rows)
     return -1;
 
-  for (size_t j = 0; j < m->cols; ++j) {
-    *mtx_ptr(m, dest_row, j) += *mtx_cptr(m, src_row, j);
-  }
+  MTX_STATS_WORK(3 * m->cols * sizeof(double), m->cols);
+  mtx_simd_ops()->add(mtx_row(m, dest_row), mtx_crow(m, src_row), m->cols);
   return 0;
 }
 
 int mtx_add_scaled_row(matrix_t *m, size_t dest_row, size_t src_row, double scale) {
+  MTX_STATS_OP(ADD_SCALED_ROW);
   if (!m || !m->data)
     return -1;
   if (dest_row >= m->rows || src_row >= m->rows)
     return -1;
 
-  for (size_t j = 0; j < m->cols; ++j) {
-    *mtx_ptr(m, dest_row, j) += scale * *mtx_cptr(m, src_row, j);
-  }
+  MTX_STATS_WORK(3 * m->cols * sizeof(double), 2 * m->cols);
+  mtx_simd_ops()->axpy(mtx_row(m, dest_row), mtx_crow(m, src_row), scale,
+                       m->cols);
   return 0;
-} 
\ No newline at end of file
+}
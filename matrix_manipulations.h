@@ -2,8 +2,15 @@
 #define MATRIX_MANIPULATIONS_H
 
 #include "matrix.h"
+#include "matrix_workspace.h"
 
+// In place. Square matrices need no workspace; other shapes follow the
+// permutation cycles with a one-bit-per-element workspace.
 int mtx_transpose(matrix_t *m);
+int mtx_transpose_ws(matrix_t *m, mtx_workspace_t *ws);
+size_t mtx_transpose_workspace_size(const matrix_t *m);
+// result = m^T; result must not overlap m.
+int mtx_transpose_to(const matrix_t *m, matrix_t *result);
 
 int mtx_swap_rows(matrix_t *m, size_t row1, size_t row2);
 int mtx_swap_cols(matrix_t *m, size_t col1, size_t col2);
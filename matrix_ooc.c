@@ -0,0 +1,240 @@
+#include "matrix_ooc.h"
+#include "matrix.h"
+#include "matrix_gemm.h"
+#include "matrix_io.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Two A/B tile pairs, so the next pair loads while GEMM uses the current
+// one.
+#define OOC_SLOTS 4
+
+enum { SLOT_FREE, SLOT_LOADING, SLOT_READY };
+
+static size_t min_size(size_t a, size_t b) { return a < b ? a : b; }
+
+// GEMM packing buffers are cached per thread and sized by the operand
+// shapes, up to the blocking limits.
+static size_t packing_bytes(size_t t) {
+  size_t mc, kc, nc;
+  mtx_gemm_get_blocking(&mc, &kc, &nc);
+  mc = min_size(mc, t) + MTX_GEMM_MR;
+  kc = min_size(kc, t);
+  nc = min_size(nc, t) + MTX_GEMM_NR;
+  return mtx_get_num_threads() * (mc * kc + kc * nc + 64) * sizeof(double);
+}
+
+// The C tile, the A and B slots, the write buffer and packing: nothing
+// here grows with m, n or k.
+static size_t footprint(size_t t) {
+  return (OOC_SLOTS + 1) * t * t * sizeof(double) + MTX_FILE_BUFFER +
+         packing_bytes(t);
+}
+
+size_t mtx_ooc_tile(size_t limit) {
+  if (limit == 0)
+    limit = MTX_OOC_DEFAULT_LIMIT;
+  if (footprint(1) > limit)
+    return 0;
+
+  size_t lo = 1, hi = (size_t)sqrt((double)limit / sizeof(double)) + 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (footprint(mid) <= limit)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+
+typedef struct {
+  int fd[2];
+  mtx_file_header_t h[2];
+  size_t m, n, k, t;
+
+  double *slot[OOC_SLOTS];
+  size_t slot_seq[OOC_SLOTS];
+  int slot_state[OOC_SLOTS];
+  int failed;
+  int stop;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} ooc_t;
+
+// Tiles are consumed in a fixed order: for each output tile and each k
+// block, the A tile, then the B tile. The loader walks the same order.
+static int load_tile(ooc_t *o, size_t seq, int which, size_t r0, size_t c0,
+                     size_t rows, size_t cols) {
+  pthread_mutex_lock(&o->lock);
+  size_t s = OOC_SLOTS;
+  while (!o->stop) {
+    for (s = 0; s < OOC_SLOTS && o->slot_state[s] != SLOT_FREE; ++s) {
+    }
+    if (s < OOC_SLOTS)
+      break;
+    pthread_cond_wait(&o->cond, &o->lock);
+  }
+  if (o->stop) {
+    pthread_mutex_unlock(&o->lock);
+    return -1;
+  }
+  o->slot_state[s] = SLOT_LOADING;
+  o->slot_seq[s] = seq;
+  pthread_mutex_unlock(&o->lock);
+
+  matrix_t block;
+  int rc = mtx_view_data(&block, o->slot[s], rows, cols, cols);
+  if (rc == 0)
+    rc = mtx_file_read_block(o->fd[which], &o->h[which], r0, c0, &block);
+
+  pthread_mutex_lock(&o->lock);
+  o->slot_state[s] = SLOT_READY;
+  if (rc != 0)
+    o->failed = 1;
+  pthread_cond_broadcast(&o->cond);
+  pthread_mutex_unlock(&o->lock);
+  return rc;
+}
+
+static void *loader(void *arg) {
+  ooc_t *o = (ooc_t *)arg;
+  size_t seq = 0, t = o->t;
+  for (size_t i0 = 0; i0 < o->m; i0 += t) {
+    size_t mb = min_size(t, o->m - i0);
+    for (size_t j0 = 0; j0 < o->n; j0 += t) {
+      size_t nb = min_size(t, o->n - j0);
+      for (size_t p0 = 0; p0 < o->k; p0 += t) {
+        size_t kb = min_size(t, o->k - p0);
+        if (load_tile(o, seq++, 0, i0, p0, mb, kb) != 0 ||
+            load_tile(o, seq++, 1, p0, j0, kb, nb) != 0)
+          return NULL;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Waits for tile `seq`; returns its slot, or -1 when loading failed.
+static int acquire(ooc_t *o, size_t seq) {
+  pthread_mutex_lock(&o->lock);
+  for (;;) {
+    if (o->failed)
+      break;
+    for (int s = 0; s < OOC_SLOTS; ++s) {
+      if (o->slot_state[s] == SLOT_READY && o->slot_seq[s] == seq) {
+        pthread_mutex_unlock(&o->lock);
+        return s;
+      }
+    }
+    pthread_cond_wait(&o->cond, &o->lock);
+  }
+  pthread_mutex_unlock(&o->lock);
+  return -1;
+}
+
+static void release(ooc_t *o, int s) {
+  pthread_mutex_lock(&o->lock);
+  o->slot_state[s] = SLOT_FREE;
+  pthread_cond_broadcast(&o->cond);
+  pthread_mutex_unlock(&o->lock);
+}
+
+// Each C tile sums its k blocks in memory and is written at its place in
+// the file.
+static int multiply(ooc_t *o, double *tile, mtx_file_writer_t *w) {
+  size_t seq = 0, t = o->t;
+  for (size_t i0 = 0; i0 < o->m; i0 += t) {
+    size_t mb = min_size(t, o->m - i0);
+    for (size_t j0 = 0; j0 < o->n; j0 += t) {
+      size_t nb = min_size(t, o->n - j0);
+      for (size_t p0 = 0; p0 < o->k; p0 += t) {
+        size_t kb = min_size(t, o->k - p0);
+        int a = acquire(o, seq++);
+        int b = a < 0 ? -1 : acquire(o, seq++);
+        if (b < 0)
+          return -1;
+        int rc = mtx_gemm(mb, nb, kb, 1.0, o->slot[a], kb, o->slot[b], nb,
+                          p0 == 0 ? 0.0 : 1.0, tile, nb);
+        release(o, b);
+        release(o, a);
+        if (rc != 0)
+          return -1;
+      }
+
+      matrix_t c;
+      if (mtx_view_data(&c, tile, mb, nb, nb) != 0 ||
+          mtx_file_write_block(w, i0, j0, &c) != 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+int mtx_ooc_mul(const char *a_path, const char *b_path, const char *c_path,
+                const mtx_ooc_opts_t *opts) {
+  if (!a_path || !b_path || !c_path)
+    return -1;
+
+  ooc_t o;
+  memset(&o, 0, sizeof(o));
+  o.fd[0] = mtx_file_open(a_path, &o.h[0]);
+  o.fd[1] = mtx_file_open(b_path, &o.h[1]);
+  int rc = -1;
+  if (o.fd[0] < 0 || o.fd[1] < 0 || o.h[0].cols != o.h[1].rows)
+    goto close_files;
+
+  o.m = o.h[0].rows;
+  o.k = o.h[0].cols;
+  o.n = o.h[1].cols;
+  size_t limit = opts && opts->memory_limit ? opts->memory_limit
+                                            : MTX_OOC_DEFAULT_LIMIT;
+  o.t = opts && opts->tile ? opts->tile : mtx_ooc_tile(limit);
+  size_t largest = o.m > o.k ? o.m : o.k;
+  o.t = min_size(o.t, largest > o.n ? largest : o.n);
+  if (o.t == 0 || footprint(o.t) > limit)
+    goto close_files;
+
+  double *tile = (double *)malloc(o.t * o.t * sizeof(double));
+  int slots_ok = 1;
+  for (int s = 0; s < OOC_SLOTS; ++s) {
+    o.slot[s] = (double *)malloc(o.t * o.t * sizeof(double));
+    slots_ok &= o.slot[s] != NULL;
+  }
+  mtx_file_writer_t *w = mtx_file_create(c_path, o.m, o.n);
+
+  pthread_t thread;
+  if (tile && slots_ok && w) {
+    pthread_mutex_init(&o.lock, NULL);
+    pthread_cond_init(&o.cond, NULL);
+    if (pthread_create(&thread, NULL, loader, &o) == 0) {
+      rc = multiply(&o, tile, w);
+      // Unblock the loader if the multiply stopped early.
+      pthread_mutex_lock(&o.lock);
+      o.stop = 1;
+      pthread_cond_broadcast(&o.cond);
+      pthread_mutex_unlock(&o.lock);
+      pthread_join(thread, NULL);
+    }
+    pthread_cond_destroy(&o.cond);
+    pthread_mutex_destroy(&o.lock);
+  }
+
+  if (w && mtx_file_close(w) != 0)
+    rc = -1;
+  for (int s = 0; s < OOC_SLOTS; ++s) {
+    free(o.slot[s]);
+  }
+  free(tile);
+
+close_files:
+  if (o.fd[0] >= 0)
+    close(o.fd[0]);
+  if (o.fd[1] >= 0)
+    close(o.fd[1]);
+  return rc;
+}
@@ -0,0 +1,28 @@
+#ifndef MATRIX_OOC_H
+#define MATRIX_OOC_H
+
+#include <stddef.h>
+
+#define MTX_OOC_DEFAULT_LIMIT ((size_t)256 << 20)
+
+typedef struct {
+  // Bytes for the A and B tile buffers, the output tile, the write buffer
+  // and GEMM packing together; 0 means MTX_OOC_DEFAULT_LIMIT.
+  size_t memory_limit;
+  // Tile edge; 0 picks the largest one the limit allows.
+  size_t tile;
+} mtx_ooc_opts_t;
+
+// c = a * b for operands in matrix files (see matrix_io.h), writing c as
+// another file. Tiles are read with pread while a background thread loads
+// the next pair during each in-memory GEMM, and each finished C tile is
+// written in place. Memory use does not depend on the matrix sizes. opts
+// may be NULL.
+int mtx_ooc_mul(const char *a_path, const char *b_path, const char *c_path,
+                const mtx_ooc_opts_t *opts);
+
+// Tile edge mtx_ooc_mul uses, or 0 when `limit` cannot hold even
+// single-element tiles.
+size_t mtx_ooc_tile(size_t limit);
+
+#endif // MATRIX_OOC_H
@@ -1,11 +1,150 @@
 #include "matrix_operations.h"
 #include "matrix.h"
+#include "matrix_chol.h"
+#include "matrix_expr.h"
+#include "matrix_fixed.h"
+#include "matrix_gemm.h"
+#include "matrix_lu.h"
+#include "matrix_simd.h"
+#include "matrix_stats.h"
+#include "matrix_strassen.h"
+#include "matrix_threads.h"
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define MTX_NORM_MAX_CHUNKS 64
+
+typedef enum { EW_ADD, EW_SUB, EW_AXPY, EW_SCAL } elementwise_op_t;
+
+// Operands are walked as rows of `cols` elements with their own leading
+// dimensions; contiguous operands are passed as a single long row.
+typedef struct {
+  elementwise_op_t op;
+  double *dst;
+  const double *src;
+  size_t dst_ld;
+  size_t src_ld;
+  size_t cols;
+  double scale;
+} elementwise_job_t;
+
+static void elementwise_range(void *ctx, size_t begin, size_t end) {
+  elementwise_job_t *job = (elementwise_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  while (begin < end) {
+    size_t i = begin / job->cols, j = begin % job->cols;
+    size_t len = job->cols - j < end - begin ? job->cols - j : end - begin;
+    double *dst = job->dst + i * job->dst_ld + j;
+    const double *src = job->src ? job->src + i * job->src_ld + j : NULL;
+    switch (job->op) {
+    case EW_ADD:
+      ops->add(dst, src, len);
+      break;
+    case EW_SUB:
+      ops->sub(dst, src, len);
+      break;
+    case EW_AXPY:
+      ops->axpy(dst, src, job->scale, len);
+      break;
+    case EW_SCAL:
+      ops->scal(dst, job->scale, len);
+      break;
+    }
+    begin += len;
+  }
+}
+
+static void elementwise(elementwise_op_t op, matrix_t *dst,
+                        const matrix_t *src, double scale) {
+  size_t count = dst->rows * dst->cols;
+  elementwise_job_t job = {op,         dst->data, src ? src->data : NULL,
+                           dst->ld,    src ? src->ld : 0,
+                           dst->cols,  scale};
+  if (mtx_is_contiguous(dst) && (!src || mtx_is_contiguous(src)))
+    job.cols = count;
+  mtx_parallel_for(count, MTX_PARALLEL_MIN_ELEMENTS, elementwise_range, &job);
+}
+
+typedef struct {
+  const double *data;
+  size_t ld;
+  size_t cols;
+  size_t count;
+  size_t chunks;
+  int find_max;
+  double scale;
+  double partial[MTX_NORM_MAX_CHUNKS];
+} norm_job_t;
+
+static void norm_range(void *ctx, size_t begin, size_t end) {
+  norm_job_t *job = (norm_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  for (size_t c = begin; c < end; ++c) {
+    size_t lo = job->count * c / job->chunks;
+    size_t hi = job->count * (c + 1) / job->chunks;
+    double r = 0.0;
+    while (lo < hi) {
+      size_t i = lo / job->cols, j = lo % job->cols;
+      size_t len = job->cols - j < hi - lo ? job->cols - j : hi - lo;
+      const double *p = job->data + i * job->ld + j;
+      if (!job->find_max) {
+        r += ops->sumsq(p, job->scale, len);
+      } else {
+        double mx = ops->amax(p, len);
+        r = (mx > r || isnan(mx)) ? mx : r;
+      }
+      lo += len;
+    }
+    job->partial[c] = r;
+  }
+}
+
+static double norm_pass(norm_job_t *job) {
+  mtx_parallel_for(job->chunks, 1, norm_range, job);
+
+  double r = 0.0;
+  for (size_t c = 0; c < job->chunks; ++c) {
+    if (job->find_max)
+      r = (job->partial[c] > r || isnan(job->partial[c])) ? job->partial[c] : r;
+    else
+      r += job->partial[c];
+  }
+  return r;
+}
+
+typedef struct {
+  matrix_t *m;
+  size_t pivot;
+  size_t first_col;
+} elimination_job_t;
+
+// Eliminates column `pivot` from rows [begin, end) using the pivot row.
+static void eliminate_rows(void *ctx, size_t begin, size_t end) {
+  elimination_job_t *job = (elimination_job_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t cols = job->m->cols, first = job->first_col;
+  const double *prow = mtx_crow(job->m, job->pivot);
+  double pval = prow[job->pivot];
+
+  for (size_t j = begin; j < end; ++j) {
+    if (j == job->pivot)
+      continue;
+    double *row = mtx_row(job->m, j);
+    double factor = row[job->pivot] / pval;
+    ops->axpy(row + first, prow + first, -factor, cols - first);
+  }
+}
+
+static size_t elimination_grain(size_t cols) {
+  return cols > MTX_PARALLEL_MIN_ELEMENTS ? 1
+                                          : MTX_PARALLEL_MIN_ELEMENTS / cols;
+}
+
 int mtx_add(matrix_t *m1, const matrix_t *m2) {
+  MTX_STATS_OP(ADD);
   if (!m1 || !m2)
     return -1;
   if (m1->rows != m2->rows || m1->cols != m2->cols)
@@ -15,13 +154,14 @@ int mtx_add(matrix_t *m1, const matrix_t *m2) {
   if (!m1->data || !m2->data)
     return -1;
 
-  for (size_t i = 0; i < m1->rows * m1->cols; ++i) {
-    m1->data[i] += m2->data[i];
-  }
+  MTX_STATS_WORK(3 * m1->rows * m1->cols * sizeof(double),
+                 m1->rows * m1->cols);
+  elementwise(EW_ADD, m1, m2, 1.0);
   return 0;
 }
 
 int mtx_sub(matrix_t *m1, const matrix_t *m2) {
+  MTX_STATS_OP(SUB);
   if (!m1 || !m2)
     return -1;
   if (m1->rows != m2->rows || m1->cols != m2->cols)
@@ -31,41 +171,101 @@ int mtx_sub(matrix_t *m1, const matrix_t *m2) {
   if (!m1->data || !m2->data)
     return -1;
 
-  for (size_t i = 0; i < m1->rows * m1->cols; ++i) {
-    m1->data[i] -= m2->data[i];
-  }
+  MTX_STATS_WORK(3 * m1->rows * m1->cols * sizeof(double),
+                 m1->rows * m1->cols);
+  elementwise(EW_SUB, m1, m2, 1.0);
   return 0;
 }
 
+// Products with every dimension at the Strassen cutoff take that path once
+// it is enabled; everything else goes to GEMM.
+static int use_strassen(size_t m, size_t n, size_t k) {
+  size_t cutoff = mtx_strassen_get_cutoff();
+  return cutoff && m >= cutoff && n >= cutoff && k >= cutoff;
+}
+
+static int product(size_t m, size_t n, size_t k, const double *a, size_t lda,
+                   const double *b, size_t ldb, double *c, size_t ldc,
+                   mtx_workspace_t *ws) {
+  if (use_strassen(m, n, k))
+    return mtx_strassen_ws(m, n, k, a, lda, b, ldb, c, ldc, ws);
+  return mtx_gemm(m, n, k, 1.0, a, lda, b, ldb, 0.0, c, ldc);
+}
+
+size_t mtx_mul_workspace_size(const matrix_t *m1, const matrix_t *m2) {
+  if (!m1 || !m2)
+    return 0;
+  size_t bytes = mtx_workspace_bytes(m1->rows * m2->cols * sizeof(double));
+  if (use_strassen(m1->rows, m2->cols, m1->cols))
+    bytes += mtx_strassen_workspace_size(m1->rows, m2->cols, m1->cols);
+  return bytes;
+}
+
 int mtx_mul(matrix_t *m1, const matrix_t *m2) {
+  return mtx_mul_ws(m1, m2, NULL);
+}
+
+int mtx_mul_ws(matrix_t *m1, const matrix_t *m2, mtx_workspace_t *ws) {
+  MTX_STATS_OP(MUL);
   if (!m1 || !m2)
     return -1;
   if (m1->cols != m2->rows)
     return -1;
+  // A view keeps its shape; the product must fit in place.
+  if (m1->view && m2->cols != m1->cols)
+    return -1;
   if (m1->rows * m1->cols == 0 || m2->rows * m2->cols == 0)
     return 0;
   if (!m1->data || !m2->data)
     return -1;
 
-  matrix_t *temp = mtx_alloc(m1->rows, m2->cols);
-  if (!temp)
+  MTX_STATS_WORK((m1->rows * m1->cols + m2->rows * m2->cols +
+                  m1->rows * m2->cols) * sizeof(double),
+                 2 * m1->rows * m2->cols * m1->cols);
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_mul_workspace_size(m1, m2)) != 0)
     return -1;
 
-  for (size_t i = 0; i < m1->rows; ++i) {
-    for (size_t j = 0; j < m2->cols; ++j) {
-      double sum = 0.0;
-      for (size_t k = 0; k < m1->cols; ++k) {
-        sum += *mtx_cptr(m1, i, k) * *mtx_cptr(m2, k, j);
-      }
-      *mtx_ptr(temp, i, j) = sum;
+  size_t rows = m1->rows, cols = m2->cols;
+  double *temp = mtx_workspace_doubles(scratch.ws, rows * cols);
+  if (!temp || product(rows, cols, m1->cols, m1->data, m1->ld, m2->data,
+                       m2->ld, temp, cols, scratch.ws) != 0) {
+    mtx_scratch_end(&scratch);
+    return -1;
+  }
+
+  // Only a product wider than m1's rows needs a bigger buffer.
+  if (cols > m1->ld) {
+    size_t ld = mtx_padded_ld(cols);
+    double *grown = mtx_alloc_buffer(rows, ld);
+    if (!grown) {
+      mtx_scratch_end(&scratch);
+      return -1;
     }
+    free(m1->data);
+    m1->data = grown;
+    m1->ld = ld;
   }
 
-  mtx_move_assign(m1, temp);
+  for (size_t i = 0; i < rows; ++i) {
+    memcpy(mtx_row(m1, i), temp + i * cols, cols * sizeof(double));
+  }
+  m1->cols = cols;
+  mtx_scratch_end(&scratch);
   return 0;
 }
 
+size_t mtx_div_workspace_size(const matrix_t *m1, const matrix_t *m2) {
+  (void)m1;
+  return m2 ? mtx_lu_workspace_size(m2->rows) : 0;
+}
+
 int mtx_div(matrix_t *m1, const matrix_t *m2) {
+  return mtx_div_ws(m1, m2, NULL);
+}
+
+int mtx_div_ws(matrix_t *m1, const matrix_t *m2, mtx_workspace_t *ws) {
+  MTX_STATS_OP(DIV);
   if (!m1 || !m2)
     return -1;
   if (m1->cols != m2->rows || m2->rows != m2->cols)
@@ -75,42 +275,26 @@ int mtx_div(matrix_t *m1, const matrix_t *m2) {
   if (!m1->data || !m2->data)
     return -1;
 
-  matrix_t *inv = mtx_alloc(m2->rows, m2->cols);
-  if (!inv)
+  MTX_STATS_WORK((2 * m1->rows * m1->cols + m2->rows * m2->cols) *
+                     sizeof(double),
+                 (2 * m2->rows + 6 * m1->rows) * m2->rows * m2->rows / 3);
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_div_workspace_size(m1, m2)) != 0)
     return -1;
 
-  if (mtx_inverse(m2, inv) != 0) {
-    mtx_free(inv);
-    return -1;
-  }
-
-  matrix_t *temp = mtx_alloc(m1->rows, m2->cols);
-  if (!temp) {
-    mtx_free(inv);
-    return -1;
-  }
-
-  matrix_t *m1_copy = mtx_copy(m1);
-  if (!m1_copy) {
-    mtx_free(inv);
-    mtx_free(temp);
-    return -1;
-  }
-
-  if (mtx_mul(m1_copy, inv) != 0) {
-    mtx_free(inv);
-    mtx_free(temp);
-    mtx_free(m1_copy);
-    return -1;
-  }
+  mtx_lu_t lu;
+  matrix_t lu_storage;
+  int rc = -1;
+  if (mtx_lu_init_workspace(&lu, &lu_storage, m2->rows, scratch.ws) == 0 &&
+      mtx_lu_factor(&lu, m2) == 0)
+    rc = mtx_lu_solve_right(&lu, m1);
 
-  mtx_move_assign(temp, m1_copy);
-  mtx_move_assign(m1, temp);
-  mtx_free(inv);
-  return 0;
+  mtx_scratch_end(&scratch);
+  return rc;
 }
 
 int mtx_add_scaled(matrix_t *m1, const matrix_t *m2, double scale) {
+  MTX_STATS_OP(ADD_SCALED);
   if (!m1 || !m2)
     return -1;
   if (m1->rows != m2->rows || m1->cols != m2->cols)
@@ -120,13 +304,14 @@ int mtx_add_scaled(matrix_t *m1, const matrix_t *m2, double scale) {
   if (!m1->data || !m2->data)
     return -1;
 
-  for (size_t i = 0; i < m1->rows * m1->cols; ++i) {
-    m1->data[i] += scale * m2->data[i];
-  }
+  MTX_STATS_WORK(3 * m1->rows * m1->cols * sizeof(double),
+                 2 * m1->rows * m1->cols);
+  elementwise(EW_AXPY, m1, m2, scale);
   return 0;
 }
 
 int mtx_scale(matrix_t *m, double scale) {
+  MTX_STATS_OP(SCALE);
   if (!m)
     return -1;
   if (m->rows * m->cols == 0)
@@ -134,24 +319,98 @@ int mtx_scale(matrix_t *m, double scale) {
   if (!m->data)
     return -1;
 
-  for (size_t i = 0; i < m->rows * m->cols; ++i) {
-    m->data[i] *= scale;
-  }
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double), m->rows * m->cols);
+  elementwise(EW_SCAL, m, NULL, scale);
   return 0;
 }
 
 double mtx_norm(const matrix_t *m) {
+  MTX_STATS_OP(NORM);
   if (!m || !m->data)
     return 0.0;
 
-  double sum = 0.0;
-  for (size_t i = 0; i < m->rows * m->cols; ++i) {
-    sum += m->data[i] * m->data[i];
+  MTX_STATS_WORK(m->rows * m->cols * sizeof(double), 2 * m->rows * m->cols);
+  // Fixed chunking keeps the summation order independent of thread count.
+  norm_job_t job;
+  job.data = m->data;
+  job.ld = m->ld;
+  job.count = m->rows * m->cols;
+  job.cols = mtx_is_contiguous(m) ? job.count : m->cols;
+  job.chunks = (job.count + MTX_PARALLEL_MIN_ELEMENTS - 1) /
+               MTX_PARALLEL_MIN_ELEMENTS;
+  if (job.chunks > MTX_NORM_MAX_CHUNKS)
+    job.chunks = MTX_NORM_MAX_CHUNKS;
+  if (job.chunks == 0)
+    return 0.0;
+
+  job.find_max = 0;
+  job.scale = 1.0;
+  double sum = norm_pass(&job);
+  if (sum >= DBL_MIN / DBL_EPSILON && sum <= DBL_MAX)
+    return sqrt(sum);
+  if (isnan(sum))
+    return sum;
+
+  // The squares overflowed or lost precision to underflow: rescale by the
+  // largest magnitude and sum again.
+  job.find_max = 1;
+  double amax = norm_pass(&job);
+  if (amax == 0.0 || isinf(amax) || isnan(amax))
+    return amax;
+
+  job.find_max = 0;
+  job.scale = 1.0 / amax;
+  return amax * sqrt(norm_pass(&job));
+}
+
+// Factorization of a square system: Cholesky when the matrix is symmetric
+// positive definite, LU otherwise.
+typedef struct {
+  int chol;
+  mtx_chol_t c;
+  mtx_lu_t lu;
+  matrix_t storage;
+} factor_t;
+
+static size_t factor_workspace_size(size_t n) {
+  size_t lu = mtx_lu_workspace_size(n), chol = mtx_chol_workspace_size(n);
+  return lu > chol ? lu : chol;
+}
+
+// Symmetric input tries Cholesky first; when it turns out not to be positive
+// definite, or is numerically singular, LU reuses the same workspace and
+// makes the final call with its own pivot test.
+static int factor_square(factor_t *f, const matrix_t *a, mtx_workspace_t *ws) {
+  size_t n = a->rows;
+  if (mtx_is_symmetric(a, MTX_SYMMETRY_TOL)) {
+    size_t mark = mtx_workspace_mark(ws);
+    f->chol = 1;
+    if (mtx_chol_init_workspace(&f->c, &f->storage, n, ws) == 0 &&
+        mtx_chol_factor_ws(&f->c, a, ws) == 0)
+      return 0;
+    mtx_workspace_release(ws, mark);
   }
-  return sqrt(sum);
+
+  f->chol = 0;
+  if (mtx_lu_init_workspace(&f->lu, &f->storage, n, ws) != 0)
+    return -1;
+  return mtx_lu_factor(&f->lu, a);
+}
+
+static int factor_solve(const factor_t *f, matrix_t *b) {
+  return f->chol ? mtx_chol_solve(&f->c, b) : mtx_lu_solve(&f->lu, b);
+}
+
+size_t mtx_inverse_workspace_size(const matrix_t *m) {
+  return m ? factor_workspace_size(m->rows) : 0;
 }
 
 int mtx_inverse(const matrix_t *m, matrix_t *inv) {
+  return mtx_inverse_ws(m, inv, NULL);
+}
+
+int mtx_inverse_ws(const matrix_t *m, matrix_t *inv, mtx_workspace_t *ws) {
+  MTX_STATS_OP(INVERSE);
   if (!m || !inv)
     return -1;
   if (m->rows != m->cols || inv->rows != inv->cols || m->rows != inv->rows)
@@ -161,101 +420,190 @@ int mtx_inverse(const matrix_t *m, matrix_t *inv) {
   if (!m->data || !inv->data)
     return -1;
 
-  matrix_t *aug = mtx_alloc(m->rows, 2 * m->cols);
-  if (!aug)
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double),
+                 2 * m->rows * m->rows * m->rows);
+  mtx_fixed_inverse_fn fixed = mtx_fixed_inverse(m->rows);
+  if (fixed)
+    return fixed(inv->data, inv->ld, m->data, m->ld);
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_inverse_workspace_size(m)) != 0)
     return -1;
 
-  for (size_t i = 0; i < m->rows; ++i) {
-    for (size_t j = 0; j < m->cols; ++j) {
-      *mtx_ptr(aug, i, j) = *mtx_cptr(m, i, j);
-    }
-    *mtx_ptr(aug, i, i + m->cols) = 1.0;
+  factor_t f;
+  int rc = -1;
+  if (factor_square(&f, m, scratch.ws) == 0) {
+    mtx_set_id(inv);
+    rc = factor_solve(&f, inv);
   }
 
-  if (mtx_gauss_elimination(aug) != 0) {
-    mtx_free(aug);
+  mtx_scratch_end(&scratch);
+  return rc;
+}
+
+size_t mtx_solve_workspace_size(const matrix_t *a) {
+  return a ? factor_workspace_size(a->rows) : 0;
+}
+
+int mtx_solve(const matrix_t *a, const matrix_t *b, matrix_t *x) {
+  return mtx_solve_ws(a, b, x, NULL);
+}
+
+int mtx_solve_ws(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                 mtx_workspace_t *ws) {
+  MTX_STATS_OP(SOLVE);
+  if (!a || !b || !x)
+    return -1;
+  if (a->rows != a->cols || b->rows != a->rows)
+    return -1;
+  if (x->rows != b->rows || x->cols != b->cols)
+    return -1;
+  if (a->rows * b->cols == 0)
+    return 0;
+  if (!a->data || !b->data || !x->data)
+    return -1;
+  if (mtx_overlaps(x, a) || (x->data != b->data && mtx_overlaps(x, b)))
     return -1;
-  }
 
-  for (size_t i = 0; i < m->rows; ++i) {
-    for (size_t j = 0; j < m->cols; ++j) {
-      *mtx_ptr(inv, i, j) = *mtx_cptr(aug, i, j + m->cols);
+  MTX_STATS_WORK((a->rows * a->cols + 2 * b->rows * b->cols) * sizeof(double),
+                 (2 * a->rows + 6 * b->cols) * a->rows * a->rows / 3);
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_solve_workspace_size(a)) != 0)
+    return -1;
+
+  factor_t f;
+  int rc = -1;
+  if (factor_square(&f, a, scratch.ws) == 0 &&
+      (x == b || mtx_assign(x, b) == 0))
+    rc = factor_solve(&f, x);
+
+  mtx_scratch_end(&scratch);
+  return rc;
+}
+
+typedef struct {
+  const matrix_t *a, *x;
+  matrix_t *r;
+} residual_job_t;
+
+// Rows of r -= a * x as dot products, for x narrower than a GEMM tile.
+static void residual_rows(void *ctx, size_t begin, size_t end) {
+  residual_job_t *job = (residual_job_t *)ctx;
+  size_t k = job->a->cols, ldx = job->x->ld;
+  for (size_t i = begin; i < end; ++i) {
+    const double *arow = mtx_crow(job->a, i);
+    double *rrow = mtx_row(job->r, i);
+    for (size_t c = 0; c < job->x->cols; ++c) {
+      const double *xc = job->x->data + c;
+      double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+      size_t p = 0;
+      for (; p + 4 <= k; p += 4) {
+        s0 += arow[p] * xc[p * ldx];
+        s1 += arow[p + 1] * xc[(p + 1) * ldx];
+        s2 += arow[p + 2] * xc[(p + 2) * ldx];
+        s3 += arow[p + 3] * xc[(p + 3) * ldx];
+      }
+      for (; p < k; ++p) {
+        s0 += arow[p] * xc[p * ldx];
+      }
+      rrow[c] -= (s0 + s1) + (s2 + s3);
     }
   }
+}
 
-  mtx_free(aug);
-  return 0;
+int mtx_residual(const matrix_t *a, const matrix_t *x, const matrix_t *b,
+                 matrix_t *r) {
+  MTX_STATS_OP(RESIDUAL);
+  if (!a || !x || !b || !r)
+    return -1;
+  if (a->cols != x->rows || b->rows != a->rows || b->cols != x->cols)
+    return -1;
+  if (r->rows != b->rows || r->cols != b->cols)
+    return -1;
+  if (r->rows * r->cols == 0)
+    return 0;
+  if (!a->data || !x->data || !b->data || !r->data)
+    return -1;
+  if (mtx_overlaps(r, a) || mtx_overlaps(r, x) ||
+      (r->data != b->data && mtx_overlaps(r, b)))
+    return -1;
+
+  MTX_STATS_WORK((a->rows * a->cols + x->rows * x->cols +
+                  2 * r->rows * r->cols) * sizeof(double),
+                 2 * a->rows * a->cols * x->cols);
+  if (r->data != b->data && mtx_assign(r, b) != 0)
+    return -1;
+  if (x->cols < MTX_GEMM_NR) {
+    residual_job_t job = {a, x, r};
+    size_t work = a->cols * x->cols;
+    mtx_parallel_for(a->rows,
+                     work >= MTX_PARALLEL_MIN_ELEMENTS
+                         ? 1
+                         : MTX_PARALLEL_MIN_ELEMENTS / work,
+                     residual_rows, &job);
+    return 0;
+  }
+  return mtx_gemm(a->rows, x->cols, a->cols, -1.0, a->data, a->ld, x->data,
+                  x->ld, 1.0, r->data, r->ld);
+}
+
+size_t mtx_gauss_elimination_workspace_size(const matrix_t *m) {
+  return m ? mtx_workspace_bytes(m->rows * sizeof(size_t)) : 0;
 }
 
 int mtx_gauss_elimination(matrix_t *m) {
+  return mtx_gauss_elimination_ws(m, NULL);
+}
+
+int mtx_gauss_elimination_ws(matrix_t *m, mtx_workspace_t *ws) {
+  MTX_STATS_OP(GAUSS_ELIMINATION);
   if (!m || !m->data)
     return -1;
   if (m->rows == 0 || m->cols == 0)
     return 0;
+  if (m->cols < m->rows)
+    return -1;
 
+  MTX_STATS_WORK(2 * m->rows * m->cols * sizeof(double),
+                 2 * m->rows * m->rows * m->cols / 3);
   size_t n = m->rows;
   size_t m_cols = m->cols;
-  double det = 1.0;
+  int sign = 1;
 
-  for (size_t i = 0; i < n; ++i) {
-    size_t max_row = i;
-    double max_val = fabs(*mtx_cptr(m, i, i));
-
-    for (size_t j = i + 1; j < n; ++j) {
-      double val = fabs(*mtx_cptr(m, j, i));
-      if (val > max_val) {
-        max_val = val;
-        max_row = j;
-      }
-    }
-
-    if (max_val < EPSILON) {
-      return -1;
-    }
-
-    if (max_row != i) {
-      det = -det;
-      for (size_t j = 0; j < m_cols; ++j) {
-        double temp = *mtx_ptr(m, i, j);
-        *mtx_ptr(m, i, j) = *mtx_ptr(m, max_row, j);
-        *mtx_ptr(m, max_row, j) = temp;
-      }
-    }
-
-    det *= *mtx_cptr(m, i, i);
-
-    for (size_t j = i + 1; j < n; ++j) {
-      double factor = *mtx_cptr(m, j, i) / *mtx_cptr(m, i, i);
-      for (size_t k = i; k < m_cols; ++k) {
-        *mtx_ptr(m, j, k) -= factor * *mtx_cptr(m, i, k);
-      }
-    }
-  }
+  mtx_scratch_t scratch;
+  size_t bytes = mtx_gauss_elimination_workspace_size(m);
+  if (mtx_scratch_begin(&scratch, ws, bytes) != 0)
+    return -1;
 
-  if (fabs(det) < EPSILON) {
+  size_t *piv = (size_t *)mtx_workspace_push(scratch.ws, n * sizeof(size_t));
+  int rc = piv ? mtx_lu_decompose(m, piv, &sign) : -1;
+  mtx_scratch_end(&scratch);
+  if (rc != 0)
     return -1;
-  }
 
-  for (int i = n - 1; i >= 0; --i) {
-    for (int j = i - 1; j >= 0; --j) {
-      double factor = *mtx_cptr(m, j, i) / *mtx_cptr(m, i, i);
-      for (size_t k = i; k < m_cols; ++k) {
-        *mtx_ptr(m, j, k) -= factor * *mtx_cptr(m, i, k);
-      }
+  // Back substitution with U only needs to touch the right-hand columns.
+  if (m_cols > n) {
+    for (size_t i = n; i-- > 0;) {
+      elimination_job_t job = {m, i, n};
+      mtx_parallel_for(i, elimination_grain(m_cols - n), eliminate_rows, &job);
     }
   }
 
   for (size_t i = 0; i < n; ++i) {
-    double diag = *mtx_cptr(m, i, i);
-    for (size_t j = 0; j < m_cols; ++j) {
-      *mtx_ptr(m, i, j) /= diag;
+    double *row = mtx_row(m, i);
+    double diag = row[i];
+    for (size_t j = n; j < m_cols; ++j) {
+      row[j] /= diag;
     }
+    memset(row, 0, n * sizeof(double));
+    row[i] = 1.0;
   }
 
   return 0;
 }
 
 int mtx_mul3(matrix_t *result, const matrix_t *m1, const matrix_t *m2) {
+  MTX_STATS_OP(MUL3);
   if (!result || !m1 || !m2)
     return -1;
   if (m1->cols != m2->rows)
@@ -267,25 +615,108 @@ int mtx_mul3(matrix_t *result, const matrix_t *m1, const matrix_t *m2) {
   if (!m1->data || !m2->data || !result->data)
     return -1;
 
-  if (result == m1 || result == m2) {
+  if (mtx_overlaps(result, m1) || mtx_overlaps(result, m2)) {
     return -1;
   }
 
-  mtx_set_zero(result);
-  for (size_t i = 0; i < m1->rows; ++i) {
-    for (size_t j = 0; j < m2->cols; ++j) {
-      double sum = 0.0;
-      for (size_t k = 0; k < m1->cols; ++k) {
-        sum += *mtx_cptr(m1, i, k) * *mtx_cptr(m2, k, j);
-      }
-      *mtx_ptr(result, i, j) = sum;
+  MTX_STATS_WORK((m1->rows * m1->cols + m2->rows * m2->cols +
+                  m1->rows * m2->cols) * sizeof(double),
+                 2 * m1->rows * m2->cols * m1->cols);
+  if (m1->rows == m1->cols && m2->cols == m1->cols) {
+    mtx_fixed_mul_fn fixed = mtx_fixed_mul(m1->rows);
+    if (fixed) {
+      fixed(result->data, result->ld, m1->data, m1->ld, m2->data, m2->ld);
+      return 0;
     }
   }
 
-  return 0;
+  return product(m1->rows, m2->cols, m1->cols, m1->data, m1->ld, m2->data,
+                 m2->ld, result->data, result->ld, NULL);
+}
+
+static const double pade3[] = {120.0, 60.0, 12.0, 1.0};
+static const double pade5[] = {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0};
+static const double pade7[] = {17297280.0, 8648640.0, 1995840.0, 277200.0,
+                               25200.0,    1512.0,    56.0,      1.0};
+static const double pade9[] = {17643225600.0, 8821612800.0, 2075673600.0,
+                               302702400.0,   30270240.0,   2162160.0,
+                               110880.0,      3960.0,       90.0,
+                               1.0};
+static const double pade13[] = {64764752532480000.0,
+                                32382376266240000.0,
+                                7771770303897600.0,
+                                1187353796428800.0,
+                                129060195264000.0,
+                                10559470521600.0,
+                                670442572800.0,
+                                33522128640.0,
+                                1323241920.0,
+                                40840800.0,
+                                960960.0,
+                                16380.0,
+                                182.0,
+                                1.0};
+
+// Largest 1-norm for which Pade(m) meets double precision (Higham, 2005).
+static const double pade_theta[] = {1.495585217958292e-2, 2.539398330063230e-1,
+                                    9.504178996162932e-1, 2.097847961257068,
+                                    5.371920351148152};
+
+static double norm1(const double *a, size_t n, double *colsum) {
+  memset(colsum, 0, n * sizeof(double));
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      colsum[j] += fabs(a[i * n + j]);
+    }
+  }
+
+  double r = 0.0;
+  for (size_t j = 0; j < n; ++j) {
+    if (colsum[j] > r || isnan(colsum[j]))
+      r = colsum[j];
+  }
+  return r;
+}
+
+// dst = c0 * I + c1 * x1 + c2 * x2 + c3 * x3, plus dst's own value when
+// `keep`, as one fused pass over n x n scratch; x2 and x3 may be NULL.
+static int lin_comb(double *dst, int keep, size_t n, double c0, double c1,
+                    const double *x1, double c2, const double *x2, double c3,
+                    const double *x3) {
+  const double *x[] = {x1, x2, x3};
+  double c[] = {c1, c2, c3};
+  matrix_t d, m[3];
+  mtx_expr_t e;
+  if (mtx_view_data(&d, dst, n, n, n) != 0)
+    return -1;
+  if (keep)
+    mtx_expr_begin(&e, &d);
+  else
+    mtx_expr_assign(&e, &d);
+  for (size_t i = 0; i < 3; ++i) {
+    if (x[i] && (mtx_view_data(&m[i], (double *)x[i], n, n, n) != 0 ||
+                 mtx_expr_add_scaled(&e, &m[i], c[i]) != 0))
+      return -1;
+  }
+  if (mtx_expr_add_id(&e, c0) != 0)
+    return -1;
+  return mtx_expr_eval(&e);
+}
+
+size_t mtx_exp_workspace_size(const matrix_t *m) {
+  if (!m)
+    return 0;
+  size_t n = m->rows;
+  return 6 * mtx_workspace_bytes(n * n * sizeof(double)) +
+         mtx_workspace_bytes(n * sizeof(double)) + mtx_lu_workspace_size(n);
 }
 
 int mtx_exp(const matrix_t *m, matrix_t *result) {
+  return mtx_exp_ws(m, result, NULL);
+}
+
+int mtx_exp_ws(const matrix_t *m, matrix_t *result, mtx_workspace_t *ws) {
+  MTX_STATS_OP(EXP);
   if (!m || !result)
     return -1;
   if (m->rows != m->cols || result->rows != result->cols ||
@@ -296,58 +727,120 @@ int mtx_exp(const matrix_t *m, matrix_t *result) {
   if (!m->data || !result->data)
     return -1;
 
-  mtx_set_id(result);
-
-  matrix_t *term = mtx_alloc(m->rows, m->cols);
-  matrix_t *power = mtx_copy(m);
-  if (!term || !power) {
-    mtx_free(term);
-    mtx_free(power);
-    return -1;
-  }
-
-  if (mtx_add(result, power) != 0) {
-    mtx_free(term);
-    mtx_free(power);
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_exp_workspace_size(m)) != 0)
     return -1;
-  }
 
-  double factorial = 1.0;
-  int i = 1;
+  size_t n = m->rows, nn = n * n;
+  mtx_workspace_t *w = scratch.ws;
+  double *a = mtx_workspace_doubles(w, nn);
+  double *a2 = mtx_workspace_doubles(w, nn);
+  double *a4 = mtx_workspace_doubles(w, nn);
+  double *a6 = mtx_workspace_doubles(w, nn);
+  double *u = mtx_workspace_doubles(w, nn);
+  double *v = mtx_workspace_doubles(w, nn);
+  double *colsum = mtx_workspace_doubles(w, n);
+  mtx_lu_t lu_obj, *lu = &lu_obj;
+  matrix_t lu_storage;
+  int rc = -1;
+  if (!a || !a2 || !a4 || !a6 || !u || !v || !colsum ||
+      mtx_lu_init_workspace(lu, &lu_storage, n, w) != 0)
+    goto done;
 
-  do {
-    if (mtx_mul3(term, power, m) != 0) {
-      mtx_free(term);
-      mtx_free(power);
-      return -1;
-    }
+  double *tmp = lu->lu->data;
 
-    matrix_t *new_power = mtx_copy(term);
-    if (!new_power) {
-      mtx_free(term);
-      mtx_free(power);
-      return -1;
-    }
-    mtx_free(power);
-    power = new_power;
-
-    factorial *= (i + 1);
-    if (mtx_scale(term, 1.0 / factorial) != 0) {
-      mtx_free(term);
-      mtx_free(power);
-      return -1;
-    }
-
-    if (mtx_add(result, term) != 0) {
-      mtx_free(term);
-      mtx_free(power);
-      return -1;
+  for (size_t i = 0; i < n; ++i) {
+    memcpy(a + i * n, mtx_crow(m, i), n * sizeof(double));
+  }
+  double norm = norm1(a, n, colsum);
+  if (!isfinite(norm))
+    goto done;
+
+  size_t order = 0;
+  while (order < 4 && norm > pade_theta[order])
+    order++;
+
+  int s = 0;
+  if (order == 4 && norm > pade_theta[4]) {
+    s = (int)ceil(log2(norm / pade_theta[4]));
+    mtx_simd_ops()->scal(a, ldexp(1.0, -s), nn);
+  }
+  // Products for the Padé sums and the squarings, plus the LU solve.
+  MTX_STATS_WORK(2 * nn * sizeof(double),
+                 (2 * ((order < 4 ? order + 2 : 6) + s) + 8.0 / 3) * nn * n);
+
+  if (mtx_gemm(n, n, n, 1.0, a, n, a, n, 0.0, a2, n) != 0)
+    goto done;
+
+  if (order < 4) {
+    static const double *const coeffs[] = {pade3, pade5, pade7, pade9};
+    const double *b = coeffs[order];
+    size_t deg = 3 + 2 * order;
+
+    // Accumulate even and odd sums with successive powers of A^2 in a4.
+    if (lin_comb(v, 0, n, b[0], b[2], a2, 0.0, NULL, 0.0, NULL) != 0)
+      goto done;
+    if (lin_comb(tmp, 0, n, b[1], b[3], a2, 0.0, NULL, 0.0, NULL) != 0)
+      goto done;
+    memcpy(a4, a2, nn * sizeof(double));
+    for (size_t k = 4; k <= deg; k += 2) {
+      if (mtx_gemm(n, n, n, 1.0, a4, n, a2, n, 0.0, a6, n) != 0)
+        goto done;
+      memcpy(a4, a6, nn * sizeof(double));
+      mtx_simd_ops()->axpy(v, a4, b[k], nn);
+      mtx_simd_ops()->axpy(tmp, a4, b[k + 1], nn);
     }
+    if (mtx_gemm(n, n, n, 1.0, a, n, tmp, n, 0.0, u, n) != 0)
+      goto done;
+  } else {
+    const double *b = pade13;
+    if (mtx_gemm(n, n, n, 1.0, a2, n, a2, n, 0.0, a4, n) != 0)
+      goto done;
+    if (mtx_gemm(n, n, n, 1.0, a4, n, a2, n, 0.0, a6, n) != 0)
+      goto done;
+
+    // The lower-order sums are added straight onto the A^6 products.
+    if (lin_comb(tmp, 0, n, 0.0, b[13], a6, b[11], a4, b[9], a2) != 0)
+      goto done;
+    if (mtx_gemm(n, n, n, 1.0, a6, n, tmp, n, 0.0, v, n) != 0)
+      goto done;
+    if (lin_comb(v, 1, n, b[1], b[7], a6, b[5], a4, b[3], a2) != 0)
+      goto done;
+    if (mtx_gemm(n, n, n, 1.0, a, n, v, n, 0.0, u, n) != 0)
+      goto done;
+
+    if (lin_comb(tmp, 0, n, 0.0, b[12], a6, b[10], a4, b[8], a2) != 0)
+      goto done;
+    if (mtx_gemm(n, n, n, 1.0, a6, n, tmp, n, 0.0, v, n) != 0)
+      goto done;
+    if (lin_comb(v, 1, n, b[0], b[6], a6, b[4], a4, b[2], a2) != 0)
+      goto done;
+  }
 
-    i++;
-  } while (i <= MTX_MAX_EXP_ITERATIONS && mtx_norm(term) > EPSILON);
+  // exp(A) ~ (V - U)^-1 (V + U), solved and squared in contiguous scratch.
+  if (lin_comb(lu->lu->data, 0, n, 0.0, 1.0, v, -1.0, u, 0.0, NULL) != 0)
+    goto done;
+  mtx_simd_ops()->add(u, v, nn);
+  matrix_t p;
+  mtx_view_data(&p, u, n, n, n);
+  if (mtx_lu_decompose(lu->lu, lu->piv, &lu->sign) != 0 ||
+      mtx_lu_solve(lu, &p) != 0)
+    goto done;
+
+  double *cur = u, *next = a;
+  for (int i = 0; i < s; ++i) {
+    if (mtx_gemm(n, n, n, 1.0, cur, n, cur, n, 0.0, next, n) != 0)
+      goto done;
+    double *t = cur;
+    cur = next;
+    next = t;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    memcpy(mtx_row(result, i), cur + i * n, n * sizeof(double));
+  }
+  rc = 0;
 
-  mtx_free(term);
-  mtx_free(power);
-  return 0;
+done:
+  mtx_scratch_end(&scratch);
+  return rc;
 }
@@ -2,10 +2,10 @@
 #define MATRIX_OPERATIONS_H
 
 #include "matrix.h"
+#include "matrix_workspace.h"
 
 #define EPSILON 1e-10
 #define MAX_ITERATIONS 1000
-#define MTX_MAX_EXP_ITERATIONS 20
 
 int mtx_add(matrix_t *m1, const matrix_t *m2);
 int mtx_sub(matrix_t *m1, const matrix_t *m2);
@@ -19,7 +19,30 @@ int mtx_scale(matrix_t *m, double scale);
 double mtx_norm(const matrix_t *m);
 
 int mtx_inverse(const matrix_t *m, matrix_t *inv);
+// x = a^-1 * b; x may be b. Symmetric a is tried with Cholesky before LU.
+int mtx_solve(const matrix_t *a, const matrix_t *b, matrix_t *x);
+// r = b - a * x, the residual of a computed solution to a * x = b. r must
+// not overlap a or x; it may be b.
+int mtx_residual(const matrix_t *a, const matrix_t *x, const matrix_t *b,
+                 matrix_t *r);
 int mtx_gauss_elimination(matrix_t *m);
 int mtx_exp(const matrix_t *m, matrix_t *result);
 
+// Variants that take all temporaries from `ws` (NULL allocates internally).
+// A workspace of at least the matching *_workspace_size bytes never runs out.
+int mtx_mul_ws(matrix_t *m1, const matrix_t *m2, mtx_workspace_t *ws);
+int mtx_div_ws(matrix_t *m1, const matrix_t *m2, mtx_workspace_t *ws);
+int mtx_inverse_ws(const matrix_t *m, matrix_t *inv, mtx_workspace_t *ws);
+int mtx_solve_ws(const matrix_t *a, const matrix_t *b, matrix_t *x,
+                 mtx_workspace_t *ws);
+int mtx_gauss_elimination_ws(matrix_t *m, mtx_workspace_t *ws);
+int mtx_exp_ws(const matrix_t *m, matrix_t *result, mtx_workspace_t *ws);
+
+size_t mtx_mul_workspace_size(const matrix_t *m1, const matrix_t *m2);
+size_t mtx_div_workspace_size(const matrix_t *m1, const matrix_t *m2);
+size_t mtx_inverse_workspace_size(const matrix_t *m);
+size_t mtx_solve_workspace_size(const matrix_t *a);
+size_t mtx_gauss_elimination_workspace_size(const matrix_t *m);
+size_t mtx_exp_workspace_size(const matrix_t *m);
+
 #endif // MATRIX_OPERATIONS_H
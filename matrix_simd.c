@@ -0,0 +1,586 @@
+#include "matrix_simd.h"
+#include "matrix_gemm.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MTX_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define MR MTX_GEMM_MR
+#define NR MTX_GEMM_NR
+#define SNR MTX_SGEMM_NR
+
+static void add_scalar(double *dst, const double *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] += src[i];
+  }
+}
+
+static void sub_scalar(double *dst, const double *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] -= src[i];
+  }
+}
+
+static void axpy_scalar(double *dst, const double *src, double alpha,
+                        size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] += alpha * src[i];
+  }
+}
+
+static void scal_scalar(double *dst, double alpha, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] *= alpha;
+  }
+}
+
+static double sumsq_scalar(const double *src, double scale, size_t n) {
+  double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    double x0 = scale * src[i], x1 = scale * src[i + 1];
+    double x2 = scale * src[i + 2], x3 = scale * src[i + 3];
+    s0 += x0 * x0;
+    s1 += x1 * x1;
+    s2 += x2 * x2;
+    s3 += x3 * x3;
+  }
+  for (; i < n; ++i) {
+    double x = scale * src[i];
+    s0 += x * x;
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+static double amax_scalar(const double *src, size_t n) {
+  double m = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    double a = fabs(src[i]);
+    if (a > m || isnan(a))
+      m = a;
+  }
+  return m;
+}
+
+static void gemm_kernel_scalar(size_t kc, const double *restrict ap,
+                               const double *restrict bp, double *acc) {
+  double c[MR][NR] = {{0.0}};
+  for (size_t p = 0; p < kc; ++p) {
+    for (size_t i = 0; i < MR; ++i) {
+      double ai = ap[i];
+      for (size_t j = 0; j < NR; ++j) {
+        c[i][j] += ai * bp[j];
+      }
+    }
+    ap += MR;
+    bp += NR;
+  }
+  memcpy(acc, c, sizeof(c));
+}
+
+static void transpose_4x4_scalar(const double *src, size_t lds, double *dst,
+                                 size_t ldd) {
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      dst[j * ldd + i] = src[i * lds + j];
+    }
+  }
+}
+
+static void saxpy_scalar(float *dst, const float *src, float alpha,
+                         size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] += alpha * src[i];
+  }
+}
+
+static void sgemm_kernel_scalar(size_t kc, const float *restrict ap,
+                                const float *restrict bp, float *acc) {
+  float c[MR][SNR] = {{0.0f}};
+  for (size_t p = 0; p < kc; ++p) {
+    for (size_t i = 0; i < MR; ++i) {
+      float ai = ap[i];
+      for (size_t j = 0; j < SNR; ++j) {
+        c[i][j] += ai * bp[j];
+      }
+    }
+    ap += MR;
+    bp += SNR;
+  }
+  memcpy(acc, c, sizeof(c));
+}
+
+#ifdef MTX_SIMD_X86
+
+static void add_sse2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128d a0 = _mm_loadu_pd(dst + i), a1 = _mm_loadu_pd(dst + i + 2);
+    a0 = _mm_add_pd(a0, _mm_loadu_pd(src + i));
+    a1 = _mm_add_pd(a1, _mm_loadu_pd(src + i + 2));
+    _mm_storeu_pd(dst + i, a0);
+    _mm_storeu_pd(dst + i + 2, a1);
+  }
+  add_scalar(dst + i, src + i, n - i);
+}
+
+static void sub_sse2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128d a0 = _mm_loadu_pd(dst + i), a1 = _mm_loadu_pd(dst + i + 2);
+    a0 = _mm_sub_pd(a0, _mm_loadu_pd(src + i));
+    a1 = _mm_sub_pd(a1, _mm_loadu_pd(src + i + 2));
+    _mm_storeu_pd(dst + i, a0);
+    _mm_storeu_pd(dst + i + 2, a1);
+  }
+  sub_scalar(dst + i, src + i, n - i);
+}
+
+static void axpy_sse2(double *dst, const double *src, double alpha, size_t n) {
+  __m128d va = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128d a0 = _mm_loadu_pd(dst + i), a1 = _mm_loadu_pd(dst + i + 2);
+    a0 = _mm_add_pd(a0, _mm_mul_pd(va, _mm_loadu_pd(src + i)));
+    a1 = _mm_add_pd(a1, _mm_mul_pd(va, _mm_loadu_pd(src + i + 2)));
+    _mm_storeu_pd(dst + i, a0);
+    _mm_storeu_pd(dst + i + 2, a1);
+  }
+  axpy_scalar(dst + i, src + i, alpha, n - i);
+}
+
+static void scal_sse2(double *dst, double alpha, size_t n) {
+  __m128d va = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_pd(dst + i, _mm_mul_pd(va, _mm_loadu_pd(dst + i)));
+    _mm_storeu_pd(dst + i + 2, _mm_mul_pd(va, _mm_loadu_pd(dst + i + 2)));
+  }
+  scal_scalar(dst + i, alpha, n - i);
+}
+
+static double sumsq_sse2(const double *src, double scale, size_t n) {
+  __m128d vs = _mm_set1_pd(scale);
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  __m128d s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128d x0 = _mm_mul_pd(vs, _mm_loadu_pd(src + i));
+    __m128d x1 = _mm_mul_pd(vs, _mm_loadu_pd(src + i + 2));
+    __m128d x2 = _mm_mul_pd(vs, _mm_loadu_pd(src + i + 4));
+    __m128d x3 = _mm_mul_pd(vs, _mm_loadu_pd(src + i + 6));
+    s0 = _mm_add_pd(s0, _mm_mul_pd(x0, x0));
+    s1 = _mm_add_pd(s1, _mm_mul_pd(x1, x1));
+    s2 = _mm_add_pd(s2, _mm_mul_pd(x2, x2));
+    s3 = _mm_add_pd(s3, _mm_mul_pd(x3, x3));
+  }
+  __m128d s = _mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3));
+  double lanes[2];
+  _mm_storeu_pd(lanes, s);
+  return lanes[0] + lanes[1] + sumsq_scalar(src + i, scale, n - i);
+}
+
+static void transpose_4x4_sse2(const double *src, size_t lds, double *dst,
+                               size_t ldd) {
+  for (size_t i = 0; i < 4; i += 2) {
+    for (size_t j = 0; j < 4; j += 2) {
+      __m128d r0 = _mm_loadu_pd(src + i * lds + j);
+      __m128d r1 = _mm_loadu_pd(src + (i + 1) * lds + j);
+      _mm_storeu_pd(dst + j * ldd + i, _mm_unpacklo_pd(r0, r1));
+      _mm_storeu_pd(dst + (j + 1) * ldd + i, _mm_unpackhi_pd(r0, r1));
+    }
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void
+add_avx2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d a0 = _mm256_loadu_pd(dst + i), a1 = _mm256_loadu_pd(dst + i + 4);
+    a0 = _mm256_add_pd(a0, _mm256_loadu_pd(src + i));
+    a1 = _mm256_add_pd(a1, _mm256_loadu_pd(src + i + 4));
+    _mm256_storeu_pd(dst + i, a0);
+    _mm256_storeu_pd(dst + i + 4, a1);
+  }
+  add_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void
+sub_avx2(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d a0 = _mm256_loadu_pd(dst + i), a1 = _mm256_loadu_pd(dst + i + 4);
+    a0 = _mm256_sub_pd(a0, _mm256_loadu_pd(src + i));
+    a1 = _mm256_sub_pd(a1, _mm256_loadu_pd(src + i + 4));
+    _mm256_storeu_pd(dst + i, a0);
+    _mm256_storeu_pd(dst + i + 4, a1);
+  }
+  sub_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void
+axpy_avx2(double *dst, const double *src, double alpha, size_t n) {
+  __m256d va = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d a0 = _mm256_loadu_pd(dst + i), a1 = _mm256_loadu_pd(dst + i + 4);
+    a0 = _mm256_fmadd_pd(va, _mm256_loadu_pd(src + i), a0);
+    a1 = _mm256_fmadd_pd(va, _mm256_loadu_pd(src + i + 4), a1);
+    _mm256_storeu_pd(dst + i, a0);
+    _mm256_storeu_pd(dst + i + 4, a1);
+  }
+  for (; i < n; ++i) {
+    dst[i] = fma(alpha, src[i], dst[i]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void
+scal_avx2(double *dst, double alpha, size_t n) {
+  __m256d va = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_pd(dst + i, _mm256_mul_pd(va, _mm256_loadu_pd(dst + i)));
+    _mm256_storeu_pd(dst + i + 4,
+                     _mm256_mul_pd(va, _mm256_loadu_pd(dst + i + 4)));
+  }
+  scal_scalar(dst + i, alpha, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static double
+sumsq_avx2(const double *src, double scale, size_t n) {
+  __m256d vs = _mm256_set1_pd(scale);
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256d x0 = _mm256_mul_pd(vs, _mm256_loadu_pd(src + i));
+    __m256d x1 = _mm256_mul_pd(vs, _mm256_loadu_pd(src + i + 4));
+    __m256d x2 = _mm256_mul_pd(vs, _mm256_loadu_pd(src + i + 8));
+    __m256d x3 = _mm256_mul_pd(vs, _mm256_loadu_pd(src + i + 12));
+    s0 = _mm256_fmadd_pd(x0, x0, s0);
+    s1 = _mm256_fmadd_pd(x1, x1, s1);
+    s2 = _mm256_fmadd_pd(x2, x2, s2);
+    s3 = _mm256_fmadd_pd(x3, x3, s3);
+  }
+  __m256d s = _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3));
+  double lanes[4];
+  _mm256_storeu_pd(lanes, s);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+         sumsq_scalar(src + i, scale, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void
+transpose_4x4_avx2(const double *src, size_t lds, double *dst, size_t ldd) {
+  __m256d r0 = _mm256_loadu_pd(src), r1 = _mm256_loadu_pd(src + lds);
+  __m256d r2 = _mm256_loadu_pd(src + 2 * lds);
+  __m256d r3 = _mm256_loadu_pd(src + 3 * lds);
+  __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+  __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+  _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+__attribute__((target("avx2,fma"))) static void
+gemm_kernel_avx2(size_t kc, const double *restrict ap,
+                 const double *restrict bp, double *acc) {
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  for (size_t p = 0; p < kc; ++p) {
+    __m256d b0 = _mm256_loadu_pd(bp), b1 = _mm256_loadu_pd(bp + 4);
+    __m256d a = _mm256_broadcast_sd(ap);
+    c00 = _mm256_fmadd_pd(a, b0, c00);
+    c01 = _mm256_fmadd_pd(a, b1, c01);
+    a = _mm256_broadcast_sd(ap + 1);
+    c10 = _mm256_fmadd_pd(a, b0, c10);
+    c11 = _mm256_fmadd_pd(a, b1, c11);
+    a = _mm256_broadcast_sd(ap + 2);
+    c20 = _mm256_fmadd_pd(a, b0, c20);
+    c21 = _mm256_fmadd_pd(a, b1, c21);
+    a = _mm256_broadcast_sd(ap + 3);
+    c30 = _mm256_fmadd_pd(a, b0, c30);
+    c31 = _mm256_fmadd_pd(a, b1, c31);
+    ap += MR;
+    bp += NR;
+  }
+  _mm256_storeu_pd(acc, c00);
+  _mm256_storeu_pd(acc + 4, c01);
+  _mm256_storeu_pd(acc + 8, c10);
+  _mm256_storeu_pd(acc + 12, c11);
+  _mm256_storeu_pd(acc + 16, c20);
+  _mm256_storeu_pd(acc + 20, c21);
+  _mm256_storeu_pd(acc + 24, c30);
+  _mm256_storeu_pd(acc + 28, c31);
+}
+
+__attribute__((target("avx2,fma"))) static void
+saxpy_avx2(float *dst, const float *src, float alpha, size_t n) {
+  __m256 va = _mm256_set1_ps(alpha);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256 a0 = _mm256_loadu_ps(dst + i), a1 = _mm256_loadu_ps(dst + i + 8);
+    a0 = _mm256_fmadd_ps(va, _mm256_loadu_ps(src + i), a0);
+    a1 = _mm256_fmadd_ps(va, _mm256_loadu_ps(src + i + 8), a1);
+    _mm256_storeu_ps(dst + i, a0);
+    _mm256_storeu_ps(dst + i + 8, a1);
+  }
+  for (; i < n; ++i) {
+    dst[i] = fmaf(alpha, src[i], dst[i]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void
+sgemm_kernel_avx2(size_t kc, const float *restrict ap,
+                  const float *restrict bp, float *acc) {
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  for (size_t p = 0; p < kc; ++p) {
+    __m256 b0 = _mm256_loadu_ps(bp), b1 = _mm256_loadu_ps(bp + 8);
+    __m256 a = _mm256_broadcast_ss(ap);
+    c00 = _mm256_fmadd_ps(a, b0, c00);
+    c01 = _mm256_fmadd_ps(a, b1, c01);
+    a = _mm256_broadcast_ss(ap + 1);
+    c10 = _mm256_fmadd_ps(a, b0, c10);
+    c11 = _mm256_fmadd_ps(a, b1, c11);
+    a = _mm256_broadcast_ss(ap + 2);
+    c20 = _mm256_fmadd_ps(a, b0, c20);
+    c21 = _mm256_fmadd_ps(a, b1, c21);
+    a = _mm256_broadcast_ss(ap + 3);
+    c30 = _mm256_fmadd_ps(a, b0, c30);
+    c31 = _mm256_fmadd_ps(a, b1, c31);
+    ap += MR;
+    bp += SNR;
+  }
+  _mm256_storeu_ps(acc, c00);
+  _mm256_storeu_ps(acc + 8, c01);
+  _mm256_storeu_ps(acc + 16, c10);
+  _mm256_storeu_ps(acc + 24, c11);
+  _mm256_storeu_ps(acc + 32, c20);
+  _mm256_storeu_ps(acc + 40, c21);
+  _mm256_storeu_ps(acc + 48, c30);
+  _mm256_storeu_ps(acc + 56, c31);
+}
+
+__attribute__((target("avx512f"))) static void
+add_avx512(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_add_pd(_mm512_loadu_pd(dst + i),
+                                            _mm512_loadu_pd(src + i)));
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512d a = _mm512_maskz_loadu_pd(k, dst + i);
+    __m512d b = _mm512_maskz_loadu_pd(k, src + i);
+    _mm512_mask_storeu_pd(dst + i, k, _mm512_add_pd(a, b));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+sub_avx512(double *dst, const double *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_sub_pd(_mm512_loadu_pd(dst + i),
+                                            _mm512_loadu_pd(src + i)));
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512d a = _mm512_maskz_loadu_pd(k, dst + i);
+    __m512d b = _mm512_maskz_loadu_pd(k, src + i);
+    _mm512_mask_storeu_pd(dst + i, k, _mm512_sub_pd(a, b));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+axpy_avx512(double *dst, const double *src, double alpha, size_t n) {
+  __m512d va = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(src + i),
+                                              _mm512_loadu_pd(dst + i)));
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512d a = _mm512_maskz_loadu_pd(k, dst + i);
+    __m512d b = _mm512_maskz_loadu_pd(k, src + i);
+    _mm512_mask_storeu_pd(dst + i, k, _mm512_fmadd_pd(va, b, a));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+scal_avx512(double *dst, double alpha, size_t n) {
+  __m512d va = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(dst + i, _mm512_mul_pd(va, _mm512_loadu_pd(dst + i)));
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512d a = _mm512_maskz_loadu_pd(k, dst + i);
+    _mm512_mask_storeu_pd(dst + i, k, _mm512_mul_pd(va, a));
+  }
+}
+
+__attribute__((target("avx512f"))) static double
+sumsq_avx512(const double *src, double scale, size_t n) {
+  __m512d vs = _mm512_set1_pd(scale);
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m512d x0 = _mm512_mul_pd(vs, _mm512_loadu_pd(src + i));
+    __m512d x1 = _mm512_mul_pd(vs, _mm512_loadu_pd(src + i + 8));
+    __m512d x2 = _mm512_mul_pd(vs, _mm512_loadu_pd(src + i + 16));
+    __m512d x3 = _mm512_mul_pd(vs, _mm512_loadu_pd(src + i + 24));
+    s0 = _mm512_fmadd_pd(x0, x0, s0);
+    s1 = _mm512_fmadd_pd(x1, x1, s1);
+    s2 = _mm512_fmadd_pd(x2, x2, s2);
+    s3 = _mm512_fmadd_pd(x3, x3, s3);
+  }
+  for (; i + 8 <= n; i += 8) {
+    __m512d x = _mm512_mul_pd(vs, _mm512_loadu_pd(src + i));
+    s0 = _mm512_fmadd_pd(x, x, s0);
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512d x = _mm512_mul_pd(vs, _mm512_maskz_loadu_pd(k, src + i));
+    s1 = _mm512_fmadd_pd(x, x, s1);
+  }
+  __m512d s = _mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3));
+  return _mm512_reduce_add_pd(s);
+}
+
+__attribute__((target("avx512f"))) static void
+saxpy_avx512(float *dst, const float *src, float alpha, size_t n) {
+  __m512 va = _mm512_set1_ps(alpha);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(src + i),
+                                              _mm512_loadu_ps(dst + i)));
+  }
+  if (i < n) {
+    __mmask16 k = (__mmask16)((1u << (n - i)) - 1);
+    __m512 a = _mm512_maskz_loadu_ps(k, dst + i);
+    __m512 b = _mm512_maskz_loadu_ps(k, src + i);
+    _mm512_mask_storeu_ps(dst + i, k, _mm512_fmadd_ps(va, b, a));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+sgemm_kernel_avx512(size_t kc, const float *restrict ap,
+                    const float *restrict bp, float *acc) {
+  __m512 c0 = _mm512_setzero_ps(), c1 = _mm512_setzero_ps();
+  __m512 c2 = _mm512_setzero_ps(), c3 = _mm512_setzero_ps();
+  for (size_t p = 0; p < kc; ++p) {
+    __m512 b = _mm512_loadu_ps(bp);
+    c0 = _mm512_fmadd_ps(_mm512_set1_ps(ap[0]), b, c0);
+    c1 = _mm512_fmadd_ps(_mm512_set1_ps(ap[1]), b, c1);
+    c2 = _mm512_fmadd_ps(_mm512_set1_ps(ap[2]), b, c2);
+    c3 = _mm512_fmadd_ps(_mm512_set1_ps(ap[3]), b, c3);
+    ap += MR;
+    bp += SNR;
+  }
+  _mm512_storeu_ps(acc, c0);
+  _mm512_storeu_ps(acc + 16, c1);
+  _mm512_storeu_ps(acc + 32, c2);
+  _mm512_storeu_ps(acc + 48, c3);
+}
+
+#endif // MTX_SIMD_X86
+
+static mtx_simd_ops_t simd_ops;
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+static mtx_simd_level_t detect_level(void) {
+#ifdef MTX_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return MTX_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return MTX_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return MTX_SIMD_SSE2;
+#endif
+  return MTX_SIMD_SCALAR;
+}
+
+static mtx_simd_level_t requested_level(mtx_simd_level_t detected) {
+  const char *env = getenv(MTX_SIMD_ENV);
+  mtx_simd_level_t cap = detected;
+  if (!env)
+    return detected;
+
+  if (strcmp(env, "scalar") == 0)
+    cap = MTX_SIMD_SCALAR;
+  else if (strcmp(env, "sse2") == 0)
+    cap = MTX_SIMD_SSE2;
+  else if (strcmp(env, "avx2") == 0)
+    cap = MTX_SIMD_AVX2;
+  else if (strcmp(env, "avx512") == 0)
+    cap = MTX_SIMD_AVX512;
+  return cap < detected ? cap : detected;
+}
+
+static void simd_init(void) {
+  mtx_simd_level_t level = requested_level(detect_level());
+  mtx_simd_ops_t ops = {MTX_SIMD_SCALAR,      "scalar",     add_scalar,
+                        sub_scalar,           axpy_scalar,  scal_scalar,
+                        sumsq_scalar,         amax_scalar,  gemm_kernel_scalar,
+                        transpose_4x4_scalar, saxpy_scalar, sgemm_kernel_scalar};
+
+#ifdef MTX_SIMD_X86
+  if (level >= MTX_SIMD_SSE2) {
+    ops.level = MTX_SIMD_SSE2;
+    ops.name = "sse2";
+    ops.add = add_sse2;
+    ops.sub = sub_sse2;
+    ops.axpy = axpy_sse2;
+    ops.scal = scal_sse2;
+    ops.sumsq = sumsq_sse2;
+    ops.transpose_4x4 = transpose_4x4_sse2;
+  }
+  if (level >= MTX_SIMD_AVX2) {
+    ops.level = MTX_SIMD_AVX2;
+    ops.name = "avx2";
+    ops.add = add_avx2;
+    ops.sub = sub_avx2;
+    ops.axpy = axpy_avx2;
+    ops.scal = scal_avx2;
+    ops.sumsq = sumsq_avx2;
+    ops.gemm_kernel = gemm_kernel_avx2;
+    ops.transpose_4x4 = transpose_4x4_avx2;
+    ops.saxpy = saxpy_avx2;
+    ops.sgemm_kernel = sgemm_kernel_avx2;
+  }
+  if (level >= MTX_SIMD_AVX512) {
+    ops.level = MTX_SIMD_AVX512;
+    ops.name = "avx512";
+    ops.add = add_avx512;
+    ops.sub = sub_avx512;
+    ops.axpy = axpy_avx512;
+    ops.scal = scal_avx512;
+    ops.sumsq = sumsq_avx512;
+    ops.saxpy = saxpy_avx512;
+    ops.sgemm_kernel = sgemm_kernel_avx512;
+  }
+#else
+  (void)level;
+#endif
+
+  simd_ops = ops;
+}
+
+const mtx_simd_ops_t *mtx_simd_ops(void) {
+  pthread_once(&simd_once, simd_init);
+  return &simd_ops;
+}
@@ -0,0 +1,41 @@
+#ifndef MATRIX_SIMD_H
+#define MATRIX_SIMD_H
+
+#include <stddef.h>
+
+#define MTX_SIMD_ENV "MTX_SIMD"
+
+typedef enum {
+  MTX_SIMD_SCALAR = 0,
+  MTX_SIMD_SSE2,
+  MTX_SIMD_AVX2,
+  MTX_SIMD_AVX512
+} mtx_simd_level_t;
+
+typedef struct {
+  mtx_simd_level_t level;
+  const char *name;
+  void (*add)(double *dst, const double *src, size_t n);
+  void (*sub)(double *dst, const double *src, size_t n);
+  void (*axpy)(double *dst, const double *src, double alpha, size_t n);
+  void (*scal)(double *dst, double alpha, size_t n);
+  double (*sumsq)(const double *src, double scale, size_t n);
+  double (*amax)(const double *src, size_t n);
+  // MTX_GEMM_MR x MTX_GEMM_NR product of packed panels, stored row-major.
+  void (*gemm_kernel)(size_t kc, const double *ap, const double *bp,
+                      double *acc);
+  // dst = src^T for a 4 x 4 tile; rows are lds and ldd elements apart.
+  void (*transpose_4x4)(const double *src, size_t lds, double *dst,
+                        size_t ldd);
+  // Single-precision counterparts for matrixf_t.
+  void (*saxpy)(float *dst, const float *src, float alpha, size_t n);
+  // MTX_GEMM_MR x MTX_SGEMM_NR product of packed float panels.
+  void (*sgemm_kernel)(size_t kc, const float *ap, const float *bp,
+                       float *acc);
+} mtx_simd_ops_t;
+
+// Kernels for the best instruction set the CPU supports, chosen once on first
+// use. MTX_SIMD=scalar|sse2|avx2|avx512 caps the choice.
+const mtx_simd_ops_t *mtx_simd_ops(void);
+
+#endif // MATRIX_SIMD_H
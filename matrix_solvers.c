@@ -0,0 +1,540 @@
+#include "matrix_solvers.h"
+#include "matrix.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const matrix_t *a;
+  const double *x;
+  double *y;
+} gemv_job_t;
+
+// Rows of y = a * x as dot products, as mtx_residual does for narrow x; a
+// single column would waste most of a GEMM tile and repack a every call.
+static void gemv_rows(void *ctx, size_t begin, size_t end) {
+  gemv_job_t *job = (gemv_job_t *)ctx;
+  size_t k = job->a->cols;
+  const double *x = job->x;
+  for (size_t i = begin; i < end; ++i) {
+    const double *arow = mtx_crow(job->a, i);
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t p = 0;
+    for (; p + 4 <= k; p += 4) {
+      s0 += arow[p] * x[p];
+      s1 += arow[p + 1] * x[p + 1];
+      s2 += arow[p + 2] * x[p + 2];
+      s3 += arow[p + 3] * x[p + 3];
+    }
+    for (; p < k; ++p) {
+      s0 += arow[p] * x[p];
+    }
+    job->y[i] = (s0 + s1) + (s2 + s3);
+  }
+}
+
+static int apply_dense(void *ctx, const double *x, double *y) {
+  const matrix_t *a = (const matrix_t *)ctx;
+  gemv_job_t job = {a, x, y};
+  size_t k = a->cols ? a->cols : 1;
+  mtx_parallel_for(a->rows,
+                   k >= MTX_PARALLEL_MIN_ELEMENTS
+                       ? 1
+                       : MTX_PARALLEL_MIN_ELEMENTS / k,
+                   gemv_rows, &job);
+  return 0;
+}
+
+static int apply_sparse(void *ctx, const double *x, double *y) {
+  return mtx_sparse_spmv((const mtx_sparse_t *)ctx, 1.0, x, 0.0, y);
+}
+
+int mtx_linop_dense(mtx_linop_t *op, const matrix_t *a) {
+  if (!op || !a || !a->data || a->rows != a->cols)
+    return -1;
+  op->n = a->rows;
+  op->apply = apply_dense;
+  op->ctx = (void *)a;
+  return 0;
+}
+
+int mtx_linop_sparse(mtx_linop_t *op, const mtx_sparse_t *a) {
+  if (!op || !a || a->rows != a->cols)
+    return -1;
+  op->n = a->rows;
+  op->apply = apply_sparse;
+  op->ctx = (void *)a;
+  return 0;
+}
+
+// Preconditioners own their data; op.ctx points back at the whole struct.
+typedef struct {
+  mtx_linop_t op;
+  double *inv_diag;
+  mtx_sparse_t *lu;
+  size_t *diag;
+} precond_t;
+
+static precond_t *precond_alloc(size_t n, mtx_apply_fn apply) {
+  precond_t *pc = (precond_t *)calloc(1, sizeof(precond_t));
+  if (!pc)
+    return NULL;
+  pc->op.n = n;
+  pc->op.apply = apply;
+  pc->op.ctx = pc;
+  return pc;
+}
+
+void mtx_precond_free(mtx_linop_t *m) {
+  if (m) {
+    precond_t *pc = (precond_t *)m->ctx;
+    free(pc->inv_diag);
+    mtx_sparse_free(pc->lu);
+    free(pc->diag);
+    free(pc);
+  }
+}
+
+static int apply_jacobi(void *ctx, const double *x, double *y) {
+  const precond_t *pc = (const precond_t *)ctx;
+  for (size_t i = 0; i < pc->op.n; ++i) {
+    y[i] = pc->inv_diag[i] * x[i];
+  }
+  return 0;
+}
+
+// Jacobi preconditioner from the diagonal in d, consumed on success.
+static mtx_linop_t *jacobi_from(double *d, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (d[i] == 0.0) {
+      free(d);
+      return NULL;
+    }
+    d[i] = 1.0 / d[i];
+  }
+  precond_t *pc = precond_alloc(n, apply_jacobi);
+  if (!pc) {
+    free(d);
+    return NULL;
+  }
+  pc->inv_diag = d;
+  return &pc->op;
+}
+
+mtx_linop_t *mtx_precond_jacobi(const mtx_sparse_t *a) {
+  if (!a || a->rows != a->cols)
+    return NULL;
+  size_t n = a->rows;
+  double *d = (double *)calloc(n ? n : 1, sizeof(double));
+  if (!d)
+    return NULL;
+  // Row i of CSR and column i of CSC both hold entry (i, i).
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t p = a->ptr[i]; p < a->ptr[i + 1]; ++p) {
+      if (a->idx[p] == i)
+        d[i] = a->val[p];
+    }
+  }
+  return jacobi_from(d, n);
+}
+
+mtx_linop_t *mtx_precond_jacobi_dense(const matrix_t *a) {
+  if (!a || !a->data || a->rows != a->cols)
+    return NULL;
+  size_t n = a->rows;
+  double *d = (double *)malloc((n ? n : 1) * sizeof(double));
+  if (!d)
+    return NULL;
+  for (size_t i = 0; i < n; ++i) {
+    d[i] = *mtx_cat(a, i, i);
+  }
+  return jacobi_from(d, n);
+}
+
+// Forward substitution with the unit lower factor, then back substitution
+// with the upper one, both stored in lu's CSR pattern.
+static int apply_ilu0(void *ctx, const double *x, double *y) {
+  const precond_t *pc = (const precond_t *)ctx;
+  const mtx_sparse_t *lu = pc->lu;
+  size_t n = pc->op.n;
+  for (size_t i = 0; i < n; ++i) {
+    double s = x[i];
+    for (size_t p = lu->ptr[i]; p < pc->diag[i]; ++p) {
+      s -= lu->val[p] * y[lu->idx[p]];
+    }
+    y[i] = s;
+  }
+  for (size_t i = n; i-- > 0;) {
+    double s = y[i];
+    for (size_t p = pc->diag[i] + 1; p < lu->ptr[i + 1]; ++p) {
+      s -= lu->val[p] * y[lu->idx[p]];
+    }
+    y[i] = s / lu->val[pc->diag[i]];
+  }
+  return 0;
+}
+
+mtx_linop_t *mtx_precond_ilu0(const mtx_sparse_t *a) {
+  if (!a || a->rows != a->cols)
+    return NULL;
+
+  size_t n = a->rows;
+  precond_t *pc = precond_alloc(n, apply_ilu0);
+  size_t *pos = (size_t *)malloc((n ? n : 1) * sizeof(size_t));
+  if (!pc || !pos) {
+    free(pos);
+    free(pc);
+    return NULL;
+  }
+  pc->lu = mtx_sparse_convert(a, MTX_SPARSE_CSR);
+  pc->diag = (size_t *)malloc((n ? n : 1) * sizeof(size_t));
+  if (!pc->lu || !pc->diag) {
+    free(pos);
+    mtx_precond_free(&pc->op);
+    return NULL;
+  }
+
+  mtx_sparse_t *lu = pc->lu;
+  for (size_t j = 0; j < n; ++j) {
+    pos[j] = SIZE_MAX;
+  }
+  // IKJ elimination restricted to existing entries: fill-in is dropped.
+  int ok = 1;
+  for (size_t i = 0; i < n && ok; ++i) {
+    pc->diag[i] = SIZE_MAX;
+    for (size_t p = lu->ptr[i]; p < lu->ptr[i + 1]; ++p) {
+      pos[lu->idx[p]] = p;
+      if (lu->idx[p] == i)
+        pc->diag[i] = p;
+    }
+    if (pc->diag[i] == SIZE_MAX) {
+      ok = 0;
+    } else {
+      for (size_t p = lu->ptr[i]; p < pc->diag[i]; ++p) {
+        size_t k = lu->idx[p];
+        lu->val[p] /= lu->val[pc->diag[k]];
+        for (size_t q = pc->diag[k] + 1; q < lu->ptr[k + 1]; ++q) {
+          if (pos[lu->idx[q]] != SIZE_MAX)
+            lu->val[pos[lu->idx[q]]] -= lu->val[p] * lu->val[q];
+        }
+      }
+      ok = lu->val[pc->diag[i]] != 0.0;
+    }
+    for (size_t p = lu->ptr[i]; p < lu->ptr[i + 1]; ++p) {
+      pos[lu->idx[p]] = SIZE_MAX;
+    }
+  }
+
+  free(pos);
+  if (!ok) {
+    mtx_precond_free(&pc->op);
+    return NULL;
+  }
+  return &pc->op;
+}
+
+static double dot(const double *x, const double *y, size_t n) {
+  double s = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+static double norm2(const double *x, size_t n) { return sqrt(dot(x, x, n)); }
+
+// Defaults filled in, plus the history bookkeeping shared by both solvers.
+typedef struct {
+  double tol;
+  size_t max_iter;
+  size_t restart;
+  const mtx_linop_t *precond;
+  double *history;
+  size_t history_cap;
+  mtx_solver_info_t info;
+} solve_state_t;
+
+static void solve_init(solve_state_t *s, const mtx_solver_opts_t *opts) {
+  memset(s, 0, sizeof(*s));
+  if (opts) {
+    s->tol = opts->tol;
+    s->max_iter = opts->max_iter;
+    s->restart = opts->restart;
+    s->precond = opts->precond;
+    s->history = opts->history;
+    s->history_cap = opts->history ? opts->history_cap : 0;
+  }
+  if (s->tol <= 0.0)
+    s->tol = EPSILON;
+  if (s->max_iter == 0)
+    s->max_iter = MAX_ITERATIONS;
+  if (s->restart == 0)
+    s->restart = MTX_GMRES_RESTART;
+}
+
+static void solve_record(solve_state_t *s, double residual) {
+  s->info.residual = residual;
+  if (s->info.history_len < s->history_cap)
+    s->history[s->info.history_len++] = residual;
+}
+
+static int solve_finish(const solve_state_t *s, mtx_solver_info_t *info,
+                        int rc) {
+  if (info)
+    *info = s->info;
+  return rc;
+}
+
+static int valid_system(const mtx_linop_t *a, const double *b,
+                        const double *x, const mtx_linop_t *m) {
+  if (!a || !a->apply || !b || !x)
+    return 0;
+  return !m || (m->apply && m->n == a->n);
+}
+
+// r = b - A x.
+static int residual(const mtx_linop_t *a, const double *b, const double *x,
+                    double *r) {
+  if (a->apply(a->ctx, x, r) != 0)
+    return -1;
+  for (size_t i = 0; i < a->n; ++i) {
+    r[i] = b[i] - r[i];
+  }
+  return 0;
+}
+
+// z = M^-1 r, or a copy of r without a preconditioner.
+static int precondition(const mtx_linop_t *m, const double *r, double *z,
+                        size_t n) {
+  if (m)
+    return m->apply(m->ctx, r, z);
+  memcpy(z, r, n * sizeof(double));
+  return 0;
+}
+
+size_t mtx_cg_workspace_size(size_t n) {
+  return 4 * mtx_workspace_bytes(n * sizeof(double));
+}
+
+int mtx_cg(const mtx_linop_t *a, const double *b, double *x,
+           const mtx_solver_opts_t *opts, mtx_solver_info_t *info) {
+  return mtx_cg_ws(a, b, x, opts, info, NULL);
+}
+
+int mtx_cg_ws(const mtx_linop_t *a, const double *b, double *x,
+              const mtx_solver_opts_t *opts, mtx_solver_info_t *info,
+              mtx_workspace_t *ws) {
+  solve_state_t s;
+  solve_init(&s, opts);
+  if (!valid_system(a, b, x, s.precond))
+    return solve_finish(&s, info, -1);
+
+  size_t n = a->n;
+  double bnorm = norm2(b, n);
+  if (bnorm == 0.0) {
+    memset(x, 0, n * sizeof(double));
+    solve_record(&s, 0.0);
+    return solve_finish(&s, info, 0);
+  }
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_cg_workspace_size(n)) != 0)
+    return solve_finish(&s, info, -1);
+
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  double *r = mtx_workspace_doubles(scratch.ws, n);
+  double *z = mtx_workspace_doubles(scratch.ws, n);
+  double *p = mtx_workspace_doubles(scratch.ws, n);
+  double *q = mtx_workspace_doubles(scratch.ws, n);
+  int rc = -1;
+
+  if (residual(a, b, x, r) != 0 || precondition(s.precond, r, z, n) != 0)
+    goto done;
+  memcpy(p, z, n * sizeof(double));
+  double rz = dot(r, z, n);
+  solve_record(&s, norm2(r, n) / bnorm);
+  if (s.info.residual <= s.tol) {
+    rc = 0;
+    goto done;
+  }
+
+  while (s.info.iterations < s.max_iter) {
+    if (a->apply(a->ctx, p, q) != 0)
+      break;
+    double pq = dot(p, q, n);
+    // A non-positive curvature means A is not SPD.
+    if (!(pq > 0.0))
+      break;
+    double alpha = rz / pq;
+    ops->axpy(x, p, alpha, n);
+    ops->axpy(r, q, -alpha, n);
+    ++s.info.iterations;
+    solve_record(&s, norm2(r, n) / bnorm);
+    if (s.info.residual <= s.tol) {
+      rc = 0;
+      break;
+    }
+
+    if (precondition(s.precond, r, z, n) != 0)
+      break;
+    double rz_next = dot(r, z, n);
+    double beta = rz_next / rz;
+    rz = rz_next;
+    // p = z + beta * p
+    ops->scal(p, beta, n);
+    ops->add(p, z, n);
+  }
+
+done:
+  mtx_scratch_end(&scratch);
+  return solve_finish(&s, info, rc);
+}
+
+size_t mtx_gmres_workspace_size(size_t n, size_t restart) {
+  if (restart == 0)
+    restart = MTX_GMRES_RESTART;
+  size_t m = restart;
+  return mtx_workspace_bytes((m + 1) * n * sizeof(double)) +
+         2 * mtx_workspace_bytes(n * sizeof(double)) +
+         mtx_workspace_bytes((m + 1) * m * sizeof(double)) +
+         4 * mtx_workspace_bytes((m + 1) * sizeof(double));
+}
+
+int mtx_gmres(const mtx_linop_t *a, const double *b, double *x,
+              const mtx_solver_opts_t *opts, mtx_solver_info_t *info) {
+  return mtx_gmres_ws(a, b, x, opts, info, NULL);
+}
+
+// Restarted GMRES(m) with right preconditioning, so the residual it
+// minimizes is that of the original system. The Hessenberg matrix is kept
+// triangular with Givens rotations, making the residual norm available after
+// every step without forming x.
+int mtx_gmres_ws(const mtx_linop_t *a, const double *b, double *x,
+                 const mtx_solver_opts_t *opts, mtx_solver_info_t *info,
+                 mtx_workspace_t *ws) {
+  solve_state_t s;
+  solve_init(&s, opts);
+  if (!valid_system(a, b, x, s.precond))
+    return solve_finish(&s, info, -1);
+
+  size_t n = a->n, m = s.restart;
+  double bnorm = norm2(b, n);
+  if (bnorm == 0.0) {
+    memset(x, 0, n * sizeof(double));
+    solve_record(&s, 0.0);
+    return solve_finish(&s, info, 0);
+  }
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_gmres_workspace_size(n, m)) != 0)
+    return solve_finish(&s, info, -1);
+
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  mtx_workspace_t *w = scratch.ws;
+  double *v = mtx_workspace_doubles(w, (m + 1) * n);
+  double *z = mtx_workspace_doubles(w, n);
+  double *u = mtx_workspace_doubles(w, n);
+  double *h = mtx_workspace_doubles(w, (m + 1) * m);
+  double *cs = mtx_workspace_doubles(w, m + 1);
+  double *sn = mtx_workspace_doubles(w, m + 1);
+  double *g = mtx_workspace_doubles(w, m + 1);
+  double *y = mtx_workspace_doubles(w, m + 1);
+  int rc = -1;
+
+  if (residual(a, b, x, v) != 0)
+    goto done;
+  double beta = norm2(v, n);
+  solve_record(&s, beta / bnorm);
+  if (s.info.residual <= s.tol) {
+    rc = 0;
+    goto done;
+  }
+
+  while (s.info.iterations < s.max_iter) {
+    ops->scal(v, 1.0 / beta, n);
+    memset(g, 0, (m + 1) * sizeof(double));
+    g[0] = beta;
+
+    size_t k = 0;
+    int failed = 0, breakdown = 0;
+    while (k < m && s.info.iterations < s.max_iter) {
+      double *vk = v + k * n, *vn = v + (k + 1) * n;
+      if (precondition(s.precond, vk, z, n) != 0 ||
+          a->apply(a->ctx, z, vn) != 0) {
+        failed = 1;
+        break;
+      }
+      // Modified Gram-Schmidt against the basis so far.
+      for (size_t i = 0; i <= k; ++i) {
+        h[i * m + k] = dot(vn, v + i * n, n);
+        ops->axpy(vn, v + i * n, -h[i * m + k], n);
+      }
+      double hn = norm2(vn, n);
+
+      for (size_t i = 0; i < k; ++i) {
+        double t = cs[i] * h[i * m + k] + sn[i] * h[(i + 1) * m + k];
+        h[(i + 1) * m + k] = -sn[i] * h[i * m + k] + cs[i] * h[(i + 1) * m + k];
+        h[i * m + k] = t;
+      }
+      double r = hypot(h[k * m + k], hn);
+      if (r == 0.0) {
+        failed = 1;
+        break;
+      }
+      cs[k] = h[k * m + k] / r;
+      sn[k] = hn / r;
+      h[k * m + k] = r;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] *= cs[k];
+
+      ++k;
+      ++s.info.iterations;
+      solve_record(&s, fabs(g[k]) / bnorm);
+      if (s.info.residual <= s.tol)
+        break;
+      // An invariant subspace: the solution lies in the current basis.
+      if (hn == 0.0) {
+        breakdown = 1;
+        break;
+      }
+      ops->scal(vn, 1.0 / hn, n);
+    }
+
+    // x += M^-1 (V y) with y from the triangular system H y = g.
+    for (size_t i = k; i-- > 0;) {
+      double t = g[i];
+      for (size_t j = i + 1; j < k; ++j) {
+        t -= h[i * m + j] * y[j];
+      }
+      y[i] = t / h[i * m + i];
+    }
+    memset(u, 0, n * sizeof(double));
+    for (size_t j = 0; j < k; ++j) {
+      ops->axpy(u, v + j * n, y[j], n);
+    }
+    if (precondition(s.precond, u, z, n) != 0)
+      break;
+    ops->add(x, z, n);
+    if (failed)
+      break;
+
+    if (residual(a, b, x, v) != 0)
+      break;
+    beta = norm2(v, n);
+    s.info.residual = beta / bnorm;
+    if (s.info.residual <= s.tol) {
+      rc = 0;
+      break;
+    }
+    if (breakdown)
+      break;
+  }
+
+done:
+  mtx_scratch_end(&scratch);
+  return solve_finish(&s, info, rc);
+}
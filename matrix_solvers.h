@@ -0,0 +1,66 @@
+#ifndef MATRIX_SOLVERS_H
+#define MATRIX_SOLVERS_H
+
+#include "matrix.h"
+#include "matrix_sparse.h"
+#include "matrix_workspace.h"
+
+#define MTX_GMRES_RESTART 30
+
+// y = A * x for n-vectors. A nonzero return aborts the solve.
+typedef int (*mtx_apply_fn)(void *ctx, const double *x, double *y);
+
+// A square operator given only by its action, so solvers run matrix-free.
+typedef struct {
+  size_t n;
+  mtx_apply_fn apply;
+  void *ctx;
+} mtx_linop_t;
+
+// Operators over a square matrix, which must outlive them.
+int mtx_linop_dense(mtx_linop_t *op, const matrix_t *a);
+int mtx_linop_sparse(mtx_linop_t *op, const mtx_sparse_t *a);
+
+// Preconditioners M^-1 as operators: Jacobi (inverse diagonal) and ILU(0)
+// (incomplete LU on a's sparsity pattern; dense matrices go through
+// mtx_sparse_from_dense first). NULL when a has a zero diagonal or pivot.
+mtx_linop_t *mtx_precond_jacobi(const mtx_sparse_t *a);
+mtx_linop_t *mtx_precond_jacobi_dense(const matrix_t *a);
+mtx_linop_t *mtx_precond_ilu0(const mtx_sparse_t *a);
+void mtx_precond_free(mtx_linop_t *m);
+
+typedef struct {
+  double tol;                 // target ||b - A x|| / ||b||; 0 means EPSILON
+  size_t max_iter;            // 0 means MAX_ITERATIONS
+  size_t restart;             // GMRES basis size; 0 means MTX_GMRES_RESTART
+  const mtx_linop_t *precond; // NULL for none
+  double *history;            // if set, relative residuals, starting with x0's
+  size_t history_cap;
+} mtx_solver_opts_t;
+
+typedef struct {
+  size_t iterations;
+  double residual;
+  size_t history_len;
+} mtx_solver_info_t;
+
+// Solve A x = b starting from the guess in x. CG needs A (and M) symmetric
+// positive definite; GMRES takes any nonsingular A and preconditions on the
+// right. Return 0 once the tolerance is met and -1 on bad arguments,
+// breakdown or reaching max_iter. opts and info may be NULL.
+int mtx_cg(const mtx_linop_t *a, const double *b, double *x,
+           const mtx_solver_opts_t *opts, mtx_solver_info_t *info);
+int mtx_gmres(const mtx_linop_t *a, const double *b, double *x,
+              const mtx_solver_opts_t *opts, mtx_solver_info_t *info);
+
+int mtx_cg_ws(const mtx_linop_t *a, const double *b, double *x,
+              const mtx_solver_opts_t *opts, mtx_solver_info_t *info,
+              mtx_workspace_t *ws);
+int mtx_gmres_ws(const mtx_linop_t *a, const double *b, double *x,
+                 const mtx_solver_opts_t *opts, mtx_solver_info_t *info,
+                 mtx_workspace_t *ws);
+
+size_t mtx_cg_workspace_size(size_t n);
+size_t mtx_gmres_workspace_size(size_t n, size_t restart);
+
+#endif // MATRIX_SOLVERS_H
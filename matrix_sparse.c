@@ -0,0 +1,553 @@
+#include "matrix_sparse.h"
+#include "matrix.h"
+#include "matrix_simd.h"
+#include "matrix_threads.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MTX_SPARSE_MAX_CHUNKS 64
+#define MTX_SPARSE_COL_GRAIN 64
+
+static size_t outer_dim(const mtx_sparse_t *s) {
+  return s->format == MTX_SPARSE_CSR ? s->rows : s->cols;
+}
+
+static size_t inner_dim(const mtx_sparse_t *s) {
+  return s->format == MTX_SPARSE_CSR ? s->cols : s->rows;
+}
+
+mtx_sparse_t *mtx_sparse_alloc(mtx_sparse_format_t format, size_t rows,
+                               size_t cols, size_t nnz) {
+  mtx_sparse_t *s = (mtx_sparse_t *)malloc(sizeof(mtx_sparse_t));
+  if (!s)
+    return NULL;
+
+  s->format = format;
+  s->rows = rows;
+  s->cols = cols;
+  s->nnz = 0;
+  s->ptr = (size_t *)calloc(outer_dim(s) + 1, sizeof(size_t));
+  s->idx = (size_t *)malloc((nnz ? nnz : 1) * sizeof(size_t));
+  s->val = (double *)malloc((nnz ? nnz : 1) * sizeof(double));
+  if (!s->ptr || !s->idx || !s->val) {
+    mtx_sparse_free(s);
+    return NULL;
+  }
+  return s;
+}
+
+void mtx_sparse_free(mtx_sparse_t *s) {
+  if (s) {
+    free(s->ptr);
+    free(s->idx);
+    free(s->val);
+    free(s);
+  }
+}
+
+// Regroups outer x inner compressed storage by inner index. Entries of each
+// output group come out ordered by their outer index.
+static int compress_transposed(size_t outer, size_t inner, const size_t *ptr,
+                               const size_t *idx, const double *val,
+                               size_t *out_ptr, size_t *out_idx,
+                               double *out_val) {
+  size_t *next = (size_t *)malloc((inner ? inner : 1) * sizeof(size_t));
+  if (!next)
+    return -1;
+
+  memset(out_ptr, 0, (inner + 1) * sizeof(size_t));
+  for (size_t p = 0; p < ptr[outer]; ++p) {
+    ++out_ptr[idx[p] + 1];
+  }
+  for (size_t j = 0; j < inner; ++j) {
+    out_ptr[j + 1] += out_ptr[j];
+    next[j] = out_ptr[j];
+  }
+  for (size_t i = 0; i < outer; ++i) {
+    for (size_t p = ptr[i]; p < ptr[i + 1]; ++p) {
+      size_t q = next[idx[p]]++;
+      out_idx[q] = i;
+      out_val[q] = val[p];
+    }
+  }
+
+  free(next);
+  return 0;
+}
+
+mtx_sparse_t *mtx_sparse_from_dense(const matrix_t *m,
+                                    mtx_sparse_format_t format, double tol) {
+  if (!m || (!m->data && m->rows * m->cols != 0))
+    return NULL;
+
+  size_t nnz = 0;
+  for (size_t i = 0; i < m->rows; ++i) {
+    const double *row = mtx_crow(m, i);
+    for (size_t j = 0; j < m->cols; ++j) {
+      nnz += fabs(row[j]) > tol;
+    }
+  }
+
+  mtx_sparse_t *s = mtx_sparse_alloc(format, m->rows, m->cols, nnz);
+  if (!s)
+    return NULL;
+
+  if (format == MTX_SPARSE_CSR) {
+    for (size_t i = 0; i < m->rows; ++i) {
+      const double *row = mtx_crow(m, i);
+      size_t p = s->ptr[i];
+      for (size_t j = 0; j < m->cols; ++j) {
+        if (fabs(row[j]) > tol) {
+          s->idx[p] = j;
+          s->val[p++] = row[j];
+        }
+      }
+      s->ptr[i + 1] = p;
+    }
+  } else {
+    for (size_t i = 0; i < m->rows; ++i) {
+      const double *row = mtx_crow(m, i);
+      for (size_t j = 0; j < m->cols; ++j) {
+        s->ptr[j + 1] += fabs(row[j]) > tol;
+      }
+    }
+    for (size_t j = 0; j < m->cols; ++j) {
+      s->ptr[j + 1] += s->ptr[j];
+    }
+    // Fill column by column through per-column cursors kept in ptr, then
+    // shift ptr back to column starts.
+    for (size_t i = 0; i < m->rows; ++i) {
+      const double *row = mtx_crow(m, i);
+      for (size_t j = 0; j < m->cols; ++j) {
+        if (fabs(row[j]) > tol) {
+          size_t p = s->ptr[j]++;
+          s->idx[p] = i;
+          s->val[p] = row[j];
+        }
+      }
+    }
+    for (size_t j = m->cols; j > 0; --j) {
+      s->ptr[j] = s->ptr[j - 1];
+    }
+    s->ptr[0] = 0;
+  }
+  s->nnz = nnz;
+  return s;
+}
+
+mtx_sparse_t *mtx_sparse_from_triplets(mtx_sparse_format_t format,
+                                       size_t rows, size_t cols, size_t count,
+                                       const size_t *ri, const size_t *ci,
+                                       const double *v) {
+  if (count && (!ri || !ci || !v))
+    return NULL;
+  for (size_t p = 0; p < count; ++p) {
+    if (ri[p] >= rows || ci[p] >= cols)
+      return NULL;
+  }
+
+  const size_t *oi = format == MTX_SPARSE_CSR ? ri : ci;
+  const size_t *ii = format == MTX_SPARSE_CSR ? ci : ri;
+  mtx_sparse_t *s = mtx_sparse_alloc(format, rows, cols, count);
+  mtx_sparse_t *t = mtx_sparse_alloc(format == MTX_SPARSE_CSR ? MTX_SPARSE_CSC
+                                                              : MTX_SPARSE_CSR,
+                                     rows, cols, count);
+  if (!s || !t) {
+    mtx_sparse_free(s);
+    mtx_sparse_free(t);
+    return NULL;
+  }
+
+  // Bucket by inner index first; regrouping by outer index then leaves each
+  // row or column sorted, with duplicates adjacent.
+  size_t outer = outer_dim(s), inner = inner_dim(s);
+  for (size_t p = 0; p < count; ++p) {
+    ++t->ptr[ii[p] + 1];
+  }
+  for (size_t j = 0; j < inner; ++j) {
+    t->ptr[j + 1] += t->ptr[j];
+  }
+  for (size_t p = 0; p < count; ++p) {
+    size_t q = t->ptr[ii[p]]++;
+    t->idx[q] = oi[p];
+    t->val[q] = v[p];
+  }
+  for (size_t j = inner; j > 0; --j) {
+    t->ptr[j] = t->ptr[j - 1];
+  }
+  t->ptr[0] = 0;
+
+  int rc = compress_transposed(inner, outer, t->ptr, t->idx, t->val, s->ptr,
+                               s->idx, s->val);
+  mtx_sparse_free(t);
+  if (rc != 0) {
+    mtx_sparse_free(s);
+    return NULL;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < outer; ++i) {
+    size_t begin = s->ptr[i], end = s->ptr[i + 1];
+    s->ptr[i] = n;
+    for (size_t p = begin; p < end; ++p) {
+      if (n > s->ptr[i] && s->idx[n - 1] == s->idx[p]) {
+        s->val[n - 1] += s->val[p];
+      } else {
+        s->idx[n] = s->idx[p];
+        s->val[n++] = s->val[p];
+      }
+    }
+  }
+  s->ptr[outer] = n;
+  s->nnz = n;
+  return s;
+}
+
+int mtx_sparse_to_dense(const mtx_sparse_t *s, matrix_t *m) {
+  if (!s || !m)
+    return -1;
+  if (m->rows != s->rows || m->cols != s->cols)
+    return -1;
+  if (m->rows * m->cols == 0)
+    return 0;
+  if (!m->data)
+    return -1;
+
+  mtx_set_zero(m);
+  for (size_t i = 0; i < outer_dim(s); ++i) {
+    for (size_t p = s->ptr[i]; p < s->ptr[i + 1]; ++p) {
+      if (s->format == MTX_SPARSE_CSR)
+        *mtx_at(m, i, s->idx[p]) = s->val[p];
+      else
+        *mtx_at(m, s->idx[p], i) = s->val[p];
+    }
+  }
+  return 0;
+}
+
+mtx_sparse_t *mtx_sparse_convert(const mtx_sparse_t *s,
+                                 mtx_sparse_format_t format) {
+  if (!s)
+    return NULL;
+
+  mtx_sparse_t *r = mtx_sparse_alloc(format, s->rows, s->cols, s->nnz);
+  if (!r)
+    return NULL;
+
+  if (format == s->format) {
+    memcpy(r->ptr, s->ptr, (outer_dim(s) + 1) * sizeof(size_t));
+    memcpy(r->idx, s->idx, s->nnz * sizeof(size_t));
+    memcpy(r->val, s->val, s->nnz * sizeof(double));
+  } else if (compress_transposed(outer_dim(s), inner_dim(s), s->ptr, s->idx,
+                                 s->val, r->ptr, r->idx, r->val) != 0) {
+    mtx_sparse_free(r);
+    return NULL;
+  }
+  r->nnz = s->nnz;
+  return r;
+}
+
+mtx_sparse_t *mtx_sparse_transpose(const mtx_sparse_t *s) {
+  if (!s)
+    return NULL;
+
+  mtx_sparse_t *r = mtx_sparse_alloc(s->format, s->cols, s->rows, s->nnz);
+  if (!r)
+    return NULL;
+
+  if (compress_transposed(outer_dim(s), inner_dim(s), s->ptr, s->idx, s->val,
+                          r->ptr, r->idx, r->val) != 0) {
+    mtx_sparse_free(r);
+    return NULL;
+  }
+  r->nnz = s->nnz;
+  return r;
+}
+
+// Splits the rows (or columns) of s into chunks of about equal entries plus
+// rows, so a few dense rows do not serialize the work. Returns the chunk
+// count; chunk c covers [bounds[c], bounds[c + 1]).
+static size_t balanced_chunks(const mtx_sparse_t *s, size_t work,
+                              size_t *bounds) {
+  size_t outer = outer_dim(s), total = s->nnz + outer;
+  size_t chunks = 1;
+  if (work >= MTX_PARALLEL_MIN_ELEMENTS) {
+    chunks = 4 * mtx_get_num_threads();
+    if (chunks > MTX_SPARSE_MAX_CHUNKS)
+      chunks = MTX_SPARSE_MAX_CHUNKS;
+    if (chunks > outer)
+      chunks = outer ? outer : 1;
+  }
+
+  bounds[0] = 0;
+  for (size_t c = 1; c < chunks; ++c) {
+    size_t target = total * c / chunks, lo = bounds[c - 1], hi = outer;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (s->ptr[mid] + mid < target)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    bounds[c] = lo;
+  }
+  bounds[chunks] = outer;
+  return chunks;
+}
+
+typedef struct {
+  const mtx_sparse_t *a;
+  double alpha;
+  const double *x;
+  double beta;
+  double *y;
+  const size_t *bounds;
+} spmv_job_t;
+
+static void spmv_range(void *ctx, size_t begin, size_t end) {
+  spmv_job_t *job = (spmv_job_t *)ctx;
+  const mtx_sparse_t *a = job->a;
+  for (size_t i = job->bounds[begin]; i < job->bounds[end]; ++i) {
+    double sum = 0.0;
+    for (size_t p = a->ptr[i]; p < a->ptr[i + 1]; ++p) {
+      sum += a->val[p] * job->x[a->idx[p]];
+    }
+    job->y[i] = job->beta == 0.0 ? job->alpha * sum
+                                 : job->alpha * sum + job->beta * job->y[i];
+  }
+}
+
+int mtx_sparse_spmv(const mtx_sparse_t *a, double alpha, const double *x,
+                    double beta, double *y) {
+  if (!a || (a->rows && !y) || (a->cols && !x))
+    return -1;
+
+  if (a->format == MTX_SPARSE_CSR) {
+    size_t bounds[MTX_SPARSE_MAX_CHUNKS + 1];
+    size_t chunks = balanced_chunks(a, a->nnz + a->rows, bounds);
+    spmv_job_t job = {a, alpha, x, beta, y, bounds};
+    mtx_parallel_for(chunks, 1, spmv_range, &job);
+    return 0;
+  }
+
+  for (size_t i = 0; i < a->rows; ++i) {
+    y[i] = beta == 0.0 ? 0.0 : beta * y[i];
+  }
+  for (size_t j = 0; j < a->cols; ++j) {
+    double ax = alpha * x[j];
+    for (size_t p = a->ptr[j]; p < a->ptr[j + 1]; ++p) {
+      y[a->idx[p]] += a->val[p] * ax;
+    }
+  }
+  return 0;
+}
+
+typedef struct {
+  matrix_t *result;
+  const mtx_sparse_t *a;
+  const matrix_t *b;
+  const size_t *bounds;
+} spmm_job_t;
+
+static void spmm_rows(void *ctx, size_t begin, size_t end) {
+  spmm_job_t *job = (spmm_job_t *)ctx;
+  const mtx_sparse_t *a = job->a;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t n = job->b->cols;
+  for (size_t i = job->bounds[begin]; i < job->bounds[end]; ++i) {
+    double *row = mtx_row(job->result, i);
+    memset(row, 0, n * sizeof(double));
+    for (size_t p = a->ptr[i]; p < a->ptr[i + 1]; ++p) {
+      ops->axpy(row, mtx_crow(job->b, a->idx[p]), a->val[p], n);
+    }
+  }
+}
+
+// Each chunk owns columns [begin, end) of result, so CSC scatters never
+// collide.
+static void spmm_cols(void *ctx, size_t begin, size_t end) {
+  spmm_job_t *job = (spmm_job_t *)ctx;
+  const mtx_sparse_t *a = job->a;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  size_t n = end - begin;
+  for (size_t i = 0; i < a->rows; ++i) {
+    memset(mtx_row(job->result, i) + begin, 0, n * sizeof(double));
+  }
+  for (size_t k = 0; k < a->cols; ++k) {
+    const double *src = mtx_crow(job->b, k) + begin;
+    for (size_t p = a->ptr[k]; p < a->ptr[k + 1]; ++p) {
+      ops->axpy(mtx_row(job->result, a->idx[p]) + begin, src, a->val[p], n);
+    }
+  }
+}
+
+int mtx_sparse_mul_dense(matrix_t *result, const mtx_sparse_t *a,
+                         const matrix_t *b) {
+  if (!result || !a || !b)
+    return -1;
+  if (a->cols != b->rows)
+    return -1;
+  if (result->rows != a->rows || result->cols != b->cols)
+    return -1;
+  if (result->rows * result->cols == 0)
+    return 0;
+  if (!result->data || (!b->data && b->rows * b->cols != 0))
+    return -1;
+  if (mtx_overlaps(result, b))
+    return -1;
+
+  size_t work = (a->nnz + a->rows) * b->cols;
+  spmm_job_t job = {result, a, b, NULL};
+  if (a->format == MTX_SPARSE_CSR) {
+    size_t bounds[MTX_SPARSE_MAX_CHUNKS + 1];
+    job.bounds = bounds;
+    mtx_parallel_for(balanced_chunks(a, work, bounds), 1, spmm_rows, &job);
+  } else {
+    size_t grain = b->cols;
+    if (work >= MTX_PARALLEL_MIN_ELEMENTS)
+      grain = MTX_SPARSE_COL_GRAIN;
+    mtx_parallel_for(b->cols, grain, spmm_cols, &job);
+  }
+  return 0;
+}
+
+// Row-by-row (Gustavson) product of compressed x and y: output group i sums
+// x's entries (i, k) times group k of y. The first pass only counts each
+// group's entries; the second fills them, sorted.
+typedef struct {
+  const mtx_sparse_t *x;
+  const mtx_sparse_t *y;
+  size_t inner;
+  mtx_sparse_t *out;
+  int fill;
+  const size_t *bounds;
+  int failed;
+  pthread_mutex_t lock;
+} spgemm_job_t;
+
+static int compare_index(const void *a, const void *b) {
+  size_t i = *(const size_t *)a, j = *(const size_t *)b;
+  return (i > j) - (i < j);
+}
+
+static void spgemm_range(void *ctx, size_t begin, size_t end) {
+  spgemm_job_t *job = (spgemm_job_t *)ctx;
+  const mtx_sparse_t *x = job->x, *y = job->y;
+  mtx_sparse_t *out = job->out;
+  size_t *mark = (size_t *)malloc((job->inner ? job->inner : 1) *
+                                  sizeof(size_t));
+  double *acc = job->fill ? (double *)malloc((job->inner ? job->inner : 1) *
+                                             sizeof(double))
+                          : NULL;
+  if (!mark || (job->fill && !acc)) {
+    free(mark);
+    free(acc);
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_mutex_unlock(&job->lock);
+    return;
+  }
+
+  for (size_t j = 0; j < job->inner; ++j) {
+    mark[j] = SIZE_MAX;
+  }
+  for (size_t i = job->bounds[begin]; i < job->bounds[end]; ++i) {
+    size_t n = 0, *idx = job->fill ? out->idx + out->ptr[i] : NULL;
+    for (size_t p = x->ptr[i]; p < x->ptr[i + 1]; ++p) {
+      size_t k = x->idx[p];
+      for (size_t q = y->ptr[k]; q < y->ptr[k + 1]; ++q) {
+        size_t j = y->idx[q];
+        if (mark[j] != i) {
+          mark[j] = i;
+          if (job->fill) {
+            acc[j] = x->val[p] * y->val[q];
+            idx[n] = j;
+          }
+          ++n;
+        } else if (job->fill) {
+          acc[j] += x->val[p] * y->val[q];
+        }
+      }
+    }
+    if (!job->fill) {
+      out->ptr[i + 1] = n;
+      continue;
+    }
+    qsort(idx, n, sizeof(size_t), compare_index);
+    for (size_t p = 0; p < n; ++p) {
+      out->val[out->ptr[i] + p] = acc[idx[p]];
+    }
+  }
+
+  free(mark);
+  free(acc);
+}
+
+mtx_sparse_t *mtx_sparse_mul(const mtx_sparse_t *a, const mtx_sparse_t *b) {
+  if (!a || !b || a->cols != b->rows)
+    return NULL;
+
+  mtx_sparse_t *converted = NULL;
+  if (b->format != a->format) {
+    converted = mtx_sparse_convert(b, a->format);
+    if (!converted)
+      return NULL;
+    b = converted;
+  }
+
+  // CSC storage of a matrix is CSR storage of its transpose, and
+  // (a * b)^T = b^T * a^T, so CSC runs the same product with swapped roles.
+  spgemm_job_t job = {0};
+  job.x = a->format == MTX_SPARSE_CSR ? a : b;
+  job.y = a->format == MTX_SPARSE_CSR ? b : a;
+  job.inner = inner_dim(job.y);
+  job.out = mtx_sparse_alloc(a->format, a->rows, b->cols, 0);
+  pthread_mutex_init(&job.lock, NULL);
+
+  size_t bounds[MTX_SPARSE_MAX_CHUNKS + 1];
+  size_t chunks = 0;
+  if (job.out) {
+    size_t work = 0;
+    for (size_t p = 0; p < job.x->nnz; ++p) {
+      size_t k = job.x->idx[p];
+      work += job.y->ptr[k + 1] - job.y->ptr[k];
+    }
+    chunks = balanced_chunks(job.x, work, bounds);
+    job.bounds = bounds;
+    mtx_parallel_for(chunks, 1, spgemm_range, &job);
+  }
+
+  if (job.out && !job.failed) {
+    size_t outer = outer_dim(job.out);
+    for (size_t i = 0; i < outer; ++i) {
+      job.out->ptr[i + 1] += job.out->ptr[i];
+    }
+    size_t nnz = job.out->ptr[outer];
+    size_t *idx = (size_t *)realloc(job.out->idx,
+                                    (nnz ? nnz : 1) * sizeof(size_t));
+    if (idx)
+      job.out->idx = idx;
+    double *val = (double *)realloc(job.out->val,
+                                    (nnz ? nnz : 1) * sizeof(double));
+    if (val)
+      job.out->val = val;
+    if (idx && val) {
+      job.fill = 1;
+      mtx_parallel_for(chunks, 1, spgemm_range, &job);
+      job.out->nnz = nnz;
+    } else {
+      job.failed = 1;
+    }
+  }
+
+  pthread_mutex_destroy(&job.lock);
+  mtx_sparse_free(converted);
+  if (!job.out || job.failed) {
+    mtx_sparse_free(job.out);
+    return NULL;
+  }
+  return job.out;
+}
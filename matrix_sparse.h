@@ -0,0 +1,54 @@
+#ifndef MATRIX_SPARSE_H
+#define MATRIX_SPARSE_H
+
+#include "matrix.h"
+
+typedef enum { MTX_SPARSE_CSR, MTX_SPARSE_CSC } mtx_sparse_format_t;
+
+// Compressed sparse rows (CSR) or columns (CSC). Entry p of row (CSR) or
+// column (CSC) i lies in [ptr[i], ptr[i + 1]), at column (CSR) or row (CSC)
+// idx[p], with value val[p]. Indices within a row or column are ascending
+// and unique. Storage is O(nnz + rows) for CSR and O(nnz + cols) for CSC.
+typedef struct {
+  mtx_sparse_format_t format;
+  size_t rows;
+  size_t cols;
+  size_t nnz;
+  size_t *ptr;
+  size_t *idx;
+  double *val;
+} mtx_sparse_t;
+
+// Room for nnz entries, with every row or column empty.
+mtx_sparse_t *mtx_sparse_alloc(mtx_sparse_format_t format, size_t rows,
+                               size_t cols, size_t nnz);
+void mtx_sparse_free(mtx_sparse_t *s);
+
+// Entries of m with magnitude above tol.
+mtx_sparse_t *mtx_sparse_from_dense(const matrix_t *m,
+                                    mtx_sparse_format_t format, double tol);
+// Entries (ri[p], ci[p], v[p]) in any order; duplicates are summed.
+mtx_sparse_t *mtx_sparse_from_triplets(mtx_sparse_format_t format,
+                                       size_t rows, size_t cols, size_t count,
+                                       const size_t *ri, const size_t *ci,
+                                       const double *v);
+int mtx_sparse_to_dense(const mtx_sparse_t *s, matrix_t *m);
+
+// The same matrix in another format (or a copy), and the transpose in the
+// same format.
+mtx_sparse_t *mtx_sparse_convert(const mtx_sparse_t *s,
+                                 mtx_sparse_format_t format);
+mtx_sparse_t *mtx_sparse_transpose(const mtx_sparse_t *s);
+
+// y = alpha * a * x + beta * y. When beta == 0, y is not read. CSR runs in
+// parallel over rows; CSC scatters into y on one thread.
+int mtx_sparse_spmv(const mtx_sparse_t *a, double alpha, const double *x,
+                    double beta, double *y);
+// result = a * b for dense b and result, which must not overlap. CSR splits
+// the rows of result across threads and CSC splits its columns.
+int mtx_sparse_mul_dense(matrix_t *result, const mtx_sparse_t *a,
+                         const matrix_t *b);
+// a * b in a's format, or NULL on mismatch or allocation failure.
+mtx_sparse_t *mtx_sparse_mul(const mtx_sparse_t *a, const mtx_sparse_t *b);
+
+#endif // MATRIX_SPARSE_H
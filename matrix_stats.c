@@ -0,0 +1,194 @@
+#include "matrix_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MTX_STATS_NAME(id, name) name,
+static const char *const op_names[] = {MTX_STATS_OPS(MTX_STATS_NAME)};
+#undef MTX_STATS_NAME
+
+const char *mtx_stats_op_name(mtx_op_t op) {
+  return (unsigned)op < MTX_OP_COUNT ? op_names[op] : NULL;
+}
+
+void mtx_stats_print(const mtx_stats_t *s) {
+  if (!s)
+    return;
+
+  printf("%-22s %10s %12s %14s %8s %12s %8s %6s %12s\n", "op", "calls",
+         "ms", "flops", "allocs", "alloc bytes", "GB/s", "IPC", "llc miss");
+  for (int i = 0; i < MTX_OP_COUNT; ++i) {
+    const mtx_op_stats_t *o = &s->op[i];
+    if (o->calls == 0 && o->allocs == 0)
+      continue;
+    double gbs = o->nanos ? (double)o->bytes / (double)o->nanos : 0.0;
+    double ipc = o->cycles ? (double)o->instructions / (double)o->cycles : 0.0;
+    printf("%-22s %10llu %12.3f %14llu %8llu %12llu %8.2f %6.2f %12llu\n",
+           op_names[i], (unsigned long long)o->calls, o->nanos * 1e-6,
+           (unsigned long long)o->flops, (unsigned long long)o->allocs,
+           (unsigned long long)o->alloc_bytes, gbs, ipc,
+           (unsigned long long)o->cache_misses);
+  }
+}
+
+#ifdef MTX_ENABLE_STATS
+
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static mtx_op_stats_t totals[MTX_OP_COUNT];
+#define TOTAL_WORDS                                                          \
+  (MTX_OP_COUNT * sizeof(mtx_op_stats_t) / sizeof(uint64_t))
+static int hw_enabled;
+
+// Outermost open frame on this thread.
+static __thread int depth;
+static __thread int current_op = MTX_OP_OTHER;
+
+#define ADD(field, v) __atomic_fetch_add(&(field), (v), __ATOMIC_RELAXED)
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef __linux__
+// One counter group per thread: cycles leads, instructions and cache misses
+// follow, all read together. -2 means not opened yet, -1 unavailable.
+static __thread int hw_fd = -2;
+
+static int perf_open(uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static int hw_open(void) {
+  if (hw_fd != -2)
+    return hw_fd;
+
+  hw_fd = perf_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (hw_fd < 0)
+    return hw_fd = -1;
+  if (perf_open(PERF_COUNT_HW_INSTRUCTIONS, hw_fd) < 0 ||
+      perf_open(PERF_COUNT_HW_CACHE_MISSES, hw_fd) < 0) {
+    close(hw_fd);
+    return hw_fd = -1;
+  }
+  ioctl(hw_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return hw_fd;
+}
+
+static int hw_read(uint64_t out[3]) {
+  uint64_t buf[4];
+  if (!hw_enabled || hw_open() < 0 ||
+      read(hw_fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+    return -1;
+  memcpy(out, buf + 1, 3 * sizeof(uint64_t));
+  return 0;
+}
+#else
+static int hw_open(void) { return -1; }
+
+static int hw_read(uint64_t out[3]) {
+  (void)out;
+  return -1;
+}
+#endif
+
+int mtx_stats_enabled(void) { return 1; }
+
+int mtx_stats_set_hw(int enable) {
+  if (enable && hw_open() < 0) {
+    __atomic_store_n(&hw_enabled, 0, __ATOMIC_RELAXED);
+    return -1;
+  }
+  __atomic_store_n(&hw_enabled, enable != 0, __ATOMIC_RELAXED);
+  return 0;
+}
+
+void mtx_stats_snapshot(mtx_stats_t *s) {
+  if (!s)
+    return;
+  uint64_t *dst = (uint64_t *)s->op, *src = (uint64_t *)totals;
+  for (size_t i = 0; i < TOTAL_WORDS; ++i) {
+    dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+  }
+}
+
+void mtx_stats_reset(void) {
+  uint64_t *p = (uint64_t *)totals;
+  for (size_t i = 0; i < TOTAL_WORDS; ++i) {
+    __atomic_store_n(&p[i], 0, __ATOMIC_RELAXED);
+  }
+}
+
+mtx_stats_frame_t mtx_stats_enter(mtx_op_t op) {
+  mtx_stats_frame_t f = {-1, 0, {0, 0, 0}};
+  if (depth++ > 0)
+    return f;
+
+  f.op = op;
+  current_op = op;
+  ADD(totals[op].calls, 1);
+  if (hw_read(f.hw) != 0)
+    f.hw[0] = f.hw[1] = f.hw[2] = UINT64_MAX;
+  f.start = now_ns();
+  return f;
+}
+
+void mtx_stats_leave(mtx_stats_frame_t *f) {
+  depth--;
+  if (f->op < 0)
+    return;
+
+  mtx_op_stats_t *t = &totals[f->op];
+  ADD(t->nanos, now_ns() - f->start);
+  uint64_t hw[3];
+  if (f->hw[0] != UINT64_MAX && hw_read(hw) == 0) {
+    ADD(t->cycles, hw[0] - f->hw[0]);
+    ADD(t->instructions, hw[1] - f->hw[1]);
+    ADD(t->cache_misses, hw[2] - f->hw[2]);
+  }
+  current_op = MTX_OP_OTHER;
+}
+
+void mtx_stats_work(const mtx_stats_frame_t *f, uint64_t bytes,
+                    uint64_t flops) {
+  if (f->op < 0)
+    return;
+  ADD(totals[f->op].bytes, bytes);
+  ADD(totals[f->op].flops, flops);
+}
+
+void mtx_stats_alloc(size_t bytes) {
+  ADD(totals[current_op].allocs, 1);
+  ADD(totals[current_op].alloc_bytes, (uint64_t)bytes);
+}
+
+#else
+
+int mtx_stats_enabled(void) { return 0; }
+
+int mtx_stats_set_hw(int enable) { return enable ? -1 : 0; }
+
+void mtx_stats_snapshot(mtx_stats_t *s) {
+  if (s)
+    memset(s, 0, sizeof(*s));
+}
+
+void mtx_stats_reset(void) {}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef MATRIX_STATS_H
+#define MATRIX_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Instrumented public operations. A function and its _ws variant share one
+// entry.
+#define MTX_STATS_OPS(X)                                                     \
+  X(ALLOC_LD, "mtx_alloc_ld")                                                \
+  X(ALLOC, "mtx_alloc")                                                      \
+  X(ALLOC_PADDED, "mtx_alloc_padded")                                        \
+  X(ALLOC_ZERO, "mtx_alloc_zero")                                            \
+  X(ALLOC_ID, "mtx_alloc_id")                                                \
+  X(COPY, "mtx_copy")                                                        \
+  X(FREE, "mtx_free")                                                        \
+  X(ASSIGN, "mtx_assign")                                                    \
+  X(MOVE_ASSIGN, "mtx_move_assign")                                          \
+  X(SET_ZERO, "mtx_set_zero")                                                \
+  X(SET_ID, "mtx_set_id")                                                    \
+  X(READ, "mtx_read")                                                        \
+  X(PRINT, "mtx_print")                                                      \
+  X(ADD, "mtx_add")                                                          \
+  X(SUB, "mtx_sub")                                                          \
+  X(MUL, "mtx_mul")                                                          \
+  X(MUL3, "mtx_mul3")                                                        \
+  X(DIV, "mtx_div")                                                          \
+  X(ADD_SCALED, "mtx_add_scaled")                                            \
+  X(SCALE, "mtx_scale")                                                      \
+  X(NORM, "mtx_norm")                                                        \
+  X(INVERSE, "mtx_inverse")                                                  \
+  X(SOLVE, "mtx_solve")                                                      \
+  X(RESIDUAL, "mtx_residual")                                                \
+  X(GAUSS_ELIMINATION, "mtx_gauss_elimination")                              \
+  X(EXP, "mtx_exp")                                                          \
+  X(TRANSPOSE, "mtx_transpose")                                              \
+  X(TRANSPOSE_TO, "mtx_transpose_to")                                        \
+  X(SWAP_ROWS, "mtx_swap_rows")                                              \
+  X(SWAP_COLS, "mtx_swap_cols")                                              \
+  X(SCALE_ROW, "mtx_scale_row")                                              \
+  X(ADD_ROWS, "mtx_add_rows")                                                \
+  X(ADD_SCALED_ROW, "mtx_add_scaled_row")                                    \
+  X(OTHER, "(other)")
+
+#define MTX_STATS_ENUM(id, name) MTX_OP_##id,
+typedef enum { MTX_STATS_OPS(MTX_STATS_ENUM) MTX_OP_COUNT } mtx_op_t;
+#undef MTX_STATS_ENUM
+
+// Totals for one operation. bytes and flops are nominal (operand sizes and
+// textbook operation counts), not measured traffic. Times and hardware
+// counts are inclusive and cover the calling thread only; pool workers are
+// not sampled.
+typedef struct {
+  uint64_t calls;
+  uint64_t bytes;
+  uint64_t flops;
+  uint64_t allocs;
+  uint64_t alloc_bytes;
+  uint64_t nanos;
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t cache_misses;
+} mtx_op_stats_t;
+
+typedef struct {
+  mtx_op_stats_t op[MTX_OP_COUNT];
+} mtx_stats_t;
+
+// Counting is compiled in only with -DMTX_ENABLE_STATS; otherwise the hooks
+// expand to nothing and snapshots stay zero. Calls made from inside another
+// instrumented call, and their allocations, are charged to the outermost
+// one. Allocations outside any instrumented call go to MTX_OP_OTHER.
+int mtx_stats_enabled(void);
+const char *mtx_stats_op_name(mtx_op_t op);
+void mtx_stats_snapshot(mtx_stats_t *s);
+void mtx_stats_reset(void);
+// Prints the operations with at least one call or allocation.
+void mtx_stats_print(const mtx_stats_t *s);
+
+// Samples cycles, instructions and cache misses through perf_event on
+// Linux. Returns -1 when the counters cannot be opened (other platforms,
+// perf_event_paranoid, missing PMU); counting then continues without them.
+int mtx_stats_set_hw(int enable);
+
+#ifdef MTX_ENABLE_STATS
+typedef struct {
+  int op;
+  uint64_t start;
+  uint64_t hw[3];
+} mtx_stats_frame_t;
+
+mtx_stats_frame_t mtx_stats_enter(mtx_op_t op);
+void mtx_stats_leave(mtx_stats_frame_t *f);
+void mtx_stats_work(const mtx_stats_frame_t *f, uint64_t bytes,
+                    uint64_t flops);
+void mtx_stats_alloc(size_t bytes);
+
+// Opens a frame closed on every return path of the enclosing block.
+#define MTX_STATS_OP(id)                                                     \
+  mtx_stats_frame_t mtx_stats_frame                                          \
+      __attribute__((cleanup(mtx_stats_leave))) = mtx_stats_enter(MTX_OP_##id)
+#define MTX_STATS_WORK(bytes, flops)                                         \
+  mtx_stats_work(&mtx_stats_frame, (uint64_t)(bytes), (uint64_t)(flops))
+#define MTX_STATS_ALLOC(bytes) mtx_stats_alloc(bytes)
+#else
+#define MTX_STATS_OP(id) ((void)0)
+#define MTX_STATS_WORK(bytes, flops) ((void)0)
+#define MTX_STATS_ALLOC(bytes) ((void)0)
+#endif
+
+#endif // MATRIX_STATS_H
@@ -0,0 +1,170 @@
+#include "matrix_strassen.h"
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "matrix_gemm.h"
+
+static size_t strassen_cutoff = 0;
+
+void mtx_strassen_set_cutoff(size_t cutoff) { strassen_cutoff = cutoff; }
+
+size_t mtx_strassen_get_cutoff(void) { return strassen_cutoff; }
+
+static size_t active_cutoff(void) {
+  return strassen_cutoff ? strassen_cutoff : MTX_STRASSEN_DEFAULT_CUTOFF;
+}
+
+static int splits(size_t m, size_t n, size_t k, size_t cutoff) {
+  return m >= cutoff && n >= cutoff && k >= cutoff;
+}
+
+size_t mtx_strassen_workspace_size(size_t m, size_t n, size_t k) {
+  size_t cutoff = active_cutoff(), bytes = 0;
+  while (splits(m, n, k, cutoff)) {
+    m /= 2;
+    n /= 2;
+    k /= 2;
+    bytes += mtx_workspace_bytes(m * k * sizeof(double)) +
+             mtx_workspace_bytes(k * n * sizeof(double)) +
+             mtx_workspace_bytes(m * n * sizeof(double));
+  }
+  return bytes;
+}
+
+// Quadrant (qi, qj) of the leading even-sized part of m.
+static matrix_t quad(const matrix_t *m, size_t qi, size_t qj) {
+  size_t rows = m->rows / 2, cols = m->cols / 2;
+  matrix_t q;
+  mtx_view_data(&q, m->data + qi * rows * m->ld + qj * cols, rows, cols,
+                m->ld);
+  return q;
+}
+
+// dst = x + s * y in one pass; x may be dst.
+static int combine(matrix_t *dst, const matrix_t *x, double s,
+                   const matrix_t *y) {
+  mtx_expr_t e;
+  mtx_expr_assign(&e, dst);
+  mtx_expr_add(&e, x);
+  mtx_expr_add_scaled(&e, y, s);
+  return mtx_expr_eval(&e);
+}
+
+static int winograd(const matrix_t *a, const matrix_t *b, matrix_t *c,
+                    size_t cutoff, mtx_workspace_t *ws);
+
+// c += a * b, through z when the product recurses.
+static int mul_add(const matrix_t *a, const matrix_t *b, matrix_t *c,
+                   matrix_t *z, double s, size_t cutoff, mtx_workspace_t *ws) {
+  if (!splits(a->rows, b->cols, a->cols, cutoff))
+    return mtx_gemm(a->rows, b->cols, a->cols, s, a->data, a->ld, b->data,
+                    b->ld, 1.0, c->data, c->ld);
+  if (winograd(a, b, z, cutoff, ws) != 0)
+    return -1;
+  return combine(c, c, s, z);
+}
+
+// One level on the even part, with the schedule of Douglas et al. that
+// needs only three quadrant temporaries: X for A sums, Y for B sums and Z
+// for products that cannot go straight into C.
+static int winograd_level(const matrix_t *a, const matrix_t *b, matrix_t *c,
+                          size_t cutoff, mtx_workspace_t *ws) {
+  matrix_t a11 = quad(a, 0, 0), a12 = quad(a, 0, 1);
+  matrix_t a21 = quad(a, 1, 0), a22 = quad(a, 1, 1);
+  matrix_t b11 = quad(b, 0, 0), b12 = quad(b, 0, 1);
+  matrix_t b21 = quad(b, 1, 0), b22 = quad(b, 1, 1);
+  matrix_t c11 = quad(c, 0, 0), c12 = quad(c, 0, 1);
+  matrix_t c21 = quad(c, 1, 0), c22 = quad(c, 1, 1);
+
+  matrix_t x, y, z;
+  if (mtx_workspace_matrix(ws, a11.rows, a11.cols, &x) != 0 ||
+      mtx_workspace_matrix(ws, b11.rows, b11.cols, &y) != 0 ||
+      mtx_workspace_matrix(ws, c11.rows, c11.cols, &z) != 0)
+    return -1;
+
+  // C21 = P7 = S3 T3, C22 = P5 = S1 T1, C12 = P6 = S2 T2, C11 = P1.
+  if (combine(&x, &a11, -1.0, &a21) != 0 ||
+      combine(&y, &b22, -1.0, &b12) != 0 ||
+      winograd(&x, &y, &c21, cutoff, ws) != 0 ||
+      combine(&x, &a21, 1.0, &a22) != 0 ||
+      combine(&y, &b12, -1.0, &b11) != 0 ||
+      winograd(&x, &y, &c22, cutoff, ws) != 0 ||
+      combine(&x, &x, -1.0, &a11) != 0 ||
+      combine(&y, &b22, -1.0, &y) != 0 ||
+      winograd(&x, &y, &c12, cutoff, ws) != 0 ||
+      winograd(&a11, &b11, &c11, cutoff, ws) != 0)
+    return -1;
+
+  // U2 = P1 + P6, U3 = U2 + P7, U4 = U2 + P5, C22 = U3 + P5.
+  if (combine(&c12, &c12, 1.0, &c11) != 0 ||
+      combine(&c21, &c21, 1.0, &c12) != 0 ||
+      combine(&c12, &c12, 1.0, &c22) != 0 ||
+      combine(&c22, &c22, 1.0, &c21) != 0)
+    return -1;
+
+  // C12 = U4 + S4 B22, C21 = U3 - A22 T4, C11 = P1 + A12 B21.
+  if (combine(&x, &a12, -1.0, &x) != 0 ||
+      mul_add(&x, &b22, &c12, &z, 1.0, cutoff, ws) != 0 ||
+      combine(&y, &y, -1.0, &b21) != 0 ||
+      mul_add(&a22, &y, &c21, &z, -1.0, cutoff, ws) != 0 ||
+      mul_add(&a12, &b21, &c11, &z, 1.0, cutoff, ws) != 0)
+    return -1;
+  return 0;
+}
+
+static int winograd(const matrix_t *a, const matrix_t *b, matrix_t *c,
+                    size_t cutoff, mtx_workspace_t *ws) {
+  size_t m = a->rows, k = a->cols, n = b->cols;
+  if (!splits(m, n, k, cutoff))
+    return mtx_gemm(m, n, k, 1.0, a->data, a->ld, b->data, b->ld, 0.0,
+                    c->data, c->ld);
+
+  size_t mark = mtx_workspace_mark(ws);
+  int rc = winograd_level(a, b, c, cutoff, ws);
+  mtx_workspace_release(ws, mark);
+  if (rc != 0)
+    return -1;
+
+  // Peeled last row, inner index and column of odd dimensions.
+  size_t me = m & ~(size_t)1, ke = k & ~(size_t)1, ne = n & ~(size_t)1;
+  if (ke < k && mtx_gemm(me, ne, 1, 1.0, a->data + ke, a->ld,
+                         b->data + ke * b->ld, b->ld, 1.0, c->data,
+                         c->ld) != 0)
+    return -1;
+  if (ne < n && mtx_gemm(me, 1, k, 1.0, a->data, a->ld, b->data + ne, b->ld,
+                         0.0, c->data + ne, c->ld) != 0)
+    return -1;
+  if (me < m && mtx_gemm(1, n, k, 1.0, a->data + me * a->ld, a->ld, b->data,
+                         b->ld, 0.0, c->data + me * c->ld, c->ld) != 0)
+    return -1;
+  return 0;
+}
+
+int mtx_strassen(size_t m, size_t n, size_t k, const double *a, size_t lda,
+                 const double *b, size_t ldb, double *c, size_t ldc) {
+  return mtx_strassen_ws(m, n, k, a, lda, b, ldb, c, ldc, NULL);
+}
+
+int mtx_strassen_ws(size_t m, size_t n, size_t k, const double *a,
+                    size_t lda, const double *b, size_t ldb, double *c,
+                    size_t ldc, mtx_workspace_t *ws) {
+  size_t cutoff = active_cutoff();
+  if (m == 0 || n == 0 || k == 0 || !splits(m, n, k, cutoff))
+    return mtx_gemm(m, n, k, 1.0, a, lda, b, ldb, 0.0, c, ldc);
+  if (!a || !b || !c)
+    return -1;
+
+  matrix_t av, bv, cv;
+  mtx_view_data(&av, (double *)a, m, k, lda);
+  mtx_view_data(&bv, (double *)b, k, n, ldb);
+  mtx_view_data(&cv, c, m, n, ldc);
+  if (mtx_overlaps(&cv, &av) || mtx_overlaps(&cv, &bv))
+    return -1;
+
+  mtx_scratch_t scratch;
+  if (mtx_scratch_begin(&scratch, ws, mtx_strassen_workspace_size(m, n, k)) !=
+      0)
+    return -1;
+  int rc = winograd(&av, &bv, &cv, cutoff, scratch.ws);
+  mtx_scratch_end(&scratch);
+  return rc;
+}
@@ -0,0 +1,42 @@
+#ifndef MATRIX_STRASSEN_H
+#define MATRIX_STRASSEN_H
+
+#include "matrix_workspace.h"
+#include <stddef.h>
+
+// Products whose three dimensions all reach the cutoff split into seven
+// half-size products; smaller ones go to mtx_gemm.
+#define MTX_STRASSEN_DEFAULT_CUTOFF 1024
+
+// Opt-in routing of mtx_mul and mtx_mul3 through mtx_strassen: off (0) by
+// default. Any nonzero cutoff enables it. Callers that need the
+// conventional error bound should leave it at 0. Must not be changed while
+// other threads are multiplying.
+void mtx_strassen_set_cutoff(size_t cutoff);
+size_t mtx_strassen_get_cutoff(void);
+
+// C = A * B for row-major A (m x k) and B (k x n) by Strassen-Winograd
+// recursion (7 products, 15 additions per level). Odd dimensions peel one
+// row or column, fixed up with GEMM. Sub-products and additions each use
+// the whole pool. C must not alias A or B. The cutoff is the configured
+// one, or MTX_STRASSEN_DEFAULT_CUTOFF while routing is off.
+//
+// Error: with n0 the leaf size and u the unit roundoff, the Winograd
+// variant satisfies (Higham, Accuracy and Stability of Numerical
+// Algorithms, 2nd ed., Thm. 23.3)
+//   max|C - fl(C)| <= [(n/n0)^log2(18) (n0^2 + 6 n0) - 6n] u max|A| max|B|
+// to first order. The conventional product has n^2 u max|A| max|B|.
+// Each level multiplies the bound by about 4.5 rather than 4. The error
+// is normwise only, so small entries of C can lose all relative accuracy.
+int mtx_strassen(size_t m, size_t n, size_t k, const double *a, size_t lda,
+                 const double *b, size_t ldb, double *c, size_t ldc);
+int mtx_strassen_ws(size_t m, size_t n, size_t k, const double *a,
+                    size_t lda, const double *b, size_t ldb, double *c,
+                    size_t ldc, mtx_workspace_t *ws);
+
+// Bytes of workspace mtx_strassen needs for these dimensions at the
+// current cutoff: three quadrant temporaries per level, about
+// (mk + kn + mn) / 3 doubles in total.
+size_t mtx_strassen_workspace_size(size_t m, size_t n, size_t k);
+
+#endif // MATRIX_STRASSEN_H
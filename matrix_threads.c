@@ -0,0 +1,192 @@
+#include "matrix_threads.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+  mtx_range_fn fn;
+  void *ctx;
+  size_t count;
+  size_t chunks;
+} pool_job_t;
+
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cv = PTHREAD_COND_INITIALIZER;
+
+// Written only under region_lock, but read atomically without it: chunk
+// bodies ask for the thread count while their launcher holds region_lock.
+static size_t num_threads;
+static pthread_t *workers;
+static size_t num_workers;
+static unsigned long generation;
+static unsigned long start_generation;
+static size_t pending;
+static int stopping;
+static pool_job_t job;
+
+static __thread int in_parallel_region;
+
+static size_t default_num_threads(void) {
+  const char *env = getenv(MTX_THREADS_ENV);
+  if (env && *env) {
+    char *end = NULL;
+    unsigned long n = strtoul(env, &end, 10);
+    if (end != env && n > 0)
+      return n > MTX_MAX_THREADS ? MTX_MAX_THREADS : (size_t)n;
+  }
+
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpu < 1)
+    return 1;
+  return (size_t)ncpu > MTX_MAX_THREADS ? MTX_MAX_THREADS : (size_t)ncpu;
+}
+
+static void run_chunk(const pool_job_t *j, size_t c) {
+  size_t begin = j->count * c / j->chunks;
+  size_t end = j->count * (c + 1) / j->chunks;
+  if (begin < end)
+    j->fn(j->ctx, begin, end);
+}
+
+static void *worker_main(void *arg) {
+  size_t id = (size_t)arg;
+  unsigned long seen = start_generation;
+
+  in_parallel_region = 1;
+  pthread_mutex_lock(&pool_lock);
+  for (;;) {
+    while (generation == seen && !stopping)
+      pthread_cond_wait(&job_cv, &pool_lock);
+    if (stopping)
+      break;
+    seen = generation;
+    pool_job_t local = job;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (id < local.chunks)
+      run_chunk(&local, id);
+
+    pthread_mutex_lock(&pool_lock);
+    if (--pending == 0)
+      pthread_cond_signal(&done_cv);
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return NULL;
+}
+
+// Called with region_lock held.
+static int pool_start(void) {
+  size_t n = mtx_get_num_threads();
+  if (workers || n <= 1)
+    return 0;
+
+  workers = (pthread_t *)malloc((n - 1) * sizeof(pthread_t));
+  if (!workers)
+    return -1;
+
+  pthread_mutex_lock(&pool_lock);
+  stopping = 0;
+  start_generation = generation;
+  pthread_mutex_unlock(&pool_lock);
+
+  num_workers = 0;
+  for (size_t i = 1; i < n; ++i) {
+    if (pthread_create(&workers[num_workers], NULL, worker_main,
+                       (void *)i) != 0)
+      break;
+    num_workers++;
+  }
+  return 0;
+}
+
+// Called with region_lock held.
+static void pool_stop(void) {
+  if (!workers)
+    return;
+
+  pthread_mutex_lock(&pool_lock);
+  stopping = 1;
+  pthread_cond_broadcast(&job_cv);
+  pthread_mutex_unlock(&pool_lock);
+
+  for (size_t i = 0; i < num_workers; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+  workers = NULL;
+  num_workers = 0;
+}
+
+int mtx_set_num_threads(size_t n) {
+  if (n > MTX_MAX_THREADS)
+    return -1;
+
+  pthread_mutex_lock(&region_lock);
+  pool_stop();
+  __atomic_store_n(&num_threads, n ? n : default_num_threads(),
+                   __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&region_lock);
+  return 0;
+}
+
+size_t mtx_get_num_threads(void) {
+  size_t n = __atomic_load_n(&num_threads, __ATOMIC_ACQUIRE);
+  if (n != 0)
+    return n;
+
+  // First use: racing callers agree on whichever default lands first.
+  size_t expected = 0;
+  n = default_num_threads();
+  if (!__atomic_compare_exchange_n(&num_threads, &expected, n, 0,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    n = expected;
+  return n;
+}
+
+void mtx_threads_shutdown(void) {
+  pthread_mutex_lock(&region_lock);
+  pool_stop();
+  pthread_mutex_unlock(&region_lock);
+}
+
+void mtx_parallel_for(size_t count, size_t grain, mtx_range_fn fn, void *ctx) {
+  if (count == 0 || !fn)
+    return;
+  if (grain == 0)
+    grain = 1;
+
+  if (in_parallel_region || pthread_mutex_trylock(&region_lock) != 0) {
+    fn(ctx, 0, count);
+    return;
+  }
+
+  size_t chunks = count / grain, threads = mtx_get_num_threads();
+  if (chunks > threads)
+    chunks = threads;
+  if (chunks <= 1 || pool_start() != 0 || num_workers + 1 < chunks) {
+    pthread_mutex_unlock(&region_lock);
+    fn(ctx, 0, count);
+    return;
+  }
+
+  pool_job_t local = {fn, ctx, count, chunks};
+  pthread_mutex_lock(&pool_lock);
+  job = local;
+  pending = num_workers;
+  generation++;
+  pthread_cond_broadcast(&job_cv);
+  pthread_mutex_unlock(&pool_lock);
+
+  in_parallel_region = 1;
+  run_chunk(&local, 0);
+  in_parallel_region = 0;
+
+  pthread_mutex_lock(&pool_lock);
+  while (pending > 0)
+    pthread_cond_wait(&done_cv, &pool_lock);
+  pthread_mutex_unlock(&pool_lock);
+
+  pthread_mutex_unlock(&region_lock);
+}
@@ -0,0 +1,24 @@
+#ifndef MATRIX_THREADS_H
+#define MATRIX_THREADS_H
+
+#include <stddef.h>
+
+#define MTX_THREADS_ENV "MTX_NUM_THREADS"
+#define MTX_MAX_THREADS 256
+#define MTX_PARALLEL_MIN_ELEMENTS (1 << 16)
+
+typedef void (*mtx_range_fn)(void *ctx, size_t begin, size_t end);
+
+// Sets the worker count of the library pool; 0 restores the default taken
+// from MTX_NUM_THREADS or the number of online CPUs. Must not be called while
+// other threads are running matrix operations.
+int mtx_set_num_threads(size_t n);
+size_t mtx_get_num_threads(void);
+void mtx_threads_shutdown(void);
+
+// Splits [0, count) into at most one contiguous chunk per thread, each at
+// least `grain` long, and runs fn on every chunk. The split depends only on
+// count, grain and the thread count. Nested or concurrent calls run inline.
+void mtx_parallel_for(size_t count, size_t grain, mtx_range_fn fn, void *ctx);
+
+#endif // MATRIX_THREADS_H
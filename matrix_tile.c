@@ -0,0 +1,775 @@
+#include "matrix_tile.h"
+#include "matrix_chol.h"
+#include "matrix_gemm.h"
+#include "matrix_manipulations.h"
+#include "matrix_operations.h"
+#include "matrix_simd.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE_ALIGN_DOUBLES (MTX_ALIGN / sizeof(double))
+#define TILE_MIN_READERS 4
+
+struct mtx_tile_dep {
+  mtx_future_t *writer;
+  mtx_future_t **readers;
+  size_t nreaders, cap;
+};
+
+typedef struct {
+  mtx_tiled_t *t;
+  size_t i, j;
+} tile_ref_t;
+
+// Arguments of one tile kernel; the kernel frees it.
+typedef struct {
+  mtx_tiled_t *t, *b;
+  const matrix_t *m;
+  matrix_t *out;
+  matrix_t *x, *y, *z;
+  size_t k, j;
+  double alpha, beta;
+} tile_task_t;
+
+typedef struct {
+  double *buf;
+  size_t cap;
+} scratch_cache_t;
+
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+static void scratch_cache_free(void *p) {
+  scratch_cache_t *cache = (scratch_cache_t *)p;
+  free(cache->buf);
+  free(cache);
+}
+
+static void scratch_key_init(void) {
+  pthread_key_create(&scratch_key, scratch_cache_free);
+}
+
+// Per-thread buffer for transposed tiles and gathered panels; it only
+// grows, so steady-state kernels never reach malloc.
+static double *scratch(size_t count) {
+  pthread_once(&scratch_once, scratch_key_init);
+  scratch_cache_t *cache = (scratch_cache_t *)pthread_getspecific(scratch_key);
+  if (!cache) {
+    cache = (scratch_cache_t *)calloc(1, sizeof(scratch_cache_t));
+    if (!cache || pthread_setspecific(scratch_key, cache) != 0) {
+      free(cache);
+      return NULL;
+    }
+  }
+
+  if (cache->cap < count) {
+    double *buf = mtx_alloc_buffer(count, 1);
+    if (!buf)
+      return NULL;
+    free(cache->buf);
+    cache->buf = buf;
+    cache->cap = count;
+  }
+  return cache->buf;
+}
+
+mtx_tiled_t *mtx_tiled_alloc(size_t rows, size_t cols, size_t nb) {
+  if (rows == 0 || cols == 0)
+    return NULL;
+  if (nb == 0)
+    nb = MTX_TILE_DEFAULT;
+  size_t mt = rows / nb + (rows % nb != 0);
+  size_t nt = cols / nb + (cols % nb != 0);
+  // The tile count and the tile size must not wrap; the buffer size itself
+  // is checked by mtx_alloc_buffer.
+  if (mt > SIZE_MAX / nt || nb > SIZE_MAX / sizeof(double) / nb)
+    return NULL;
+
+  mtx_tiled_t *t = (mtx_tiled_t *)calloc(1, sizeof(mtx_tiled_t));
+  if (!t)
+    return NULL;
+  t->rows = rows;
+  t->cols = cols;
+  t->nb = nb;
+  t->mt = mt;
+  t->nt = nt;
+
+  size_t count = t->mt * t->nt;
+  size_t stride = (nb * nb + TILE_ALIGN_DOUBLES - 1) / TILE_ALIGN_DOUBLES *
+                  TILE_ALIGN_DOUBLES;
+  t->data = mtx_alloc_buffer(count, stride);
+  t->tiles = (matrix_t *)calloc(count, sizeof(matrix_t));
+  t->piv = (size_t *)calloc(rows, sizeof(size_t));
+  t->deps = (struct mtx_tile_dep *)calloc(count, sizeof(struct mtx_tile_dep));
+  if (!t->data || !t->tiles || !t->piv || !t->deps) {
+    mtx_tiled_free(t);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < t->mt; ++i) {
+    for (size_t j = 0; j < t->nt; ++j) {
+      size_t r = rows - i * nb < nb ? rows - i * nb : nb;
+      size_t c = cols - j * nb < nb ? cols - j * nb : nb;
+      mtx_view_data(&t->tiles[i * t->nt + j],
+                    t->data + (i * t->nt + j) * stride, r, c, nb);
+    }
+  }
+  return t;
+}
+
+void mtx_tiled_free(mtx_tiled_t *t) {
+  if (!t)
+    return;
+  if (t->deps) {
+    for (size_t d = 0; d < t->mt * t->nt; ++d) {
+      mtx_future_release(t->deps[d].writer);
+      for (size_t r = 0; r < t->deps[d].nreaders; ++r) {
+        mtx_future_release(t->deps[d].readers[r]);
+      }
+      free(t->deps[d].readers);
+    }
+  }
+  free(t->deps);
+  free(t->piv);
+  free(t->tiles);
+  free(t->data);
+  free(t);
+}
+
+matrix_t *mtx_tiled_tile(mtx_tiled_t *t, size_t i, size_t j) {
+  if (!t || i >= t->mt || j >= t->nt)
+    return NULL;
+  return &t->tiles[i * t->nt + j];
+}
+
+static tile_ref_t ref(mtx_tiled_t *t, size_t i, size_t j) {
+  tile_ref_t r = {t, i, j};
+  return r;
+}
+
+static struct mtx_tile_dep *dep_of(tile_ref_t r) {
+  return &r.t->deps[r.i * r.t->nt + r.j];
+}
+
+// Room for one more reader, dropping readers that have finished first.
+static int reserve_reader(struct mtx_tile_dep *d) {
+  if (d->nreaders < d->cap)
+    return 0;
+
+  size_t kept = 0;
+  for (size_t r = 0; r < d->nreaders; ++r) {
+    if (mtx_future_poll(d->readers[r]))
+      mtx_future_release(d->readers[r]);
+    else
+      d->readers[kept++] = d->readers[r];
+  }
+  d->nreaders = kept;
+  if (kept < d->cap)
+    return 0;
+
+  size_t cap = d->cap ? 2 * d->cap : TILE_MIN_READERS;
+  mtx_future_t **readers =
+      (mtx_future_t **)realloc(d->readers, cap * sizeof(mtx_future_t *));
+  if (!readers)
+    return -1;
+  d->readers = readers;
+  d->cap = cap;
+  return 0;
+}
+
+// 1 when reads[r] repeats an earlier entry, as in A * A on the diagonal;
+// each tile is reserved and recorded once.
+static int repeated(const tile_ref_t *reads, size_t r) {
+  for (size_t p = 0; p < r; ++p) {
+    if (reads[p].t == reads[r].t && reads[p].i == reads[r].i &&
+        reads[p].j == reads[r].j)
+      return 1;
+  }
+  return 0;
+}
+
+// Queues fn(task) after the last writer of every tile it reads, and after
+// the last writer and all later readers of every tile it writes; then
+// records it as a reader or the writer of those tiles.
+static int submit(mtx_queue_t *q, mtx_task_fn fn, tile_task_t *task,
+                  const tile_ref_t *reads, size_t nreads,
+                  const tile_ref_t *writes, size_t nwrites) {
+  if (!task)
+    return -1;
+
+  size_t count = nreads;
+  for (size_t r = 0; r < nreads; ++r) {
+    if (!repeated(reads, r) && reserve_reader(dep_of(reads[r])) != 0) {
+      free(task);
+      return -1;
+    }
+  }
+  for (size_t w = 0; w < nwrites; ++w) {
+    count += 1 + dep_of(writes[w])->nreaders;
+  }
+
+  mtx_future_t **after =
+      (mtx_future_t **)calloc(count ? count : 1, sizeof(mtx_future_t *));
+  if (!after) {
+    free(task);
+    return -1;
+  }
+  size_t n = 0;
+  for (size_t r = 0; r < nreads; ++r) {
+    after[n++] = dep_of(reads[r])->writer;
+  }
+  for (size_t w = 0; w < nwrites; ++w) {
+    struct mtx_tile_dep *d = dep_of(writes[w]);
+    after[n++] = d->writer;
+    for (size_t r = 0; r < d->nreaders; ++r) {
+      after[n++] = d->readers[r];
+    }
+  }
+
+  mtx_future_t *f = mtx_async_after(q, fn, task, after, n);
+  free(after);
+  if (!f) {
+    free(task);
+    return -1;
+  }
+
+  for (size_t r = 0; r < nreads; ++r) {
+    struct mtx_tile_dep *d = dep_of(reads[r]);
+    if (repeated(reads, r))
+      continue;
+    mtx_future_retain(f);
+    d->readers[d->nreaders++] = f;
+  }
+  for (size_t w = 0; w < nwrites; ++w) {
+    struct mtx_tile_dep *d = dep_of(writes[w]);
+    mtx_future_release(d->writer);
+    for (size_t r = 0; r < d->nreaders; ++r) {
+      mtx_future_release(d->readers[r]);
+    }
+    d->nreaders = 0;
+    mtx_future_retain(f);
+    d->writer = f;
+  }
+  mtx_future_release(f);
+  return 0;
+}
+
+static tile_task_t *new_task(void) {
+  return (tile_task_t *)calloc(1, sizeof(tile_task_t));
+}
+
+// Kernels. Tiles are packed with ld = nb, so rows are contiguous.
+
+static void row_update(double *dst, const double *src, double alpha,
+                       size_t w, const mtx_simd_ops_t *ops) {
+  ops->axpy(dst, src, -alpha, w);
+}
+
+static void swap_rows(double *a, double *b, size_t w) {
+  for (size_t j = 0; j < w; ++j) {
+    double t = a[j];
+    a[j] = b[j];
+    b[j] = t;
+  }
+}
+
+static double *tile_row(mtx_tiled_t *t, size_t r, size_t j) {
+  return mtx_row(mtx_tiled_tile(t, r / t->nb, j), r % t->nb);
+}
+
+// Applies the row swaps recorded for global rows [r0, r1) to tile column j.
+static void swap_column(mtx_tiled_t *t, size_t r0, size_t r1, size_t j) {
+  size_t w = mtx_tiled_tile(t, 0, j)->cols;
+  for (size_t r = r0; r < r1; ++r) {
+    if (t->piv[r] != r)
+      swap_rows(tile_row(t, r, j), tile_row(t, t->piv[r], j), w);
+  }
+}
+
+// z = L^-1 * z for the unit lower triangle of x.
+static void solve_unit_lower(const matrix_t *x, matrix_t *z) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  for (size_t r = 1; r < z->rows; ++r) {
+    const double *l = mtx_crow(x, r);
+    for (size_t p = 0; p < r; ++p) {
+      if (l[p] != 0.0)
+        row_update(mtx_row(z, r), mtx_crow(z, p), l[p], z->cols, ops);
+    }
+  }
+}
+
+// z = U^-1 * z for the upper triangle of x.
+static void solve_upper(const matrix_t *x, matrix_t *z) {
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  for (size_t r = z->rows; r-- > 0;) {
+    const double *u = mtx_crow(x, r);
+    double *zr = mtx_row(z, r);
+    for (size_t p = r + 1; p < z->rows; ++p) {
+      if (u[p] != 0.0)
+        row_update(zr, mtx_crow(z, p), u[p], z->cols, ops);
+    }
+    ops->scal(zr, 1.0 / u[r], z->cols);
+  }
+}
+
+static int run_pack(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  matrix_t *z = task->z;
+  size_t r0 = task->k * task->t->nb, c0 = task->j * task->t->nb;
+  for (size_t r = 0; r < z->rows; ++r) {
+    memcpy(mtx_row(z, r), mtx_crow(task->m, r0 + r) + c0,
+           z->cols * sizeof(double));
+  }
+  free(task);
+  return 0;
+}
+
+static int run_unpack(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  const matrix_t *x = task->x;
+  size_t r0 = task->k * task->t->nb, c0 = task->j * task->t->nb;
+  for (size_t r = 0; r < x->rows; ++r) {
+    memcpy(mtx_row(task->out, r0 + r) + c0, mtx_crow(x, r),
+           x->cols * sizeof(double));
+  }
+  free(task);
+  return 0;
+}
+
+static int run_identity(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  mtx_set_zero(task->z);
+  if (task->k == task->j) {
+    for (size_t r = 0; r < task->z->rows && r < task->z->cols; ++r) {
+      *mtx_at(task->z, r, r) = 1.0;
+    }
+  }
+  free(task);
+  return 0;
+}
+
+// z = alpha * x * y + beta * z.
+static int run_gemm(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  const matrix_t *x = task->x, *y = task->y;
+  matrix_t *z = task->z;
+  int rc = mtx_gemm(z->rows, z->cols, x->cols, task->alpha, x->data, x->ld,
+                    y->data, y->ld, task->beta, z->data, z->ld);
+  free(task);
+  return rc;
+}
+
+// z -= x * y^T, through a transposed copy of y.
+static int run_gemm_nt(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  const matrix_t *x = task->x, *y = task->y;
+  matrix_t *z = task->z, yt;
+  double *buf = scratch(y->rows * y->cols);
+  int rc = -1;
+  if (buf && mtx_view_data(&yt, buf, y->cols, y->rows, y->rows) == 0 &&
+      mtx_transpose_to(y, &yt) == 0)
+    rc = mtx_gemm(z->rows, z->cols, x->cols, -1.0, x->data, x->ld, yt.data,
+                  yt.ld, 1.0, z->data, z->ld);
+  free(task);
+  return rc;
+}
+
+static int run_potrf(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  int rc = mtx_chol_decompose(task->z, NULL);
+  free(task);
+  return rc;
+}
+
+// z = z * L^-T for the lower triangle L of x, row by row against L^T as in
+// the blocked Cholesky panel.
+static int run_trsm_lt(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  const matrix_t *x = task->x;
+  matrix_t *z = task->z;
+  size_t kb = x->rows;
+  double *lt = scratch(kb * kb);
+  if (!lt) {
+    free(task);
+    return -1;
+  }
+  for (size_t i = 0; i < kb; ++i) {
+    for (size_t j = 0; j <= i; ++j) {
+      lt[j * kb + i] = *mtx_cat(x, i, j);
+    }
+  }
+  for (size_t r = 0; r < z->rows; ++r) {
+    double *zr = mtx_row(z, r);
+    for (size_t j = 0; j < kb; ++j) {
+      zr[j] /= lt[j * kb + j];
+      row_update(zr + j + 1, lt + j * kb + j + 1, zr[j], kb - j - 1, ops);
+    }
+  }
+  free(task);
+  return 0;
+}
+
+// Partial-pivoting LU of tile column k from its diagonal tile down, on a
+// gathered copy so the pivot search and row swaps stay in one buffer.
+static int run_panel(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  const mtx_simd_ops_t *ops = mtx_simd_ops();
+  mtx_tiled_t *t = task->t;
+  size_t k = task->k, r0 = k * t->nb, rows = t->rows - r0;
+  size_t w = mtx_tiled_tile(t, k, k)->cols;
+  double *p = scratch(rows * w);
+  if (!p) {
+    free(task);
+    return -1;
+  }
+  for (size_t r = 0; r < rows; ++r) {
+    memcpy(p + r * w, tile_row(t, r0 + r, k), w * sizeof(double));
+  }
+
+  int rc = 0;
+  for (size_t c = 0; c < w; ++c) {
+    size_t best = c;
+    double max_val = fabs(p[c * w + c]);
+    for (size_t r = c + 1; r < rows; ++r) {
+      double val = fabs(p[r * w + c]);
+      if (val > max_val) {
+        max_val = val;
+        best = r;
+      }
+    }
+    if (max_val < EPSILON) {
+      for (; c < w; ++c) {
+        t->piv[r0 + c] = r0 + c;
+      }
+      rc = -1;
+      break;
+    }
+
+    t->piv[r0 + c] = r0 + best;
+    if (best != c)
+      swap_rows(p + c * w, p + best * w, w);
+    const double *prow = p + c * w;
+    for (size_t r = c + 1; r < rows; ++r) {
+      double *row = p + r * w;
+      double l = row[c] / prow[c];
+      row[c] = l;
+      row_update(row + c + 1, prow + c + 1, l, w - c - 1, ops);
+    }
+  }
+
+  for (size_t r = 0; r < rows; ++r) {
+    memcpy(tile_row(t, r0 + r, k), p + r * w, w * sizeof(double));
+  }
+  free(task);
+  return rc;
+}
+
+// Panel k's swaps on tile column j, then U_kj = L_kk^-1 * A_kj right of
+// the panel.
+static int run_swap(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  mtx_tiled_t *t = task->t;
+  size_t k = task->k, r0 = k * t->nb;
+  swap_column(t, r0, r0 + mtx_tiled_tile(t, k, k)->rows, task->j);
+  if (task->j > k)
+    solve_unit_lower(mtx_tiled_tile(t, k, k), mtx_tiled_tile(t, k, task->j));
+  free(task);
+  return 0;
+}
+
+// All of A's row swaps on tile column j of b.
+static int run_permute(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  mtx_tiled_t *a = task->t, *b = task->b;
+  for (size_t r = 0; r < a->rows; ++r) {
+    if (a->piv[r] != r)
+      swap_rows(tile_row(b, r, task->j), tile_row(b, a->piv[r], task->j),
+                mtx_tiled_tile(b, 0, task->j)->cols);
+  }
+  free(task);
+  return 0;
+}
+
+static int run_trsm_lower(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  solve_unit_lower(task->x, task->z);
+  free(task);
+  return 0;
+}
+
+static int run_trsm_upper(void *ctx) {
+  tile_task_t *task = (tile_task_t *)ctx;
+  solve_upper(task->x, task->z);
+  free(task);
+  return 0;
+}
+
+static tile_task_t *tile_task(matrix_t *x, matrix_t *y, matrix_t *z,
+                              double alpha, double beta) {
+  tile_task_t *task = new_task();
+  if (task) {
+    task->x = x;
+    task->y = y;
+    task->z = z;
+    task->alpha = alpha;
+    task->beta = beta;
+  }
+  return task;
+}
+
+int mtx_tiled_pack(mtx_queue_t *q, mtx_tiled_t *t, const matrix_t *m) {
+  if (!q || !t || !m || !m->data || m->rows != t->rows || m->cols != t->cols)
+    return -1;
+
+  for (size_t i = 0; i < t->mt; ++i) {
+    for (size_t j = 0; j < t->nt; ++j) {
+      tile_task_t *task = tile_task(NULL, NULL, mtx_tiled_tile(t, i, j), 0, 0);
+      tile_ref_t w = ref(t, i, j);
+      if (task) {
+        task->t = t;
+        task->m = m;
+        task->k = i;
+        task->j = j;
+      }
+      if (submit(q, run_pack, task, NULL, 0, &w, 1) != 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+int mtx_tiled_unpack(mtx_queue_t *q, mtx_tiled_t *t, matrix_t *m) {
+  if (!q || !t || !m || !m->data || m->rows != t->rows || m->cols != t->cols)
+    return -1;
+
+  for (size_t i = 0; i < t->mt; ++i) {
+    for (size_t j = 0; j < t->nt; ++j) {
+      tile_task_t *task = tile_task(mtx_tiled_tile(t, i, j), NULL, NULL, 0, 0);
+      tile_ref_t r = ref(t, i, j);
+      if (task) {
+        task->t = t;
+        task->out = m;
+        task->k = i;
+        task->j = j;
+      }
+      if (submit(q, run_unpack, task, &r, 1, NULL, 0) != 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+int mtx_tiled_gemm(mtx_queue_t *q, double alpha, mtx_tiled_t *a,
+                   mtx_tiled_t *b, double beta, mtx_tiled_t *c) {
+  if (!q || !a || !b || !c || a == c || b == c)
+    return -1;
+  if (a->cols != b->rows || c->rows != a->rows || c->cols != b->cols)
+    return -1;
+  if (a->nb != b->nb || a->nb != c->nb)
+    return -1;
+
+  // Each C tile accumulates its k products in order, so the result does not
+  // depend on scheduling.
+  for (size_t i = 0; i < c->mt; ++i) {
+    for (size_t j = 0; j < c->nt; ++j) {
+      for (size_t k = 0; k < a->nt; ++k) {
+        tile_ref_t reads[2] = {ref(a, i, k), ref(b, k, j)};
+        tile_ref_t w = ref(c, i, j);
+        tile_task_t *task =
+            tile_task(mtx_tiled_tile(a, i, k), mtx_tiled_tile(b, k, j),
+                      mtx_tiled_tile(c, i, j), alpha, k == 0 ? beta : 1.0);
+        if (submit(q, run_gemm, task, reads, 2, &w, 1) != 0)
+          return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+int mtx_tiled_chol(mtx_queue_t *q, mtx_tiled_t *a) {
+  if (!q || !a || a->rows != a->cols)
+    return -1;
+
+  size_t mt = a->mt;
+  for (size_t k = 0; k < mt; ++k) {
+    tile_ref_t kk = ref(a, k, k);
+    if (submit(q, run_potrf, tile_task(NULL, NULL, mtx_tiled_tile(a, k, k), 0,
+                                       0),
+               NULL, 0, &kk, 1) != 0)
+      return -1;
+
+    for (size_t i = k + 1; i < mt; ++i) {
+      tile_ref_t w = ref(a, i, k);
+      tile_task_t *task = tile_task(mtx_tiled_tile(a, k, k), NULL,
+                                    mtx_tiled_tile(a, i, k), 0, 0);
+      if (submit(q, run_trsm_lt, task, &kk, 1, &w, 1) != 0)
+        return -1;
+    }
+
+    // A_ij -= L_ik * L_jk^T on the lower tiles; i == j is the SYRK.
+    for (size_t i = k + 1; i < mt; ++i) {
+      for (size_t j = k + 1; j <= i; ++j) {
+        tile_ref_t reads[2] = {ref(a, i, k), ref(a, j, k)};
+        tile_ref_t w = ref(a, i, j);
+        tile_task_t *task =
+            tile_task(mtx_tiled_tile(a, i, k), mtx_tiled_tile(a, j, k),
+                      mtx_tiled_tile(a, i, j), 0, 0);
+        if (submit(q, run_gemm_nt, task, reads, i == j ? 1 : 2, &w, 1) != 0)
+          return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+// Tiles (k..mt-1, j) of a, the rows a panel-k swap can reach.
+static size_t column_below(mtx_tiled_t *a, size_t k, size_t j,
+                           tile_ref_t *out) {
+  size_t n = 0;
+  for (size_t i = k; i < a->mt; ++i) {
+    out[n++] = ref(a, i, j);
+  }
+  return n;
+}
+
+int mtx_tiled_lu(mtx_queue_t *q, mtx_tiled_t *a) {
+  if (!q || !a || a->rows != a->cols)
+    return -1;
+
+  size_t mt = a->mt;
+  tile_ref_t *col = (tile_ref_t *)malloc(mt * sizeof(tile_ref_t));
+  if (!col)
+    return -1;
+
+  int rc = 0;
+  for (size_t k = 0; k < mt && rc == 0; ++k) {
+    tile_ref_t kk = ref(a, k, k);
+    tile_task_t *task = new_task();
+    if (task) {
+      task->t = a;
+      task->k = k;
+    }
+    rc = submit(q, run_panel, task, NULL, 0, col, column_below(a, k, k, col));
+
+    // Swaps reach every other column: the left ones keep L in LAPACK form
+    // for the solves, the right ones also get their U tile.
+    for (size_t j = 0; j < mt && rc == 0; ++j) {
+      if (j == k)
+        continue;
+      task = new_task();
+      if (task) {
+        task->t = a;
+        task->k = k;
+        task->j = j;
+      }
+      rc = submit(q, run_swap, task, &kk, 1, col, column_below(a, k, j, col));
+    }
+
+    for (size_t i = k + 1; i < mt && rc == 0; ++i) {
+      for (size_t j = k + 1; j < mt && rc == 0; ++j) {
+        tile_ref_t reads[2] = {ref(a, i, k), ref(a, k, j)};
+        tile_ref_t w = ref(a, i, j);
+        task = tile_task(mtx_tiled_tile(a, i, k), mtx_tiled_tile(a, k, j),
+                         mtx_tiled_tile(a, i, j), -1.0, 1.0);
+        rc = submit(q, run_gemm, task, reads, 2, &w, 1);
+      }
+    }
+  }
+  free(col);
+  return rc;
+}
+
+int mtx_tiled_lu_solve(mtx_queue_t *q, mtx_tiled_t *a, mtx_tiled_t *b) {
+  if (!q || !a || !b || a == b || a->rows != a->cols || b->rows != a->rows ||
+      a->nb != b->nb)
+    return -1;
+
+  size_t mt = a->mt;
+  tile_ref_t *refs = (tile_ref_t *)malloc((2 * mt + 2) * sizeof(tile_ref_t));
+  if (!refs)
+    return -1;
+  tile_ref_t *col = refs + mt + 2;
+
+  // The diagonal tiles' last writers are the panels, which set the pivots.
+  int rc = 0;
+  for (size_t k = 0; k < mt; ++k) {
+    refs[2 + k] = ref(a, k, k);
+  }
+  for (size_t j = 0; j < b->nt && rc == 0; ++j) {
+    tile_task_t *task = new_task();
+    if (task) {
+      task->t = a;
+      task->b = b;
+      task->j = j;
+    }
+    rc = submit(q, run_permute, task, refs + 2, mt, col,
+                column_below(b, 0, j, col));
+  }
+
+  for (size_t k = 0; k < mt && rc == 0; ++k) {
+    for (size_t j = 0; j < b->nt && rc == 0; ++j) {
+      tile_ref_t w = ref(b, k, j), kk = ref(a, k, k);
+      rc = submit(q, run_trsm_lower,
+                  tile_task(mtx_tiled_tile(a, k, k), NULL,
+                            mtx_tiled_tile(b, k, j), 0, 0),
+                  &kk, 1, &w, 1);
+      for (size_t i = k + 1; i < mt && rc == 0; ++i) {
+        refs[0] = ref(a, i, k);
+        refs[1] = ref(b, k, j);
+        w = ref(b, i, j);
+        rc = submit(q, run_gemm,
+                    tile_task(mtx_tiled_tile(a, i, k), mtx_tiled_tile(b, k, j),
+                              mtx_tiled_tile(b, i, j), -1.0, 1.0),
+                    refs, 2, &w, 1);
+      }
+    }
+  }
+
+  for (size_t k = mt; k-- > 0 && rc == 0;) {
+    for (size_t j = 0; j < b->nt && rc == 0; ++j) {
+      tile_ref_t w = ref(b, k, j), kk = ref(a, k, k);
+      rc = submit(q, run_trsm_upper,
+                  tile_task(mtx_tiled_tile(a, k, k), NULL,
+                            mtx_tiled_tile(b, k, j), 0, 0),
+                  &kk, 1, &w, 1);
+      for (size_t i = 0; i < k && rc == 0; ++i) {
+        refs[0] = ref(a, i, k);
+        refs[1] = ref(b, k, j);
+        w = ref(b, i, j);
+        rc = submit(q, run_gemm,
+                    tile_task(mtx_tiled_tile(a, i, k), mtx_tiled_tile(b, k, j),
+                              mtx_tiled_tile(b, i, j), -1.0, 1.0),
+                    refs, 2, &w, 1);
+      }
+    }
+  }
+  free(refs);
+  return rc;
+}
+
+int mtx_tiled_inverse(mtx_queue_t *q, mtx_tiled_t *a, mtx_tiled_t *inv) {
+  if (!q || !a || !inv || a == inv || a->rows != a->cols ||
+      inv->rows != a->rows || inv->cols != a->cols || inv->nb != a->nb)
+    return -1;
+  if (mtx_tiled_lu(q, a) != 0)
+    return -1;
+
+  for (size_t i = 0; i < inv->mt; ++i) {
+    for (size_t j = 0; j < inv->nt; ++j) {
+      tile_ref_t w = ref(inv, i, j);
+      tile_task_t *task =
+          tile_task(NULL, NULL, mtx_tiled_tile(inv, i, j), 0, 0);
+      if (task) {
+        task->k = i;
+        task->j = j;
+      }
+      if (submit(q, run_identity, task, NULL, 0, &w, 1) != 0)
+        return -1;
+    }
+  }
+  return mtx_tiled_lu_solve(q, a, inv);
+}
@@ -0,0 +1,64 @@
+#ifndef MATRIX_TILE_H
+#define MATRIX_TILE_H
+
+#include "matrix.h"
+#include "matrix_async.h"
+
+#define MTX_TILE_DEFAULT 256
+
+struct mtx_tile_dep;
+
+// Matrix stored as an mt x nt grid of nb x nb tiles, each packed (ld = nb)
+// and aligned on its own. Tiles on the last row and column of the grid are
+// cut to the matrix size. Every tile remembers its last writer and the
+// readers since, so the operations below submit one job per tile kernel
+// and each job waits only for the tiles it touches.
+typedef struct {
+  size_t rows, cols, nb;
+  size_t mt, nt;
+  double *data;
+  matrix_t *tiles;
+  // Set by mtx_tiled_lu: global row r was swapped with piv[r].
+  size_t *piv;
+  struct mtx_tile_dep *deps;
+} mtx_tiled_t;
+
+// nb = 0 picks MTX_TILE_DEFAULT.
+mtx_tiled_t *mtx_tiled_alloc(size_t rows, size_t cols, size_t nb);
+// Only once every job touching t has completed (mtx_queue_wait_all).
+void mtx_tiled_free(mtx_tiled_t *t);
+matrix_t *mtx_tiled_tile(mtx_tiled_t *t, size_t i, size_t j);
+
+// The operations only submit jobs to q and return; they fail (-1) on bad
+// shapes or when a submission runs out of memory, which leaves part of the
+// graph queued. Kernel errors (a singular or indefinite pivot) surface in
+// mtx_queue_wait_all. Later operations on the same tiled matrices may be
+// submitted right away: a tile kernel of the next operation starts as soon
+// as the tiles it reads are final, not when the previous operation ends.
+// Operands of one call must share nb. A tiled matrix must be submitted to
+// from one thread at a time.
+
+// Copies between m and t. m is not tracked: leave it alone until the queue
+// has drained.
+int mtx_tiled_pack(mtx_queue_t *q, mtx_tiled_t *t, const matrix_t *m);
+int mtx_tiled_unpack(mtx_queue_t *q, mtx_tiled_t *t, matrix_t *m);
+
+// C = alpha * A * B + beta * C.
+int mtx_tiled_gemm(mtx_queue_t *q, double alpha, mtx_tiled_t *a,
+                   mtx_tiled_t *b, double beta, mtx_tiled_t *c);
+
+// A = L * L^T in place for symmetric positive definite A; only the lower
+// tiles are read or written.
+int mtx_tiled_chol(mtx_queue_t *q, mtx_tiled_t *a);
+
+// PA = LU in place with partial pivoting over whole columns, into a->piv.
+// Each panel is one job; the swaps and triangular solves on every other
+// tile column are one job per column, and the trailing update is one GEMM
+// per tile, so the next panel starts as soon as its column is updated.
+int mtx_tiled_lu(mtx_queue_t *q, mtx_tiled_t *a);
+// B = A^-1 * B with A holding mtx_tiled_lu factors.
+int mtx_tiled_lu_solve(mtx_queue_t *q, mtx_tiled_t *a, mtx_tiled_t *b);
+// inv = A^-1. A is overwritten with its LU factors.
+int mtx_tiled_inverse(mtx_queue_t *q, mtx_tiled_t *a, mtx_tiled_t *inv);
+
+#endif // MATRIX_TILE_H
@@ -0,0 +1,116 @@
+#include "matrix_workspace.h"
+#include "matrix_stats.h"
+#include <stdlib.h>
+
+static size_t align_up(size_t x) {
+  return (x + MTX_WORKSPACE_ALIGN - 1) / MTX_WORKSPACE_ALIGN *
+         MTX_WORKSPACE_ALIGN;
+}
+
+mtx_workspace_t *mtx_workspace_alloc(size_t bytes) {
+  MTX_STATS_ALLOC(sizeof(mtx_workspace_t));
+  mtx_workspace_t *ws = (mtx_workspace_t *)malloc(sizeof(mtx_workspace_t));
+  if (!ws)
+    return NULL;
+
+  ws->base = NULL;
+  ws->size = 0;
+  ws->used = 0;
+  ws->peak = 0;
+  if (mtx_workspace_reserve(ws, bytes) != 0) {
+    free(ws);
+    return NULL;
+  }
+  return ws;
+}
+
+void mtx_workspace_free(mtx_workspace_t *ws) {
+  if (ws) {
+    free(ws->base);
+    free(ws);
+  }
+}
+
+int mtx_workspace_reserve(mtx_workspace_t *ws, size_t bytes) {
+  if (!ws || ws->used != 0)
+    return -1;
+  if (bytes <= ws->size)
+    return 0;
+
+  size_t size = align_up(bytes);
+  MTX_STATS_ALLOC(size);
+  unsigned char *base =
+      (unsigned char *)aligned_alloc(MTX_WORKSPACE_ALIGN, size);
+  if (!base)
+    return -1;
+
+  free(ws->base);
+  ws->base = base;
+  ws->size = size;
+  return 0;
+}
+
+size_t mtx_workspace_bytes(size_t bytes) { return align_up(bytes); }
+
+void *mtx_workspace_push(mtx_workspace_t *ws, size_t bytes) {
+  if (!ws)
+    return NULL;
+
+  size_t need = align_up(bytes);
+  if (need > ws->size - ws->used)
+    return NULL;
+
+  void *p = ws->base + ws->used;
+  ws->used += need;
+  if (ws->used > ws->peak)
+    ws->peak = ws->used;
+  return p;
+}
+
+double *mtx_workspace_doubles(mtx_workspace_t *ws, size_t count) {
+  return (double *)mtx_workspace_push(ws, count * sizeof(double));
+}
+
+int mtx_workspace_matrix(mtx_workspace_t *ws, size_t rows, size_t cols,
+                         matrix_t *out) {
+  if (!out)
+    return -1;
+
+  double *data = mtx_workspace_doubles(ws, rows * cols);
+  if (!data)
+    return -1;
+
+  // The matrix borrows workspace memory, so it is a view.
+  return mtx_view_data(out, data, rows, cols, cols);
+}
+
+size_t mtx_workspace_mark(const mtx_workspace_t *ws) {
+  return ws ? ws->used : 0;
+}
+
+void mtx_workspace_release(mtx_workspace_t *ws, size_t mark) {
+  if (ws && mark <= ws->used)
+    ws->used = mark;
+}
+
+int mtx_scratch_begin(mtx_scratch_t *s, mtx_workspace_t *ws, size_t bytes) {
+  s->owned = NULL;
+  if (!ws) {
+    ws = s->owned = mtx_workspace_alloc(bytes);
+    if (!ws)
+      return -1;
+  } else if (ws->size - ws->used < bytes) {
+    return -1;
+  }
+
+  s->ws = ws;
+  s->mark = mtx_workspace_mark(ws);
+  return 0;
+}
+
+void mtx_scratch_end(mtx_scratch_t *s) {
+  mtx_workspace_release(s->ws, s->mark);
+  mtx_workspace_free(s->owned);
+  s->ws = NULL;
+  s->owned = NULL;
+}
@@ -0,0 +1,43 @@
+#ifndef MATRIX_WORKSPACE_H
+#define MATRIX_WORKSPACE_H
+
+#include "matrix.h"
+
+#define MTX_WORKSPACE_ALIGN 64
+
+// Bump allocator for operation temporaries. Size it once with the
+// mtx_*_workspace_size queries; steady-state calls then never reach malloc.
+typedef struct {
+  unsigned char *base;
+  size_t size;
+  size_t used;
+  size_t peak;
+} mtx_workspace_t;
+
+// Scope for one operation's scratch: borrows the caller's workspace, or owns
+// a temporary one when the caller passed NULL.
+typedef struct {
+  mtx_workspace_t *ws;
+  mtx_workspace_t *owned;
+  size_t mark;
+} mtx_scratch_t;
+
+mtx_workspace_t *mtx_workspace_alloc(size_t bytes);
+void mtx_workspace_free(mtx_workspace_t *ws);
+int mtx_workspace_reserve(mtx_workspace_t *ws, size_t bytes);
+
+// Bytes a push of `bytes` consumes, including alignment padding.
+size_t mtx_workspace_bytes(size_t bytes);
+
+void *mtx_workspace_push(mtx_workspace_t *ws, size_t bytes);
+double *mtx_workspace_doubles(mtx_workspace_t *ws, size_t count);
+// Carves a packed rows x cols view out of the workspace.
+int mtx_workspace_matrix(mtx_workspace_t *ws, size_t rows, size_t cols,
+                         matrix_t *out);
+size_t mtx_workspace_mark(const mtx_workspace_t *ws);
+void mtx_workspace_release(mtx_workspace_t *ws, size_t mark);
+
+int mtx_scratch_begin(mtx_scratch_t *s, mtx_workspace_t *ws, size_t bytes);
+void mtx_scratch_end(mtx_scratch_t *s);
+
+#endif // MATRIX_WORKSPACE_H